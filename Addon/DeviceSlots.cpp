@@ -0,0 +1,261 @@
+/*
+	Copyright 2025, Alexey "Hitech" Burshtein.   All Rights Reserved.
+	This file may be used under the terms of the MIT License.
+*/
+
+/**
+ * @file DeviceSlots.cpp
+ * @brief Implementation of the DeviceSlots class.
+ * @ingroup AddonModule
+ */
+
+#include "DeviceSlots.h"
+#include "log.h"
+
+#ifdef __HAIKU__
+#	include <Autolock.h>
+#endif
+
+#include <string.h>
+
+
+/**	\brief		Constructor. All slots are free.
+ */
+DeviceSlots::DeviceSlots()
+	:	fCount(0),
+		fFocusedClass(0),
+		fClaimLock("IgnoreTouchpad slots")
+{
+	for (int32 i = 0; i < kMaxDeviceSlots; i++) {
+		fSlots[i].id = 0;
+		fSlots[i].name[0] = '\0';
+		fSlots[i].flags.store(0, std::memory_order_relaxed);
+		fSlots[i].mask.store(0, std::memory_order_relaxed);
+		fSlots[i].trigger.store(-1, std::memory_order_relaxed);
+		fSlots[i].window.store(0, std::memory_order_relaxed);
+		fSlots[i].lastActivity.store(0, std::memory_order_relaxed);
+		fSlots[i].focusMask.store(0, std::memory_order_relaxed);
+		fSlots[i].counters = -1;
+	}
+	for (int32 i = 0; i < kSlotIndexSize; i++) {
+		fIndex[i].store(0, std::memory_order_relaxed);
+	}
+}
+
+
+/**	\brief		Looks for the slot of the device.
+ *	\param[in]	id		DeviceFingerprint() of the device.
+ *	\returns	Index of the slot, or -1 if the device has none yet.
+ */
+int32
+DeviceSlots::Find(device_fingerprint id) const
+{
+	// Slots are never freed, so an empty bucket ends the search
+	for (int32 probe = 0; probe < kSlotIndexSize; probe++) {
+		int32 entry = fIndex[(id + probe) & (kSlotIndexSize - 1)].load(std::memory_order_acquire);
+		if (entry == 0) { return -1; }
+		if (fSlots[entry - 1].id == id) { return entry - 1; }
+	}
+	return -1;
+}
+
+
+/**	\brief		Returns the slot of the device, claiming a new one if necessary.
+ *	\param[in]	id			DeviceFingerprint() of the device.
+ *	\param[in]	name		Name of the device, kept for the counters.
+ *	\param[in]	counters	If not `NULL`, the device also gets a slot in there.
+ *	\returns	Index of the slot, or -1 if all slots are taken.
+ */
+int32
+DeviceSlots::Acquire(device_fingerprint id, const char* name, SharedCounters* counters)
+{
+	int32 slot = Find(id);
+	if (slot >= 0) { return slot; }
+
+	BAutolock lock(fClaimLock);
+
+	// Someone could have claimed it while we were waiting for the lock
+	slot = Find(id);
+	if (slot >= 0) { return slot; }
+
+	slot = fCount.load(std::memory_order_relaxed);
+	if (slot >= kMaxDeviceSlots) { return -1; }
+
+	fSlots[slot].id = id;
+	strlcpy(fSlots[slot].name, name, kSnapshotNameLength);
+	fSlots[slot].counters = counters ? counters->AddDevice(id, name) : -1;
+	fCount.store(slot + 1, std::memory_order_release);
+
+	// There are twice as many buckets as slots, so there is always a free one
+	uint64 bucket = id;
+	while (fIndex[bucket & (kSlotIndexSize - 1)].load(std::memory_order_relaxed) != 0) { bucket++; }
+	fIndex[bucket & (kSlotIndexSize - 1)].store(slot + 1, std::memory_order_release);
+	return slot;
+}
+
+
+/**	\brief		The decision of the filter: records the activity and checks the policy.
+ *	\param[in]	slot		Slot of the device that produced the event.
+ *	\param[in]	eventClass	Class of the event.
+ *	\param[in]	when		Time of the event.
+ *	\param[out]	reason		Why the event should be dropped. Untouched if it shouldn't.
+ *	\returns	`true` if the event should be dropped.
+ */
+bool
+DeviceSlots::ShouldDrop(int32 slot, event_class eventClass, bigtime_t when,
+	drop_reason* reason)
+{
+	if (slot < 0 || slot >= kMaxDeviceSlots) { return false; }
+
+	DeviceSlot& device = fSlots[slot];
+	device.lastActivity.store(when, std::memory_order_relaxed);
+
+	uint32 flags = device.flags.load(std::memory_order_acquire);
+	if ((flags & (1 << (kSlotDropShift + eventClass))) != 0) {
+		*reason = (flags & kSlotIgnored) != 0 ? kDropIgnored : kDropMasked;
+		return true;
+	}
+
+	if ((flags & kSlotWhileActive) != 0) {
+		int32 trigger = device.trigger.load(std::memory_order_relaxed);
+		if (trigger >= 0 && trigger < kMaxDeviceSlots && trigger != slot) {
+			bigtime_t lastActive = fSlots[trigger].lastActivity.load(std::memory_order_relaxed);
+			if (lastActive != 0
+				&& when - lastActive < device.window.load(std::memory_order_relaxed))
+			{
+				*reason = kDropWhileActive;
+				return true;
+			}
+		}
+	}
+
+	if ((flags & kSlotWhileFocused) != 0
+		&& (device.focusMask.load(std::memory_order_relaxed)
+			& fFocusedClass.load(std::memory_order_relaxed)) != 0)
+	{
+		*reason = kDropFocused;
+		return true;
+	}
+	return false;
+}
+
+
+/**	\brief		Makes the slots enforce the snapshot.
+ *	\param[in]	snapshot	The new ignore state.
+ *	\param[in]	counters	Passed to DeviceSlots::Acquire() for the new devices.
+ *	\details	The devices missing from the snapshot lose all of their flags. The
+ *				new state is computed first and then stored slot by slot, so a
+ *				device that stays ignored is never let through in between.
+ *	\details	The last active pointer is never silenced: if the new state could
+ *				drop the moves of every device that has moved the pointer since
+ *				the add-on was loaded, be it by an ignore, a mask, another device's
+ *				activity or the active application, the one that moved it last
+ *				gets none of its policies.
+ */
+void
+DeviceSlots::Apply(const IgnoreSnapshot* snapshot, SharedCounters* counters)
+{
+	uint32		flags[kMaxDeviceSlots] = { 0 };
+	uint32		masks[kMaxDeviceSlots] = { 0 };
+	int32		triggers[kMaxDeviceSlots];
+	bigtime_t	windows[kMaxDeviceSlots] = { 0 };
+	uint32		focusMasks[kMaxDeviceSlots] = { 0 };
+	for (int32 i = 0; i < kMaxDeviceSlots; i++) { triggers[i] = -1; }
+
+	for (int32 i = 0; i < snapshot->header.count; i++) {
+		const SnapshotRecord& record = snapshot->records[i];
+		int32 slot = Acquire(record.fingerprint, record.name, counters);
+		if (slot < 0) { continue; }
+
+		masks[slot] = record.mask & kEventAllMask;
+		if ((record.flags & kSnapshotIgnored) != 0) {
+			flags[slot] |= kSlotIgnored | (kEventAllMask << kSlotDropShift);
+		} else {
+			flags[slot] |= masks[slot] << kSlotDropShift;
+		}
+		if ((record.flags & kSnapshotWhileActive) != 0 && record.trigger[0] != '\0') {
+			// The trigger gets a slot right away, so its activity is tracked from now on
+			triggers[slot] = Acquire(record.triggerFingerprint, record.trigger, counters);
+			windows[slot] = (bigtime_t)record.windowMs * 1000;
+			if (triggers[slot] >= 0) { flags[slot] |= kSlotWhileActive; }
+		}
+		if ((record.flags & kSnapshotWhileFocused) != 0 && record.focusMask != 0) {
+			focusMasks[slot] = record.focusMask;
+			flags[slot] |= kSlotWhileFocused;
+		}
+	}
+
+	int32 count = fCount.load(std::memory_order_acquire);
+	// Any of these may silence the moves of a device, now or when an application is activated
+	const uint32 silencing = (1 << (kSlotDropShift + kEventMotion)) | kSlotWhileActive
+		| kSlotWhileFocused;
+	int32 lastActive = -1;
+	bool anyPointer = false;
+	for (int32 i = 0; i < count && !anyPointer; i++) {
+		bigtime_t active = fSlots[i].lastActivity.load(std::memory_order_relaxed);
+		if (active == 0) { continue; }
+		anyPointer = (flags[i] & silencing) == 0;
+		if (lastActive < 0
+			|| active > fSlots[lastActive].lastActivity.load(std::memory_order_relaxed))
+		{
+			lastActive = i;
+		}
+	}
+	if (!anyPointer && lastActive >= 0) {
+		LOG_WARNING("IgnoreFilter", "Not ignoring \"%s\", it is the last active pointer.",
+			fSlots[lastActive].name);
+		// Nothing may drop its events: no ignore, no mask, no activity or focus policy
+		flags[lastActive] = 0;
+		masks[lastActive] = 0;
+	}
+
+	for (int32 i = 0; i < count; i++) {
+		fSlots[i].trigger.store(triggers[i], std::memory_order_relaxed);
+		fSlots[i].window.store(windows[i], std::memory_order_relaxed);
+		fSlots[i].mask.store(masks[i], std::memory_order_relaxed);
+		fSlots[i].focusMask.store(focusMasks[i], std::memory_order_relaxed);
+		fSlots[i].flags.store(flags[i], std::memory_order_release);
+	}
+}
+
+
+/**	\brief		Drops the kSlotIgnored flag of one or all devices.
+ *	\param[in]	slot	Slot of the device, or -1 for all devices.
+ *	\details	The devices go back to their own suppression masks; activity
+ *				policies stay as well.
+ */
+void
+DeviceSlots::ClearIgnored(int32 slot)
+{
+	const uint32 dropBits = kEventAllMask << kSlotDropShift;
+
+	int32 count = fCount.load(std::memory_order_acquire);
+	int32 first = 0;
+	if (slot >= 0) {
+		if (slot >= count) { return; }
+		first = slot;
+		count = slot + 1;
+	}
+	for (int32 i = first; i < count; i++) {
+		uint32 ownDropBits = fSlots[i].mask.load(std::memory_order_relaxed) << kSlotDropShift;
+		uint32 flags = fSlots[i].flags.load(std::memory_order_relaxed);
+		uint32 cleared;
+		do {
+			cleared = (flags & ~(kSlotIgnored | dropBits)) | ownDropBits;
+		} while (!fSlots[i].flags.compare_exchange_weak(flags, cleared,
+			std::memory_order_release, std::memory_order_relaxed));
+	}
+}
+
+
+int32
+DeviceSlots::CountIgnored() const
+{
+	int32 ignored = 0;
+	int32 count = fCount.load(std::memory_order_acquire);
+	for (int32 i = 0; i < count; i++) {
+		if ((fSlots[i].flags.load(std::memory_order_relaxed) & kSlotIgnored) != 0)
+			ignored++;
+	}
+	return ignored;
+}
@@ -0,0 +1,120 @@
+/*
+	Copyright 2025, Alexey "Hitech" Burshtein.   All Rights Reserved.
+	This file may be used under the terms of the MIT License.
+*/
+
+/**
+ * @file DeviceSlots.h
+ * @brief Per-device state of the filter.
+ * @ingroup AddonModule
+ */
+
+#ifndef _DEVICE_SLOTS_H_
+#define _DEVICE_SLOTS_H_
+
+#include "platform.h"
+
+#ifdef __HAIKU__
+#	include <Locker.h>
+#endif
+
+#include <atomic>
+
+#include "counters.h"
+#include "device_types.h"
+#include "snapshot.h"
+
+
+const int32	kMaxDeviceSlots = kMaxSnapshotDevices;	//!<	Devices beyond this are never dropped
+//!	Buckets of the fingerprint index of DeviceSlots, a power of two.
+const int32	kSlotIndexSize = 2 * kMaxDeviceSlots;
+
+//!	Flag in DeviceSlot::flags: the device is ignored.
+const uint32	kSlotIgnored = 0x01;
+//!	Flag in DeviceSlot::flags: the device is ignored while its trigger is active.
+const uint32	kSlotWhileActive = 0x02;
+//!	Flag in DeviceSlot::flags: the device is ignored while one of its applications is active.
+const uint32	kSlotWhileFocused = 0x04;
+/**	DeviceSlot::flags keep the dropped event classes from this bit on, so that
+ *	the decision for an event is a single bit test: `1 << (kSlotDropShift + class)`.
+ *	An ignored device has all of these bits set. */
+const uint32	kSlotDropShift = 8;
+
+
+/**	\struct		DeviceSlot
+ *	\brief		Everything the filter knows about a single device.
+ *	\details	The id and the name are written once, before the slot is published. All other
+ *				fields may change at any time and are only accessed atomically.
+ */
+struct DeviceSlot {
+	device_fingerprint		id;							//!<	DeviceFingerprint() of the device
+	char					name[kSnapshotNameLength];	//!<	Name of the device
+	std::atomic<uint32>		flags;						//!<	Combination of kSlot* flags and dropped classes
+	std::atomic<uint32>		mask;						//!<	The device's own DeviceInfo::SuppressMask
+	std::atomic<int32>		trigger;					//!<	Slot of the suppressing device, -1 if none
+	std::atomic<bigtime_t>	window;						//!<	How long the trigger counts as active
+	std::atomic<bigtime_t>	lastActivity;				//!<	Time of the last event of this device
+	std::atomic<uint32>		focusMask;					//!<	Focus classes the device is ignored for
+	int32					counters;					//!<	Slot in the SharedCounters, -1 if none
+};
+
+
+/**	\class		DeviceSlots
+ *	\brief		Fixed table of device slots, shared by the event path and the worker.
+ *	\details	The devices are found by their fingerprints, through an
+ *				open-addressed index, so finding the slot of an event's device
+ *				costs one or two integer compares whatever the number of devices.
+ *				The trigger of a device is resolved to a slot once, when the
+ *				snapshot is applied. Once a device has a slot, every decision about its event is a few
+ *				relaxed atomic loads: no locks, no allocations, no looping over the
+ *				other devices. Claiming a new slot takes a lock, but it happens
+ *				only once per device.
+ */
+class DeviceSlots {
+public:
+	DeviceSlots();							//!<	\copydoc	DeviceSlots::DeviceSlots
+
+	//!	\copydoc	DeviceSlots::Find
+	int32 Find(device_fingerprint id) const;
+	//!	Looks for the slot of the device by its name, see DeviceSlots::Find.
+	int32 Find(const char* name) const { return Find(DeviceFingerprint(name)); }
+	//!	\copydoc	DeviceSlots::Acquire
+	int32 Acquire(device_fingerprint id, const char* name,
+		SharedCounters* counters = NULL);
+	//!	Returns the slot of the device by its name, see DeviceSlots::Acquire.
+	int32 Acquire(const char* name, SharedCounters* counters = NULL)
+		{ return Acquire(DeviceFingerprint(name), name, counters); }
+
+	//!	\copydoc	DeviceSlots::ShouldDrop
+	bool ShouldDrop(int32 slot, event_class eventClass, bigtime_t when,
+		drop_reason* reason);
+
+	//!	\copydoc	DeviceSlots::Apply
+	void Apply(const IgnoreSnapshot* snapshot, SharedCounters* counters = NULL);
+	//!	\copydoc	DeviceSlots::ClearIgnored
+	void ClearIgnored(int32 slot = -1);
+	/**	Sets the focus class of the active application: `1 << i` for the i-th of
+	 *	SnapshotHeader::focusClasses, 0 if it's none of them. See FocusTracker. */
+	void SetFocusedClass(uint32 focusClass)
+		{ fFocusedClass.store(focusClass, std::memory_order_relaxed); }
+
+	//!	Number of devices with the kSlotIgnored flag.
+	int32 CountIgnored() const;
+
+	//!	Name of the device in the slot.
+	const char* Name(int32 slot) const { return fSlots[slot].name; }
+	//!	DeviceFingerprint() of the device in the slot, with its ordinal.
+	device_fingerprint Id(int32 slot) const { return fSlots[slot].id; }
+	//!	Slot of the device in the SharedCounters, -1 if none.
+	int32 CountersSlot(int32 slot) const { return fSlots[slot].counters; }
+
+protected:
+	DeviceSlot			fSlots[kMaxDeviceSlots];	//!<	The slots
+	std::atomic<int32>	fCount;						//!<	Number of published slots
+	//!	Slot + 1 of each fingerprint, at its hash or after it; 0 if the bucket is empty
+	std::atomic<int32>	fIndex[kSlotIndexSize];
+	std::atomic<uint32>	fFocusedClass;				//!<	\see	DeviceSlots::SetFocusedClass
+	BLocker				fClaimLock;					//!<	Serializes the claims of new slots
+};
+
+#endif // _DEVICE_SLOTS_H_
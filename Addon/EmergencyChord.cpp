@@ -0,0 +1,90 @@
+/*
+	Copyright 2025, Alexey "Hitech" Burshtein.   All Rights Reserved.
+	This file may be used under the terms of the MIT License.
+*/
+
+/**
+ * @file EmergencyChord.cpp
+ * @brief Implementation of the EmergencyChord class.
+ * @ingroup AddonModule
+ */
+
+#include "EmergencyChord.h"
+#include "settings.h"
+
+#include <ctype.h>
+
+
+/**	\brief		Constructor.
+ *	\param[in]	modifiers	Modifiers of the chord, see Settings::SetEmergencyChord().
+ *	\param[in]	key			Unmodified character of the chord. 0 disables the detection.
+ */
+EmergencyChord::EmergencyChord(uint32 modifiers, uint32 key)
+	:	fState(kIdle)
+{
+	SetTo(modifiers, key);
+}
+
+
+/**	\brief		Changes the chord.
+ *	\copydetails	EmergencyChord::EmergencyChord
+ *	\note		The state machine is not reset: it may be running in another thread.
+ *				A stale "fired" state goes away with the next key up anyway.
+ */
+void
+EmergencyChord::SetTo(uint32 modifiers, uint32 key)
+{
+	fModifiers.store(modifiers & kChordModifiersMask, std::memory_order_relaxed);
+	fKey.store(key < 0x80 ? tolower(key) : key, std::memory_order_relaxed);
+}
+
+
+/**	\brief		Feeds a key event into the state machine.
+ *	\param[in]	message		Any input event. Everything except the key downs, key ups
+ *							and modifier changes is ignored.
+ *	\returns	`true` exactly once per press of the chord, `false` otherwise.
+ */
+bool
+EmergencyChord::ProcessKeyEvent(const BMessage* message)
+{
+	uint32 chordKey = fKey.load(std::memory_order_relaxed);
+	uint32 chordModifiers = fModifiers.load(std::memory_order_relaxed);
+	if (chordKey == 0) { return false; }
+
+	int32 modifiers = 0;
+	switch (message->what) {
+		case B_KEY_DOWN:
+		case B_UNMAPPED_KEY_DOWN:
+		{
+			int32 rawChar = 0;
+			message->FindInt32("modifiers", &modifiers);
+			message->FindInt32("raw_char", &rawChar);
+			if (rawChar < 0x80) { rawChar = tolower(rawChar); }
+
+			bool matches = ((uint32)modifiers & kChordModifiersMask) == chordModifiers
+				&& (uint32)rawChar == chordKey;
+			if (!matches) {
+				fState = kIdle;
+				return false;
+			}
+			if (fState == kFired) { return false; }		// Auto-repeat
+			fState = kFired;
+			return true;
+		}
+
+		case B_KEY_UP:
+		case B_UNMAPPED_KEY_UP:
+			fState = kIdle;
+			return false;
+
+		case B_MODIFIERS_CHANGED:
+			message->FindInt32("modifiers", &modifiers);
+			if (((uint32)modifiers & kChordModifiersMask) != chordModifiers) {
+				fState = kIdle;
+			}
+			return false;
+
+		default:
+			return false;
+	}
+}
@@ -0,0 +1,53 @@
+/*
+	Copyright 2025, Alexey "Hitech" Burshtein.   All Rights Reserved.
+	This file may be used under the terms of the MIT License.
+*/
+
+/**
+ * @file EmergencyChord.h
+ * @brief Detection of the emergency "unignore all" key chord.
+ * @ingroup AddonModule
+ */
+
+#ifndef _EMERGENCY_CHORD_H_
+#define _EMERGENCY_CHORD_H_
+
+#include <Message.h>
+#include <SupportDefs.h>
+
+#include <atomic>
+
+
+/**	\class		EmergencyChord
+ *	\brief		Small state machine that recognizes the "unignore all" chord.
+ *	\details	The chord is a set of modifiers plus one key, e.g. Ctrl + Alt + Win + E.
+ *				Every key event costs a couple of field lookups and comparisons,
+ *				no matter how long the key is held: the auto-repeated key downs are
+ *				swallowed by the "fired" state, so the chord triggers once per press.
+ *				The chord itself may be changed from another thread at any time.
+ */
+class EmergencyChord {
+public:
+	//!	\copydoc	EmergencyChord::EmergencyChord
+	EmergencyChord(uint32 modifiers, uint32 key);
+
+	//!	\copydoc	EmergencyChord::SetTo
+	void SetTo(uint32 modifiers, uint32 key);
+	//!	\copydoc	EmergencyChord::ProcessKeyEvent
+	bool ProcessKeyEvent(const BMessage* message);
+
+protected:
+	//!	States of the chord detector
+	enum State {
+		kIdle,			//!<	Waiting for the chord
+		kFired			//!<	The chord was recognized, waiting for the key to be released
+	};
+
+	//!	Required modifiers, masked with kChordModifiersMask
+	std::atomic<uint32>	fModifiers;
+	//!	Unmodified character of the key, lowercase. 0 if disabled.
+	std::atomic<uint32>	fKey;
+	State				fState;			//!<	Current state, touched by the event path only
+};
+
+#endif // _EMERGENCY_CHORD_H_
@@ -0,0 +1,122 @@
+/*
+	Copyright 2025, Alexey "Hitech" Burshtein.   All Rights Reserved.
+	This file may be used under the terms of the MIT License.
+*/
+
+/**
+ * @file FocusTracker.cpp
+ * @brief Implementation of the FocusTracker class.
+ * @ingroup AddonModule
+ */
+
+#include "FocusTracker.h"
+#include "DeviceSlots.h"
+#include "log.h"
+
+#include <Roster.h>
+
+#include <string.h>
+
+
+//!	Carries the signatures of the new focus classes to the looper.
+const uint32	kMsgFocusClasses = 'ITfc';
+
+
+/**	\brief		Constructor. Nothing is watched until some device has a focus policy.
+ *	\param[in]	slots	The slots to publish the focus class to.
+ */
+FocusTracker::FocusTracker(DeviceSlots* slots)
+	:	BLooper("IgnoreTouchpad focus", B_LOW_PRIORITY),
+		fSlots(slots),
+		fWatching(false)
+{
+}
+
+
+/**	\brief		Hands the focus classes of a new snapshot over to the looper.
+ *	\param[in]	snapshot	The snapshot that has just been applied.
+ *	\note		Called by the filter's constructor and by its worker thread.
+ */
+void
+FocusTracker::SetClasses(const IgnoreSnapshot* snapshot)
+{
+	BMessage message(kMsgFocusClasses);
+	for (int32 i = 0; i < snapshot->header.focusClassCount; i++) {
+		message.AddString("signature", snapshot->header.focusClasses[i]);
+	}
+	PostMessage(&message);
+}
+
+
+/**	\brief		Stops the activation notifications.
+ */
+void
+FocusTracker::StopWatching()
+{
+	if (!fWatching) { return; }
+	be_roster->StopWatching(BMessenger(this));
+	fWatching = false;
+}
+
+
+/**	\brief		Follows the activations and the changes of the focus classes.
+ *	\param[in]	message		B_SOME_APP_ACTIVATED, kMsgFocusClasses, or anything else.
+ */
+void
+FocusTracker::MessageReceived(BMessage* message)
+{
+	switch (message->what) {
+		case B_SOME_APP_ACTIVATED:
+		{
+			const char* signature;
+			if (B_OK == message->FindString("be:signature", &signature)) {
+				fActive = signature;
+				Update();
+			}
+			break;
+		}
+
+		case kMsgFocusClasses:
+		{
+			fClasses.clear();
+			const char* signature;
+			for (int32 i = 0; message->FindString("signature", i, &signature) == B_OK; i++) {
+				fClasses.push_back(signature);
+			}
+
+			// The registrar may not have been up at boot, so this is retried with each snapshot
+			if (!fClasses.empty() && !fWatching) {
+				status_t status = be_roster->StartWatching(BMessenger(this), B_REQUEST_ACTIVATED);
+				fWatching = (B_OK == status);
+				if (!fWatching) {
+					LOG_WARNING("IgnoreFilter", "Could not follow the active application: %s",
+						strerror(status));
+				}
+				app_info info;
+				if (B_OK == be_roster->GetActiveAppInfo(&info)) { fActive = info.signature; }
+			}
+			if (fClasses.empty()) { StopWatching(); }
+			Update();
+			break;
+		}
+
+		default:
+			BLooper::MessageReceived(message);
+	}
+}
+
+
+/**	\brief		Publishes the focus class of the active application.
+ */
+void
+FocusTracker::Update()
+{
+	uint32 focusClass = 0;
+	for (size_t i = 0; i < fClasses.size(); i++) {
+		if (fActive.ICompare(fClasses[i]) == 0) {
+			focusClass = 1 << i;
+			break;
+		}
+	}
+	fSlots->SetFocusedClass(focusClass);
+}
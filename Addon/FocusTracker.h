@@ -0,0 +1,56 @@
+/*
+	Copyright 2025, Alexey "Hitech" Burshtein.   All Rights Reserved.
+	This file may be used under the terms of the MIT License.
+*/
+
+/**
+ * @file FocusTracker.h
+ * @brief Follows the active application for the focus policies.
+ * @ingroup AddonModule
+ */
+
+#ifndef _FOCUS_TRACKER_H_
+#define _FOCUS_TRACKER_H_
+
+#include <Looper.h>
+#include <String.h>
+
+#include <vector>
+
+#include "snapshot.h"
+
+class DeviceSlots;
+
+
+/**	\class		FocusTracker
+ *	\brief		Looper that keeps DeviceSlots informed about the active application.
+ *	\details	Looking the active application up for each event would cost a
+ *				round trip to the registrar. Instead, the tracker listens to the
+ *				roster's activation notifications and, on each of them, maps the
+ *				signature of the application to its focus class once; the filter
+ *				only reads the result, a single atomic value in DeviceSlots.
+ *	\details	The roster is watched only while some device has a focus policy,
+ *				so without them the add-on never hears about the activations.
+ *	\note		All state is touched on the looper's thread only; the worker
+ *				hands the new classes over with a message.
+ */
+class FocusTracker : public BLooper {
+public:
+	//!	\copydoc	FocusTracker::FocusTracker
+	FocusTracker(DeviceSlots* slots);
+
+	//!	\copydoc	FocusTracker::SetClasses
+	void SetClasses(const IgnoreSnapshot* snapshot);
+	void StopWatching();							//!<	\copydoc	FocusTracker::StopWatching
+	virtual void MessageReceived(BMessage* message);	//!<	\copydoc	FocusTracker::MessageReceived
+
+protected:
+	void Update();									//!<	\copydoc	FocusTracker::Update
+
+	DeviceSlots*			fSlots;			//!<	Where the focus class is published
+	std::vector<BString>	fClasses;		//!<	Signatures of the focus classes, in their order
+	BString					fActive;		//!<	Signature of the active application
+	bool					fWatching;		//!<	`true` if the roster sends us the activations
+};
+
+#endif // _FOCUS_TRACKER_H_
@@ -0,0 +1,424 @@
+/*
+	Copyright 2025, Alexey "Hitech" Burshtein.   All Rights Reserved.
+	This file may be used under the terms of the MIT License.
+*/
+
+/**
+ * @file IgnoreFilter.cpp
+ * @brief Implementation of the IgnoreTouchpadFilter class.
+ * @ingroup AddonModule
+ */
+
+#include "IgnoreFilter.h"
+#include "FocusTracker.h"
+#include "SnapshotWatcher.h"
+#include "device_control.h"
+#include "log.h"
+#include "settings.h"
+
+#include <stdio.h>
+#include <string.h>
+
+
+/**	\brief		Entry point of the add-on, called by input_server.
+ */
+extern "C" _EXPORT BInputServerFilter*
+instantiate_input_filter()
+{
+	return new IgnoreTouchpadFilter();
+}
+
+
+/**	\brief		Returns the class of the pointer event.
+ *	\param[in]	message		A B_MOUSE_* event.
+ */
+static event_class
+event_class_of(const BMessage* message)
+{
+	bool tap = false;
+	switch (message->what) {
+		case B_MOUSE_DOWN:
+			return (B_OK == message->FindBool(IGNORE_TAP_FIELD, &tap) && tap)
+				? kEventTap : kEventButtonDown;
+		case B_MOUSE_UP:
+			return (B_OK == message->FindBool(IGNORE_TAP_FIELD, &tap) && tap)
+				? kEventTap : kEventButtonUp;
+		case B_MOUSE_WHEEL_CHANGED:
+			return kEventWheel;
+		default:
+			return kEventMotion;
+	}
+}
+
+
+/**	\brief		Constructor.
+ *	\details	Restores the persisted ignore state before input_server
+ *				passes the first event to the filter. Only the startup snapshot
+ *				is read, the full settings file is of no interest here.
+ *				The time it takes is measured and kept in fStartupLatency.
+ */
+IgnoreTouchpadFilter::IgnoreTouchpadFilter()
+	:	BInputServerFilter(),
+		fChord(kDefaultChordModifiers, kDefaultChordKey),
+		fPendingJobs(0),
+		fControl(DeviceControl::Create()),
+		fWatcher(NULL),
+		fFocus(NULL),
+		fLoadedAt(system_time()),
+		fStartupLatency(0),
+		fSnapshotNotified(0),
+		fLastTraceId(0),
+		fTraceRecord(-1),
+		fTraceSlot(-1)
+{
+	// input_server's output goes to the syslog, where the notable events belong
+	SetLogLevel(kLogInfo);
+	status_t status = fCounters.Publish();
+
+	IgnoreSnapshot snapshot;
+	fSnapshotStatus = ReadSnapshot(&snapshot);
+	if (B_OK == fSnapshotStatus) {
+		fChord.SetTo(snapshot.header.chordModifiers, snapshot.header.chordKey);
+		// A trace left from before the boot has nothing to do with this one
+		fLastTraceId = snapshot.header.traceId;
+	}
+	fSlots.Apply(&snapshot, &fCounters);
+	fStartupLatency = system_time() - fLoadedAt;
+	ArmTimers(&snapshot);
+	fFocus = new FocusTracker(&fSlots);
+	fFocus->Run();
+	if (B_OK == fSnapshotStatus) { fFocus->SetClasses(&snapshot); }
+
+	if (B_OK != status) {
+		LOG_ERROR("IgnoreFilter", "Could not publish the counters: %s",
+			strerror(status));
+	}
+	if (B_OK != fSnapshotStatus && B_ENTRY_NOT_FOUND != fSnapshotStatus) {
+		LOG_ERROR("IgnoreFilter", "Could not read the startup snapshot: %s",
+			strerror(fSnapshotStatus));
+	}
+	LOG_INFO("IgnoreFilter", "%d devices restored in %lld us.",
+		(int)snapshot.header.count, (long long)fStartupLatency);
+	if (fStartupLatency > kStartupBudget) {
+		LOG_WARNING("IgnoreFilter", "Startup took longer than the budget of %lld us!",
+			(long long)kStartupBudget);
+	}
+
+	fWorkerSem = create_sem(0, "IgnoreTouchpad jobs");
+	fWorker = spawn_thread(WorkerThread, "IgnoreTouchpad worker",
+		B_LOW_PRIORITY, this);
+	if (fWorker >= 0) { resume_thread(fWorker); }
+
+	// Pick up the changes made by the CLI and the GUI from now on
+	fWatcher = new SnapshotWatcher(this);
+	fWatcher->Run();
+	fWatcher->Lock();
+	status = fWatcher->StartWatching();
+	fWatcher->Unlock();
+	if (B_OK != status) {
+		LOG_ERROR("IgnoreFilter", "Could not watch the settings: %s",
+			strerror(status));
+	}
+}
+
+
+/**	\brief		Destructor.
+ *	\details	Deleting the semaphore wakes the worker thread up and makes it quit.
+ */
+IgnoreTouchpadFilter::~IgnoreTouchpadFilter()
+{
+	if (fWatcher && fWatcher->Lock()) {
+		fWatcher->StopWatching();
+		fWatcher->Quit();
+	}
+
+	delete_sem(fWorkerSem);
+	if (fWorker >= 0) {
+		status_t result;
+		wait_for_thread(fWorker, &result);
+	}
+
+	// The worker is gone, nobody posts to the tracker anymore
+	if (fFocus && fFocus->Lock()) {
+		fFocus->StopWatching();
+		fFocus->Quit();
+	}
+	delete fControl;
+}
+
+
+/**	\brief		The filter is always usable.
+ *	\details	Even if the snapshot could not be read, the filter stays loaded:
+ *				nothing is ignored then, but later updates may still arrive.
+ */
+status_t
+IgnoreTouchpadFilter::InitCheck()
+{
+	return B_OK;
+}
+
+
+/**	\brief		Drops the pointer events of the ignored devices.
+ *	\param[in]	message		The event.
+ *	\param[in]	outList		Unused.
+ *	\returns	B_SKIP_MESSAGE if the event came from an ignored device, if this
+ *				class of events is suppressed for the device, or if the device is
+ *				suppressed by the activity of another one or by the active
+ *				application; B_DISPATCH_MESSAGE otherwise.
+ *	\note		Events that don't say which device they came from are always passed.
+ */
+filter_result
+IgnoreTouchpadFilter::Filter(BMessage* message, BList* outList)
+{
+	switch (message->what) {
+		case B_MOUSE_DOWN:
+		case B_MOUSE_UP:
+		case B_MOUSE_MOVED:
+		case B_MOUSE_WHEEL_CHANGED:
+			break;
+		case B_KEY_DOWN:
+		case B_KEY_UP:
+		case B_UNMAPPED_KEY_DOWN:
+		case B_UNMAPPED_KEY_UP:
+		case B_MODIFIERS_CHANGED:
+			if (fChord.ProcessKeyEvent(message)) { UnignoreAll(); }
+			return B_DISPATCH_MESSAGE;
+		default:
+			return B_DISPATCH_MESSAGE;
+	}
+
+	const char* deviceName = NULL;
+	if (B_OK != message->FindString(IGNORE_DEVICE_NAME_FIELD, &deviceName)
+		|| !deviceName)
+	{
+		return B_DISPATCH_MESSAGE;
+	}
+
+	bigtime_t when;
+	if (B_OK != message->FindInt64("when", &when)) { when = system_time(); }
+
+	// The events carry only the name, so identical devices share the first one's fingerprint
+	int32 slot = fSlots.Acquire(deviceName, &fCounters);
+	drop_reason reason = kDropIgnored;
+	event_class eventClass = event_class_of(message);
+	bool drop = fSlots.ShouldDrop(slot, eventClass, when, &reason);
+	if (slot >= 0) {
+		fCounters.Count(fSlots.CountersSlot(slot), !drop, reason, when);
+		// Clicks are rare enough to look at; they tell the CLI what the device is
+		if (message->what == B_MOUSE_DOWN) {
+			uint32 traits = (eventClass == kEventTap) ? kTraitTap : 0;
+			if (message->HasFloat(IGNORE_TABLET_FIELD)) { traits |= kTraitAbsolute; }
+			fCounters.AddTraits(fSlots.CountersSlot(slot), traits);
+		}
+		if (drop && slot == fTraceSlot.load(std::memory_order_relaxed)) { TraceFirstDrop(slot); }
+	}
+	return drop ? B_SKIP_MESSAGE : B_DISPATCH_MESSAGE;
+}
+
+
+/**	\brief		Called by the SnapshotWatcher when the snapshot is rewritten.
+ *	\details	Reading the file is left to the worker thread.
+ */
+void
+IgnoreTouchpadFilter::SnapshotChanged()
+{
+	fSnapshotNotified.store(system_time(), std::memory_order_relaxed);
+	PostJob(kJobReloadSnapshot);
+}
+
+
+/**	\brief		Reaction to the emergency chord.
+ *	\details	The in-process ignore set is cleared immediately, so the very next
+ *				pointer event gets through. Everything else is done by the worker.
+ */
+void
+IgnoreTouchpadFilter::UnignoreAll()
+{
+	fSlots.ClearIgnored();
+	PostJob(kJobUnignoreAll);
+}
+
+
+/**	\brief		Schedules the ends of the timed ignores of the snapshot.
+ *	\param[in]	snapshot	The snapshot that has just been applied.
+ *	\details	The previous deadlines are dropped, so the snapshot is always
+ *				the single source of truth. Deadlines that passed while the
+ *				add-on wasn't running expire on the next tick.
+ *	\note		Called by the constructor, and by the worker thread afterwards.
+ */
+void
+IgnoreTouchpadFilter::ArmTimers(const IgnoreSnapshot* snapshot)
+{
+	fTimers.Clear();
+	for (int32 i = 0; i < snapshot->header.count; i++) {
+		const SnapshotRecord& record = snapshot->records[i];
+		if ((record.flags & kSnapshotIgnored) == 0 || record.ignoredUntil == 0) { continue; }
+		fTimers.Schedule(fSlots.Find(record.fingerprint), record.ignoredUntil);
+	}
+}
+
+
+/**	\brief		Unignores the devices whose time is up.
+ *	\details	The devices are unignored in the filter right away, then
+ *				restarted, or asked to report again if they were throttled,
+ *				and saved as unignored, like UnignoreAll() does.
+ *	\note		Called by the worker thread only.
+ */
+void
+IgnoreTouchpadFilter::ExpireTimers()
+{
+	int32 expired[kMaxDeviceSlots];
+	int32 count = fTimers.Expire(real_time_clock_usecs(), expired);
+	if (count == 0) { return; }
+
+	Settings settings;
+	settings.Load();
+	for (int32 i = 0; i < count; i++) {
+		const char* name = fSlots.Name(expired[i]);
+		fSlots.ClearIgnored(expired[i]);
+
+		// The slot has the fingerprint, the settings have the ordinal behind it
+		const DeviceInfo* stored = settings.GetDevice(fSlots.Id(expired[i]));
+		uint32 ordinal = stored ? stored->Ordinal : 0;
+
+		// The device may have been stopped or throttled by the CLI
+		fControl->Release(name);
+		if (settings.GetStrategy(name, ordinal) == kStrategyThrottle) { fControl->Throttle(name, false); }
+		settings.SetStatus(name, false, ordinal);
+		LOG_INFO("IgnoreFilter", "The time is up, \"%s\" is unignored.", name);
+	}
+	SaveSettings(settings);
+}
+
+
+/**	\brief		Saves the settings, updating which devices are connected first.
+ *	\details	Like the CLI does, so the device history is compacted by the
+ *				real age of the devices whoever saves it.
+ *	\note		Called by the worker thread only, the list waits for input_server.
+ */
+void
+IgnoreTouchpadFilter::SaveSettings(Settings& settings)
+{
+	std::vector<std::string> devices;
+	if (B_OK == fControl->GetPointingDevices(&devices)) {
+		std::vector<BString> names;
+		for (const std::string& device : devices)
+			names.push_back(device.c_str());
+		settings.MarkConnected(names);
+	}
+	settings.Save();
+}
+
+
+/**	\brief		Records that a traced change was applied.
+ *	\param[in]	snapshot	The snapshot that has just been applied.
+ *	\param[in]	notified	When the SnapshotWatcher noticed it.
+ *	\details	If the change is about a device, its next dropped event is
+ *				recorded as well, see TraceFirstDrop().
+ *	\note		Called by the worker thread only.
+ */
+void
+IgnoreTouchpadFilter::TraceApplied(const IgnoreSnapshot* snapshot, bigtime_t notified)
+{
+	const SnapshotHeader& header = snapshot->header;
+	if (header.traceId == 0 || header.traceId == fLastTraceId) { return; }
+	fLastTraceId = header.traceId;
+
+	// An unfinished trace is abandoned, its device may never send an event
+	fTraceSlot.store(-1, std::memory_order_relaxed);
+	fTraceRecord = fCounters.BeginTrace(header.traceId, header.traceStarted,
+		header.written, notified);
+	fCounters.MarkTrace(fTraceRecord, kTraceApplied, system_time());
+	if (fTraceRecord >= 0 && header.traceFingerprint != 0) {
+		fTraceSlot.store(fSlots.Find(header.traceFingerprint), std::memory_order_release);
+	}
+}
+
+
+/**	\brief		Ends the current trace with a dropped event of its device.
+ *	\param[in]	slot	Slot of the device whose event was dropped.
+ *	\details	Only the first thread to get here records the time.
+ */
+void
+IgnoreTouchpadFilter::TraceFirstDrop(int32 slot)
+{
+	if (fTraceSlot.compare_exchange_strong(slot, -1, std::memory_order_acquire)) {
+		fCounters.MarkTrace(fTraceRecord, kTraceFirstDrop, system_time());
+	}
+}
+
+
+/**	\brief		Hands a job over to the worker thread without blocking.
+ *	\param[in]	job		One of the kJob* constants.
+ */
+void
+IgnoreTouchpadFilter::PostJob(int32 job)
+{
+	atomic_or(&fPendingJobs, job);
+	release_sem_etc(fWorkerSem, 1, B_DO_NOT_RESCHEDULE);
+}
+
+
+/**	\brief		The worker thread, which does all of the slow stuff.
+ *	\param[in]	data	The filter.
+ *	\details	Jobs posted several times before the worker wakes up are done once.
+ *				While any device is ignored for a limited time, the worker also
+ *				wakes up once per kTimerTick to advance the TimerWheel.
+ *	\details	The log is flushed here, before each wait, so neither the event
+ *				path nor input_server's threads ever write it out.
+ */
+int32
+IgnoreTouchpadFilter::WorkerThread(void* data)
+{
+	IgnoreTouchpadFilter* filter = static_cast<IgnoreTouchpadFilter*>(data);
+
+	while (true) {
+		LogFlush();
+		bigtime_t timeout = filter->fTimers.IsEmpty() ? B_INFINITE_TIMEOUT : kTimerTick;
+		status_t status = acquire_sem_etc(filter->fWorkerSem, 1, B_RELATIVE_TIMEOUT, timeout);
+		if (B_TIMED_OUT == status) {
+			filter->ExpireTimers();
+			continue;
+		}
+		if (B_OK != status) { break; }
+
+		int32 jobs = atomic_set(&filter->fPendingJobs, 0);
+
+		if ((jobs & kJobUnignoreAll) != 0) {
+			// Devices may have been stopped by the CLI or the GUI
+			status = filter->fControl->ReleaseAll();
+			if (B_OK != status) {
+				LOG_ERROR("IgnoreFilter", "Could not start the pointing devices: %s",
+					strerror(status));
+			}
+
+			Settings settings;
+			settings.Load();
+			for (const DeviceInfo& device : settings.GetDevices()) {
+				if (device.IsIgnored && device.Strategy == kStrategyThrottle)
+					filter->fControl->Throttle(device.DeviceName.String(), false);
+			}
+			settings.ClearAllIgnored();
+			filter->SaveSettings(settings);
+			LOG_INFO("IgnoreFilter", "Emergency chord: all devices are unignored.");
+		}
+
+		if ((jobs & kJobReloadSnapshot) != 0) {
+			bigtime_t notified = filter->fSnapshotNotified.load(std::memory_order_relaxed);
+			IgnoreSnapshot snapshot;
+			status = ReadSnapshot(&snapshot);
+			if (B_OK != status) {
+				LOG_ERROR("IgnoreFilter", "Could not reload the snapshot: %s",
+					strerror(status));
+				continue;
+			}
+			filter->fChord.SetTo(snapshot.header.chordModifiers, snapshot.header.chordKey);
+			filter->fSlots.Apply(&snapshot, &filter->fCounters);
+			filter->fFocus->SetClasses(&snapshot);
+			filter->TraceApplied(&snapshot, notified);
+			filter->ArmTimers(&snapshot);
+		}
+		filter->ExpireTimers();
+	}
+	return B_OK;
+}
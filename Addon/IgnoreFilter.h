@@ -0,0 +1,127 @@
+/*
+	Copyright 2025, Alexey "Hitech" Burshtein.   All Rights Reserved.
+	This file may be used under the terms of the MIT License.
+*/
+
+/**
+ * @file IgnoreFilter.h
+ * @brief The input_server filter that drops events from ignored devices.
+ *
+ * @defgroup AddonModule addon
+ * @brief The input_server add-on of Ignore Touchpad.
+ *
+ * The add-on is loaded by input_server at boot. It restores the ignore state
+ * saved by the CLI or the GUI and silently drops the pointer events coming
+ * from the ignored devices.
+ * @{
+ */
+
+#ifndef _IGNORE_FILTER_H_
+#define _IGNORE_FILTER_H_
+
+#include <InputServerFilter.h>
+#include <Message.h>
+#include <OS.h>
+
+#include <atomic>
+
+#include "DeviceSlots.h"
+#include "EmergencyChord.h"
+#include "TimerWheel.h"
+#include "counters.h"
+#include "snapshot.h"
+
+
+//!	Name of the field in the pointer events which holds the name of the source device.
+#define IGNORE_DEVICE_NAME_FIELD	"be:device_name"
+/**	Name of the boolean field which marks the clicks generated by a tap on a touchpad.
+ *	Clicks without it are treated as physical button clicks. */
+#define IGNORE_TAP_FIELD			"be:tap"
+//!	Name of the field which only the events of the tablets have, see kTraitAbsolute.
+#define IGNORE_TABLET_FIELD			"be:tablet_x"
+
+//!	If the add-on needs more than this to start enforcing, it complains to the syslog.
+const bigtime_t	kStartupBudget = 5000;
+
+
+/**	\class		IgnoreTouchpadFilter
+ *	\brief		Drops the pointer events of the ignored devices.
+ *	\details	The ignore state is read in the constructor from the startup snapshot
+ *				(see \ref snapshot.h). input_server doesn't pass any events to the
+ *				filter before it's constructed, so the ignored devices are
+ *				silent from the very first event after boot.
+ *	\details	The filter also watches for the emergency chord (see EmergencyChord).
+ *				When it's pressed, the ignore set is cleared right away, in the
+ *				filter itself; restarting the stopped devices and saving the new
+ *				state is left to the worker thread, so the event path never
+ *				waits for the disk or for input_server.
+ *	\details	Devices ignored for a limited time are unignored by the worker
+ *				thread as well, driven by a single TimerWheel.
+ *	\details	Devices ignored while some applications are active are dropped
+ *				by the focus class the FocusTracker keeps in DeviceSlots.
+ *	\details	Traced changes (see Settings::SetTrace()) are followed up to the
+ *				first dropped event of their device. All the event path pays for
+ *				it is a compare of the slot with fTraceSlot.
+ */
+class DeviceControl;
+class FocusTracker;
+class Settings;
+class SnapshotWatcher;
+
+
+class IgnoreTouchpadFilter : public BInputServerFilter {
+public:
+	IgnoreTouchpadFilter();						//!<	\copydoc	IgnoreTouchpadFilter::IgnoreTouchpadFilter
+	virtual ~IgnoreTouchpadFilter();			//!<	\copydoc	IgnoreTouchpadFilter::~IgnoreTouchpadFilter
+
+	virtual status_t InitCheck();				//!<	\copydoc	IgnoreTouchpadFilter::InitCheck
+	//!	\copydoc	IgnoreTouchpadFilter::Filter
+	virtual filter_result Filter(BMessage* message, BList* outList);
+
+	//!	Time from the add-on load till the ignore state was applied, in microseconds.
+	bigtime_t StartupLatency() const { return fStartupLatency; }
+
+	void SnapshotChanged();						//!<	\copydoc	IgnoreTouchpadFilter::SnapshotChanged
+
+protected:
+	//!	Jobs for the worker thread, combined in fPendingJobs
+	enum {
+		kJobUnignoreAll		= 0x01,		//!<	Restart all devices and save the cleared state
+		kJobReloadSnapshot	= 0x02		//!<	Read the snapshot again and apply it
+	};
+
+	void UnignoreAll();								//!<	\copydoc	IgnoreTouchpadFilter::UnignoreAll
+	//!	\copydoc	IgnoreTouchpadFilter::ArmTimers
+	void ArmTimers(const IgnoreSnapshot* snapshot);
+	void ExpireTimers();							//!<	\copydoc	IgnoreTouchpadFilter::ExpireTimers
+	void SaveSettings(Settings& settings);			//!<	\copydoc	IgnoreTouchpadFilter::SaveSettings
+	//!	\copydoc	IgnoreTouchpadFilter::TraceApplied
+	void TraceApplied(const IgnoreSnapshot* snapshot, bigtime_t notified);
+	void TraceFirstDrop(int32 slot);				//!<	\copydoc	IgnoreTouchpadFilter::TraceFirstDrop
+	void PostJob(int32 job);						//!<	\copydoc	IgnoreTouchpadFilter::PostJob
+	static int32 WorkerThread(void* data);			//!<	\copydoc	IgnoreTouchpadFilter::WorkerThread
+
+	DeviceSlots		fSlots;				//!<	Currently enforced state, per device
+	EmergencyChord	fChord;				//!<	Detector of the "unignore all" chord
+	SharedCounters	fCounters;			//!<	Per-device counters, published for the CLI and GUI
+	TimerWheel		fTimers;			//!<	Ends of the timed ignores, owned by the worker
+	DeviceControl*	fControl;			//!<	Restarts the stopped devices, used by the worker
+	int32			fPendingJobs;		//!<	Jobs for the worker thread, accessed atomically
+	sem_id			fWorkerSem;			//!<	Released when a job is posted
+	thread_id		fWorker;			//!<	Does everything that may block
+	SnapshotWatcher*	fWatcher;		//!<	Tells when the snapshot was rewritten
+	FocusTracker*	fFocus;				//!<	Follows the active application
+	status_t		fSnapshotStatus;	//!<	Result of reading the snapshot at startup
+	bigtime_t		fLoadedAt;			//!<	`system_time()` when the constructor was entered
+	bigtime_t		fStartupLatency;	//!<	\see	IgnoreTouchpadFilter::StartupLatency
+	std::atomic<bigtime_t>	fSnapshotNotified;	//!<	When SnapshotChanged() was last called
+	uint32			fLastTraceId;		//!<	Correlation id of the last applied snapshot, worker only
+	int32			fTraceRecord;		//!<	Record of the SharedCounters for the first drop
+	std::atomic<int32>	fTraceSlot;		//!<	Slot whose next dropped event ends a trace, -1 if none
+};
+
+
+extern "C" _EXPORT BInputServerFilter* instantiate_input_filter();
+
+#endif // _IGNORE_FILTER_H_
+/** @} */ // end of AddonModule
@@ -0,0 +1,91 @@
+/*
+	Copyright 2025, Alexey "Hitech" Burshtein.   All Rights Reserved.
+	This file may be used under the terms of the MIT License.
+*/
+
+/**
+ * @file SnapshotWatcher.cpp
+ * @brief Implementation of the SnapshotWatcher class.
+ * @ingroup AddonModule
+ */
+
+#include "SnapshotWatcher.h"
+#include "IgnoreFilter.h"
+#include "snapshot.h"
+
+#include <Entry.h>
+#include <FindDirectory.h>
+#include <NodeMonitor.h>
+#include <Path.h>
+
+#include <string.h>
+
+
+/**	\brief		Constructor.
+ *	\param[in]	filter		The filter to be told about the new snapshots.
+ */
+SnapshotWatcher::SnapshotWatcher(IgnoreTouchpadFilter* filter)
+	:	BLooper("IgnoreTouchpad watcher", B_LOW_PRIORITY),
+		fFilter(filter),
+		fWatching(false)
+{
+}
+
+
+/**	\brief		Starts watching the settings directory.
+ *	\note		The looper must be running already.
+ */
+status_t
+SnapshotWatcher::StartWatching()
+{
+	if (fWatching) { return B_OK; }
+
+	BPath path;
+	status_t status = find_directory(B_USER_SETTINGS_DIRECTORY, &path);
+	if (B_OK != status) { return status; }
+
+	BEntry entry(path.Path());
+	status = entry.GetNodeRef(&fDirectory);
+	if (B_OK != status) { return status; }
+
+	status = watch_node(&fDirectory, B_WATCH_DIRECTORY, BMessenger(this));
+	fWatching = (B_OK == status);
+	return status;
+}
+
+
+/**	\brief		Stops watching the settings directory.
+ */
+void
+SnapshotWatcher::StopWatching()
+{
+	if (!fWatching) { return; }
+	watch_node(&fDirectory, B_STOP_WATCHING, BMessenger(this));
+	fWatching = false;
+}
+
+
+/**	\brief		Tells the filter when the snapshot file appears.
+ *	\param[in]	message		Node monitor message, or anything else.
+ */
+void
+SnapshotWatcher::MessageReceived(BMessage* message)
+{
+	if (message->what != B_NODE_MONITOR) {
+		BLooper::MessageReceived(message);
+		return;
+	}
+
+	int32 opcode;
+	const char* name;
+	if (B_OK != message->FindInt32("opcode", &opcode)
+		|| (opcode != B_ENTRY_CREATED && opcode != B_ENTRY_MOVED)
+		|| B_OK != message->FindString("name", &name))
+	{
+		return;
+	}
+
+	if (strcmp(name, IGNORE_SNAPSHOT_FILE_NAME) == 0) {
+		fFilter->SnapshotChanged();
+	}
+}
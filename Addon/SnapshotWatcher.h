@@ -0,0 +1,42 @@
+/*
+	Copyright 2025, Alexey "Hitech" Burshtein.   All Rights Reserved.
+	This file may be used under the terms of the MIT License.
+*/
+
+/**
+ * @file SnapshotWatcher.h
+ * @brief Notices when the startup snapshot is rewritten.
+ * @ingroup AddonModule
+ */
+
+#ifndef _SNAPSHOT_WATCHER_H_
+#define _SNAPSHOT_WATCHER_H_
+
+#include <Looper.h>
+#include <Node.h>
+
+class IgnoreTouchpadFilter;
+
+
+/**	\class		SnapshotWatcher
+ *	\brief		Looper that watches the settings directory for a new snapshot.
+ *	\details	The snapshot is replaced by renaming a temporary file over it, so
+ *				the directory is watched rather than the file itself. The watcher
+ *				only tells the filter; the filter's worker thread reads the file.
+ */
+class SnapshotWatcher : public BLooper {
+public:
+	//!	\copydoc	SnapshotWatcher::SnapshotWatcher
+	SnapshotWatcher(IgnoreTouchpadFilter* filter);
+
+	status_t StartWatching();						//!<	\copydoc	SnapshotWatcher::StartWatching
+	void StopWatching();							//!<	\copydoc	SnapshotWatcher::StopWatching
+	virtual void MessageReceived(BMessage* message);	//!<	\copydoc	SnapshotWatcher::MessageReceived
+
+protected:
+	IgnoreTouchpadFilter*	fFilter;		//!<	Who is told about the changes
+	node_ref				fDirectory;		//!<	The settings directory
+	bool					fWatching;		//!<	`true` if the node monitor is on
+};
+
+#endif // _SNAPSHOT_WATCHER_H_
@@ -0,0 +1,114 @@
+/*
+	Copyright 2025, Alexey "Hitech" Burshtein.   All Rights Reserved.
+	This file may be used under the terms of the MIT License.
+*/
+
+/**
+ * @file TimerWheel.cpp
+ * @brief Implementation of the TimerWheel class.
+ * @ingroup AddonModule
+ */
+
+#include "TimerWheel.h"
+
+
+/**	\brief		Constructor. The wheel is empty.
+ */
+TimerWheel::TimerWheel()
+{
+	Clear();
+}
+
+
+/**	\brief		Drops all deadlines.
+ */
+void
+TimerWheel::Clear()
+{
+	for (int32 i = 0; i < kTimerWheelSize; i++) { fBuckets[i] = -1; }
+	for (int32 i = 0; i < kMaxDeviceSlots; i++) {
+		fNext[i] = fPrevious[i] = fSlotBuckets[i] = -1;
+		fDeadlines[i] = 0;
+	}
+	fCount = 0;
+	fLastTick = -1;
+}
+
+
+/**	\brief		Sets the deadline of the slot, replacing the previous one.
+ *	\param[in]	slot		Slot of the device in DeviceSlots.
+ *	\param[in]	deadline	When the slot expires. A deadline in the past
+ *							expires with the next call to TimerWheel::Expire().
+ */
+void
+TimerWheel::Schedule(int32 slot, bigtime_t deadline)
+{
+	if (slot < 0 || slot >= kMaxDeviceSlots || deadline <= 0) { return; }
+	Cancel(slot);
+
+	// The buckets up to fLastTick are done for this turn
+	bigtime_t position = deadline;
+	if (fLastTick >= 0 && position / kTimerTick <= fLastTick) {
+		position = (fLastTick + 1) * kTimerTick;
+	}
+
+	int32 bucket = BucketOf(position);
+	fDeadlines[slot] = deadline;
+	fSlotBuckets[slot] = bucket;
+	fPrevious[slot] = -1;
+	fNext[slot] = fBuckets[bucket];
+	if (fNext[slot] >= 0) { fPrevious[fNext[slot]] = slot; }
+	fBuckets[bucket] = slot;
+	fCount++;
+}
+
+
+/**	\brief		Drops the deadline of the slot, if it has any.
+ */
+void
+TimerWheel::Cancel(int32 slot)
+{
+	if (slot < 0 || slot >= kMaxDeviceSlots || fDeadlines[slot] == 0) { return; }
+
+	if (fPrevious[slot] >= 0) {
+		fNext[fPrevious[slot]] = fNext[slot];
+	} else {
+		fBuckets[fSlotBuckets[slot]] = fNext[slot];
+	}
+	if (fNext[slot] >= 0) { fPrevious[fNext[slot]] = fPrevious[slot]; }
+
+	fNext[slot] = fPrevious[slot] = fSlotBuckets[slot] = -1;
+	fDeadlines[slot] = 0;
+	fCount--;
+}
+
+
+/**	\brief		Advances the wheel and collects the expired slots.
+ *	\param[in]	now			Current time, in the same clock as the deadlines.
+ *	\param[out]	expired		Receives the expired slots. Must have room for
+ *							kMaxDeviceSlots entries.
+ *	\returns	Number of the expired slots. Their deadlines are dropped.
+ */
+int32
+TimerWheel::Expire(bigtime_t now, int32* expired)
+{
+	bigtime_t nowTick = now / kTimerTick;
+	bigtime_t steps = (fLastTick < 0) ? kTimerWheelSize : nowTick - fLastTick;
+	if (steps > kTimerWheelSize) { steps = kTimerWheelSize; }
+
+	int32 count = 0;
+	for (bigtime_t step = steps - 1; step >= 0 && fCount > 0; step--) {
+		int32 bucket = (nowTick - step) % kTimerWheelSize;
+		int32 slot = fBuckets[bucket];
+		while (slot >= 0) {
+			int32 next = fNext[slot];
+			if (fDeadlines[slot] <= now) {
+				Cancel(slot);
+				expired[count++] = slot;
+			}
+			slot = next;
+		}
+	}
+	fLastTick = nowTick;
+	return count;
+}
@@ -0,0 +1,60 @@
+/*
+	Copyright 2025, Alexey "Hitech" Burshtein.   All Rights Reserved.
+	This file may be used under the terms of the MIT License.
+*/
+
+/**
+ * @file TimerWheel.h
+ * @brief Deadlines of the timed ignores.
+ * @ingroup AddonModule
+ */
+
+#ifndef _TIMER_WHEEL_H_
+#define _TIMER_WHEEL_H_
+
+#include "platform.h"
+
+#include "DeviceSlots.h"
+
+
+const int32		kTimerWheelSize = 64;		//!<	Number of buckets in the wheel
+const bigtime_t	kTimerTick = 1000000;		//!<	Time covered by a single bucket
+
+
+/**	\class		TimerWheel
+ *	\brief		Hashed timer wheel with at most one deadline per device slot.
+ *	\details	A deadline goes into the bucket of its tick, modulo the size of
+ *				the wheel; longer deadlines simply stay in their bucket for
+ *				several turns. Advancing the wheel looks only at the buckets of
+ *				the ticks that passed since the last time, so the worker thread
+ *				needs a single timer for all of the timed ignores.
+ *	\note		Not thread-safe: the wheel belongs to the worker thread.
+ */
+class TimerWheel {
+public:
+	TimerWheel();							//!<	\copydoc	TimerWheel::TimerWheel
+
+	void Clear();							//!<	\copydoc	TimerWheel::Clear
+	//!	\copydoc	TimerWheel::Schedule
+	void Schedule(int32 slot, bigtime_t deadline);
+	void Cancel(int32 slot);				//!<	\copydoc	TimerWheel::Cancel
+	//!	\copydoc	TimerWheel::Expire
+	int32 Expire(bigtime_t now, int32* expired);
+
+	//!	`true` if there are no deadlines, so the wheel needs no ticks.
+	bool IsEmpty() const { return fCount == 0; }
+
+protected:
+	//!	Bucket of the tick which contains the time.
+	static int32 BucketOf(bigtime_t time) { return (time / kTimerTick) % kTimerWheelSize; }
+
+	int32		fBuckets[kTimerWheelSize];		//!<	First slot in each bucket, -1 if none
+	int32		fNext[kMaxDeviceSlots];			//!<	Next slot in the same bucket, -1 if none
+	int32		fPrevious[kMaxDeviceSlots];		//!<	Previous slot in the same bucket, -1 if none
+	int32		fSlotBuckets[kMaxDeviceSlots];	//!<	Bucket of each scheduled slot
+	bigtime_t	fDeadlines[kMaxDeviceSlots];	//!<	Deadline of each slot, 0 if none
+	int32		fCount;							//!<	Number of scheduled deadlines
+	bigtime_t	fLastTick;						//!<	Last processed tick, -1 before the first one
+};
+
+#endif // _TIMER_WHEEL_H_
@@ -5,10 +5,25 @@
 
 
 #include "CLI.h"
+#include "Dashboard.h"
+#include "background_task.h"
+#include "counters.h"
+#include "device_control.h"
+#include "hotplug.h"
+#include "log.h"
+#include "settings.h"
+
 #include <Catalog.h>
 #include <Input.h>
 #include <List.h>
+#include <OS.h>
+#include <errno.h>
+#include <fnmatch.h>
+#include <limits.h>
+#include <signal.h>
 #include <stdio.h>
+#include <string.h>
+#include <algorithm>
 #include <iostream>
 #include <sstream>
 
@@ -17,47 +32,138 @@
 #define B_TRANSLATION_CONTEXT "Ignore Touchpad CLI"
 
 
-DeviceStructure::~DeviceStructure() {
-	if (device) { delete device; device = NULL; }
-}
+DeviceTable gDevices;
+
+
+// Wall time a whole invocation may take, enforced by "--timings"
+const bigtime_t kCommandBudget = 100000;
+
+static bool sTimingsEnabled = false;
+static bigtime_t sTimings[kTimingCount];
+static int32 sTimingCalls[kTimingCount];
+// When the current command was issued, the start of its trace
+static bigtime_t sCommandStarted = 0;
+static uint32 sTraceSerial = 0;
+static const char* const kTraceStageNames[kTraceStageCount] = {
+	"saved", "noticed", "applied", "first drop"
+};
+static const char* const kTimingNames[kTimingCount] = {
+	"process start (CPU)", "catalog load", "get_input_devices()",
+	"settings read (bg)", "settings load", "settings save", "device start/stop"
+};
+
+// The settings file, read while the devices are being listed
+static BackgroundTask* sSettingsPrefetch = NULL;
+static BMessage sPrefetchedSettings;
+static status_t sPrefetchStatus = B_NO_INIT;
 
 
 int main(int argc, char** argv) {
+	bigtime_t mainEntered = system_time();
+	sCommandStarted = mainEntered;
+	team_usage_info usage;
+	status_t usageStatus = get_team_usage_info(B_CURRENT_TEAM, B_TEAM_USAGE_SELF, &usage);
+
 	if (argc < 2) {
 		PrintUsage();
 		return 0;
 	}
 
 	std::vector<std::string> args(argv + 1, argv + argc);
-	ParsedCommand command = ParseCommand(args);
+	while (!args.empty() && args[0].compare(0, 2, "--") == 0) {
+		if (args[0] == "--timings") {
+			sTimingsEnabled = true;
+			args.erase(args.begin());
+		} else if (args[0] == "--log-level" && args.size() >= 2) {
+			log_level level;
+			if (!LogLevelFromString(args[1].c_str(), &level)) {
+				fprintf(stderr, B_TRANSLATE("Unknown log level '%s'.\n"), args[1].c_str());
+				return 1;
+			}
+			SetLogLevel(level);
+			args.erase(args.begin(), args.begin() + 2);
+		} else {
+			break;
+		}
+	}
 
-	Clean(&gDevices, true);
-	BuildListOfDevices();
+	// Nothing below depends on the settings, so the file is read meanwhile
+	BackgroundTask prefetch("settings prefetch", [] {
+		ScopedTiming timing(kTimingSettingsRead);
+		Settings reader;
+		sPrefetchStatus = reader.ReadFile(&sPrefetchedSettings);
+	});
+	sSettingsPrefetch = &prefetch;
+
+	if (sTimingsEnabled) {
+		if (B_OK == usageStatus) {
+			sTimings[kTimingStartup] = usage.user_time + usage.kernel_time;
+			sTimingCalls[kTimingStartup] = 1;
+		}
+		// The catalog is loaded by the first B_TRANSLATE, whichever it is
+		ScopedTiming timing(kTimingCatalog);
+		B_TRANSLATE("Connected pointing devices:\n");
+	}
+	ParsedCommand command = ParseCommand(args);
 
 	if (command.type == CommandType::kInteractive) {
+		// The commands may come much later, the file is read again for each
+		prefetch.Wait();
+		sPrefetchStatus = B_NO_INIT;
 		RunInteractiveLoop();
-		Clean(&gDevices, true);
+		PrintTimings(system_time() - mainEntered);
 		return 0;
 	}
 
-	Clean(&gDevices, true);
-	return ExecuteCommand(command);
+	// The devices are listed here, while the settings file is still being read
+	status_t result = ExecuteCommand(command);
+	LogFlush();
+	prefetch.Wait();
+	bigtime_t total = system_time() - mainEntered;
+	PrintTimings(total);
+	if (sTimingsEnabled && B_OK == result && total > kCommandBudget) {
+		return 2;
+	}
+	return result;
 }
 
 
-void Clean(BList *in, bool cleaningGDevices = false) {
-	if (!in) return;
-	uint count = in->CountItems();
-	for (int32 i = count-1; i >=0; i--) {
-		if (cleaningGDevices) {
-			DeviceStructure* delStr = static_cast<DeviceStructure*>(in->ItemAt(i));
-//			delete delStr;
-		} else {
-			BInputDevice* delDev = static_cast<BInputDevice*>(in->ItemAt(i));
-//			delete delDev;
-		}
+ScopedTiming::ScopedTiming(TimingPhase phase)
+	: fPhase(phase),
+	  fStart(sTimingsEnabled ? system_time() : 0)
+{
+}
+
+
+ScopedTiming::~ScopedTiming() {
+	if (!sTimingsEnabled) return;
+	sTimings[fPhase] += system_time() - fStart;
+	sTimingCalls[fPhase]++;
+}
+
+
+/**	\brief		Prints where the time of the invocation went, if "--timings" was given.
+ *	\param[in]	total	Wall time since main() was entered.
+ *	\details	All times come from system_time(), which is monotonic. The phases
+ *				don't cover everything, the rest is printed as "other".
+ *	\details	The settings file is read in the background, that time overlaps
+ *				with the others and isn't a part of "other"; the time main() had
+ *				to wait for it is a part of "settings load".
+ */
+void PrintTimings(bigtime_t total) {
+	if (!sTimingsEnabled) return;
+	bigtime_t covered = 0;
+	fprintf(stderr, B_TRANSLATE("Timings:\n"));
+	for (int32 i = 0; i < kTimingCount; i++) {
+		fprintf(stderr, "  %-22s %8lld us  (%d)\n", kTimingNames[i],
+			(long long)sTimings[i], (int)sTimingCalls[i]);
+		if (i != kTimingStartup && i != kTimingSettingsRead) covered += sTimings[i];
+	}
+	fprintf(stderr, "  %-22s %8lld us\n", "other", (long long)(total - covered));
+	fprintf(stderr, "  %-22s %8lld us\n", "total since main()", (long long)total);
+	if (total > kCommandBudget) {
+		fprintf(stderr, B_TRANSLATE("Over the budget of %lld us!\n"), (long long)kCommandBudget);
 	}
-	in->MakeEmpty();
 }
 
 
@@ -78,11 +184,32 @@ void RunInteractiveLoop() {
 		if (command.type == CommandType::kQuit)
 			break;
 
+		sCommandStarted = system_time();
 		ExecuteCommand(command);
+		LogFlush();
 	}
 }
 
 
+// Returns the device_class with the name, or -1 if there's none
+static int ParseDeviceClass(const std::string& name) {
+	device_class deviceClass;
+	return DeviceClassFromString(name.c_str(), &deviceClass) ? deviceClass : -1;
+}
+
+
+// Returns the device number in the text, or -1 if it isn't one. Never throws,
+// so a typo in interactive mode only prints the usage.
+static int ParseDeviceNumber(const std::string& text) {
+	char* end = NULL;
+	errno = 0;
+	long number = strtol(text.c_str(), &end, 10);
+	if (end == text.c_str() || *end != '\0' || errno == ERANGE || number < 0 || number > INT_MAX)
+		return -1;
+	return (int)number;
+}
+
+
 ParsedCommand ParseCommand(const std::vector<std::string>& args) {
     ParsedCommand cmd;
 
@@ -93,21 +220,100 @@ ParsedCommand ParseCommand(const std::vector<std::string>& args) {
 
     const std::string& action = args[0];
 
+    // "--class <name>" stands in for the device number of these
+    bool byClass = args.size() >= 3 && args[1] == "--class";
+    size_t selectorEnd = byClass ? 3 : 2;
+
     if (action == "list") {
         cmd.type = CommandType::kList;
+        if (byClass) cmd.deviceClass = ParseDeviceClass(args[2]);
+        if (args.size() == 2 || (byClass && (args.size() != 3 || cmd.deviceClass < 0)))
+            cmd.type = CommandType::kUnknown;
     } else if ((action == "enable" || action == "e" || action == "E")
-               && args.size() == 2) {
+               && args.size() == selectorEnd) {
         cmd.type = CommandType::kEnable;
-        cmd.deviceNumber = std::stoi(args[1]);
+        if (byClass) cmd.deviceClass = ParseDeviceClass(args[2]);
+        else cmd.deviceNumber = ParseDeviceNumber(args[1]);
+        if (byClass ? cmd.deviceClass < 0 : cmd.deviceNumber < 0) cmd.type = CommandType::kUnknown;
     } else if ((action == "disable" || action == "d" || action == "D")
-               && args.size() == 2) {
+               && (args.size() == selectorEnd
+                   || (args.size() == selectorEnd + 2 && args[selectorEnd] == "--for"))) {
         cmd.type = CommandType::kDisable;
-        cmd.deviceNumber = std::stoi(args[1]);
+        if (byClass) cmd.deviceClass = ParseDeviceClass(args[2]);
+        else cmd.deviceNumber = ParseDeviceNumber(args[1]);
+        if (args.size() == selectorEnd + 2) cmd.argument = args[selectorEnd + 1];
+        if (byClass ? cmd.deviceClass < 0 : cmd.deviceNumber < 0) cmd.type = CommandType::kUnknown;
     } else if (action == "enable_all" || action == "ea" || action == "EA") {
         cmd.type = CommandType::kEnableAll;
         cmd.deviceNumber = 0;
     } else if (action == "help" || action == "?") {
         cmd.type = CommandType::kHelp;
+    } else if (action == "chord" && args.size() == 2) {
+        cmd.type = CommandType::kChord;
+        cmd.argument = args[1];
+    } else if (action == "hotplug" && args.size() == 2) {
+        cmd.type = CommandType::kHotplug;
+        cmd.argument = args[1];
+    } else if (action == "auto" && (args.size() == 3 || args.size() == 4)) {
+        cmd.type = CommandType::kAuto;
+        cmd.deviceNumber = ParseDeviceNumber(args[1]);
+        if (args[2] != "off") {
+            cmd.otherDeviceNumber = ParseDeviceNumber(args[2]);
+            if (args.size() == 4) cmd.argument = args[3];
+        }
+        if (cmd.deviceNumber < 0 || (args[2] != "off" && cmd.otherDeviceNumber < 0))
+            cmd.type = CommandType::kUnknown;
+    } else if (action == "mask" && args.size() == 3) {
+        cmd.type = CommandType::kMask;
+        cmd.deviceNumber = ParseDeviceNumber(args[1]);
+        cmd.argument = args[2];
+        if (cmd.deviceNumber < 0) cmd.type = CommandType::kUnknown;
+    } else if (action == "focus" && args.size() == 3) {
+        cmd.type = CommandType::kFocus;
+        cmd.deviceNumber = ParseDeviceNumber(args[1]);
+        cmd.argument = args[2];
+        if (cmd.deviceNumber < 0) cmd.type = CommandType::kUnknown;
+    } else if (action == "strategy" && (args.size() == 1 || args.size() == 3)) {
+        cmd.type = CommandType::kStrategy;
+        if (args.size() == 3) {
+            cmd.deviceNumber = ParseDeviceNumber(args[1]);
+            cmd.argument = args[2];
+            if (cmd.deviceNumber < 0) cmd.type = CommandType::kUnknown;
+        }
+    } else if (action == "measure" && (args.size() == 2 || args.size() == 3)) {
+        cmd.type = CommandType::kMeasure;
+        cmd.deviceNumber = ParseDeviceNumber(args[1]);
+        if (args.size() == 3) cmd.argument = args[2];
+        if (cmd.deviceNumber < 0) cmd.type = CommandType::kUnknown;
+    } else if (action == "profile" && args.size() <= 3) {
+        cmd.type = CommandType::kProfile;
+        if (args.size() == 3 && args[1] == "save") {
+            cmd.type = CommandType::kProfileSave;
+            cmd.argument = args[2];
+        } else if (args.size() == 3 && args[1] == "delete") {
+            cmd.type = CommandType::kProfileDelete;
+            cmd.argument = args[2];
+        } else if (args.size() == 2) {
+            cmd.argument = args[1];
+        } else if (args.size() == 3) {
+            cmd.type = CommandType::kUnknown;
+        }
+    } else if (action == "stats") {
+        cmd.type = CommandType::kStats;
+    } else if (action == "top") {
+        cmd.type = CommandType::kTop;
+    } else if (action == "trace-latency" && args.size() <= 2) {
+        cmd.type = CommandType::kTraceLatency;
+        if (args.size() == 2) cmd.argument = args[1];
+    } else if (action == "wait" && (args.size() == 3 || (args.size() == 5 && args[3] == "--timeout"))) {
+        cmd.type = CommandType::kWait;
+        cmd.condition = args[1].compare(0, 2, "--") == 0 ? args[1].substr(2) : "";
+        cmd.argument = args[2];
+        if (args.size() == 5) cmd.timeout = ParseDuration(args[4]);
+        if ((cmd.condition != "connected" && cmd.condition != "disconnected"
+                && cmd.condition != "ignored" && cmd.condition != "enabled")
+            || (args.size() == 5 && cmd.timeout == 0))
+            cmd.type = CommandType::kUnknown;
     } else if (action == "interactive") {
         cmd.type = CommandType::kInteractive;
     } else if (action == "refresh") {
@@ -122,72 +328,115 @@ ParsedCommand ParseCommand(const std::vector<std::string>& args) {
 }
 
 
+/**	\brief		Returns the platform's way of starting and stopping the devices.
+ */
+static DeviceControl* GetDeviceControl() {
+	static DeviceControl* control = DeviceControl::Create();
+	return control;
+}
+
+
 void BuildListOfDevices() {
-	Clean(&gDevices, true);
-	BList devices;
-    status_t err = get_input_devices(&devices);
-    if (err != B_OK) {
-        fprintf(stderr, "[BuildListOfDevices] Failed to get input devices: %s\n", strerror(err));
-    }
-    
-    int count = devices.CountItems();
-    for (int32 i = count - 1; i >= 0; i--) {
-        BInputDevice* info = static_cast<BInputDevice*>(devices.ItemAt(i));
-        if (!info || info->Type() != B_POINTING_DEVICE) {
-        	devices.RemoveItem(i);
-        	delete info;
-        }
-    }
-    
-    count = devices.CountItems();
-    for (uint i = 0; i < count; i++) {
-    	DeviceStructure* device = new DeviceStructure();
-    	device->device = static_cast<BInputDevice*>(devices.ItemAt(i));
-    	device->enabled = device->device->IsRunning();
-    	device->number = i;
-    	gDevices.AddItem(device, i);
-    }
-    
-    Clean(&devices, false);
+	ScopedTiming timing(kTimingGetDevices);
+	gDevices.Refresh(GetDeviceControl());
 }
 
-void ListDevices() {
-	BuildListOfDevices();
-	
+/**	\brief		Fills DeviceEntry::deviceClass of the connected devices.
+ *	\param[in]	settings	The loaded settings, which cache the classes.
+ *	\details	A device is classified by its name the first time it's seen,
+ *				and again once the add-on saw it tap or report an absolute
+ *				position. The traits are looked up by fingerprint, so identical
+ *				devices don't share them.
+ *	\note		Nothing is saved here, so "list" never rewrites the settings and
+ *				wakes the add-on up. The commands which change something save
+ *				the classes along with their change.
+ */
+void ClassifyDevices(Settings& settings) {
+	SharedCounters counters;
+	const CountersArea* area = (B_OK == counters.Map()) ? counters.Area() : NULL;
+
+	for (int32 i = 0; i < gDevices.CountItems(); i++) {
+		DeviceEntry* dev = gDevices.ItemAt(i);
+		uint32 traits = 0;
+		int32 slot = area ? counters.FindDevice(dev->fingerprint) : -1;
+		if (slot >= 0) traits = area->devices[slot].traits.load(std::memory_order_relaxed);
+		dev->deviceClass = settings.Classify(dev->name, dev->ordinal, traits, NULL);
+	}
+}
+
+
+void ListDevices(int deviceClass) {
     int32 count = 0;
     count = gDevices.CountItems();
 
+	Settings settings;
+	LoadSettings(settings);
+	ClassifyDevices(settings);
+
 	if (count) printf("Connected pointing devices:\n");
     for (int32 i = 0; i < count; i++) {
-    	DeviceStructure* dev = (DeviceStructure*)gDevices.ItemAt(i);
+    	DeviceEntry* dev = gDevices.ItemAt(i);
+    	if (deviceClass >= 0 && dev->deviceClass != deviceClass) continue;
     	
-        printf(" %d. %s - %s\n", dev->number,
-        			 dev->device->Name(),
-            		(dev->enabled ? "enabled" : "disabled"));
+        // Identical devices are told apart by their fingerprints
+        BString name(dev->name);
+        if (dev->ordinal > 0) name << " (" << dev->ordinal + 1 << ")";
+        printf(" %d. %s [%016llx] %s - %s\n", dev->number,
+        			 name.String(),
+        			 (unsigned long long)dev->fingerprint,
+        			 kDeviceClassNames[dev->deviceClass],
+            		(dev->running && !settings.GetStatus(dev->name, dev->ordinal)
+            			? "enabled" : "disabled"));
     }
+
+	// The settings also remember devices which are not connected now
+	ConnectedDevice connected[kMaxDeviceHistory];
+	size_t connectedCount = 0;
+	for (int32 i = 0; i < count && connectedCount < (size_t)kMaxDeviceHistory; i++) {
+		DeviceEntry* dev = gDevices.ItemAt(i);
+		connected[connectedCount++].SetTo(dev->name, dev->ordinal, dev->fingerprint);
+	}
+	bool header = false;
+	for (const MergedDevice& device : settings.GetMergedListOfDevices(connected, connectedCount)) {
+		if (device.connected || !device.stored->HasPolicy()) { continue; }
+		if (deviceClass >= 0 && device.stored->Class != deviceClass) { continue; }
+		if (!header) {
+			printf(B_TRANSLATE("Remembered devices, not connected now:\n"));
+			header = true;
+		}
+		printf("    %s [%016llx] %s - %s\n", device.name, (unsigned long long)device.fingerprint,
+			kDeviceClassNames[device.stored->Class],
+			(device.IsIgnored() ? "disabled" : "enabled"));
+	}
 }
 
 
-status_t EnableDevice(BInputDevice* dev) {
+status_t EnableDevice(DeviceEntry* dev) {
 	status_t toReturn = B_OK;
 	if (dev) {
-		toReturn = dev->Start();
+		ScopedTiming timing(kTimingDeviceControl);
+		toReturn = GetDeviceControl()->Release(dev->name);
 		if (B_OK != toReturn) {
 			fprintf(stderr, B_TRANSLATE("[EnableDevice] Error enabling device \'%s\': %s\n"),
-					dev->Name(), strerror(toReturn));
+					dev->name, strerror(toReturn));
+		} else {
+			dev->running = true;
 		}
 	}
 	return toReturn;
 }
 
 
-status_t DisableDevice(BInputDevice* dev) {
+status_t DisableDevice(DeviceEntry* dev) {
 	status_t toReturn = B_OK;
 	if (dev) {
-		toReturn = dev->Stop();
+		ScopedTiming timing(kTimingDeviceControl);
+		toReturn = GetDeviceControl()->Suppress(dev->name);
 		if (B_OK != toReturn) {
 			fprintf(stderr, B_TRANSLATE("[DisableDevice] Error disabling device \'%s\': %s\n"),
-					dev->Name(), strerror(toReturn));
+					dev->name, strerror(toReturn));
+		} else {
+			dev->running = false;
 		}
 	}
 	return toReturn;
@@ -196,15 +445,810 @@ status_t DisableDevice(BInputDevice* dev) {
 
 
 status_t EnableAll() {
-	status_t toReturn = BInputDevice::Start(B_POINTING_DEVICE);
+	status_t toReturn;
+	{
+		ScopedTiming timing(kTimingDeviceControl);
+		toReturn = GetDeviceControl()->ReleaseAll();
+	}
 	if (B_OK != toReturn) {
 		fprintf(stderr, B_TRANSLATE("[EnableAll] Error enabling all devices: %s\n"),
 					strerror(toReturn));
 	}
+	Settings settings;
+	LoadSettings(settings);
+	for (int32 i = 0; i < gDevices.CountItems(); i++) {
+		DeviceEntry* dev = gDevices.ItemAt(i);
+		if (settings.GetStrategy(dev->name, dev->ordinal) == kStrategyThrottle)
+			ThrottleDevice(dev, false);
+	}
+	settings.ClearAllIgnored();
+	SaveSettings(settings);
 	return toReturn;
 }
 
 
+/**	\brief		Asks the driver of the device to stop reporting, or to go on.
+ *	\returns	B_OK, or the error of the driver; stock drivers refuse it.
+ */
+status_t ThrottleDevice(DeviceEntry* dev, bool throttled) {
+	ScopedTiming timing(kTimingDeviceControl);
+	status_t status = GetDeviceControl()->Throttle(dev->name, throttled);
+	if (B_OK != status) {
+		LOG_INFO("CLI", "Could not %s \"%s\": %s", throttled ? "throttle" : "unthrottle",
+			dev->name, strerror(status));
+	}
+	return status;
+}
+
+
+/**	\brief		Stops, throttles or starts the device as its status and strategy say.
+ *	\param[in]	settings	The settings with the status of the device, already saved.
+ *	\details	The add-on drops the events of an ignored device in any case,
+ *				this only keeps them from being produced. A device which isn't
+ *				ignored, or is ignored by kStrategyFilter, is started if it's
+ *				stopped. If the driver refuses to be throttled, the device is
+ *				left to the add-on, and only a warning is printed.
+ *	\details	A device with the same name as another connected one is always
+ *				left to the add-on: stopping or throttling it by its name could
+ *				reach the other one instead.
+ *	\see		DeviceInfo::EffectiveStrategy
+ */
+status_t ApplyStrategy(DeviceEntry* dev, Settings& settings) {
+	bool ignored = settings.GetStatus(dev->name, dev->ordinal);
+	suppress_strategy strategy = settings.GetEffectiveStrategy(dev->name, dev->ordinal);
+	// The device control goes by the name, and would silence the twins as well
+	if (dev->duplicate) strategy = kStrategyFilter;
+
+	if (strategy == kStrategyStop)
+		return dev->running ? DisableDevice(dev) : B_OK;
+
+	status_t status = dev->running ? B_OK : EnableDevice(dev);
+	if (!dev->duplicate && settings.GetStrategy(dev->name, dev->ordinal) == kStrategyThrottle
+		&& B_OK != ThrottleDevice(dev, ignored) && ignored)
+	{
+		fprintf(stderr, B_TRANSLATE("[Strategy] The driver of \'%s\' can't be throttled, "
+									"only the add-on drops its events.\n"), dev->name);
+	}
+	return status;
+}
+
+
+/**	\brief		Saves the settings, updating which devices are connected first.
+ *	\param[in]	tracedDevice	The device the change is about, its first dropped
+ *								event ends the trace. May be `NULL`.
+ *	\details	This keeps DeviceInfo::LastSeen fresh, so the device history is
+ *				compacted by the real age of the devices.
+ *	\details	The change is traced through the add-on, see "trace-latency".
+ */
+void SaveSettings(Settings& settings, const DeviceEntry* tracedDevice) {
+	std::vector<BString> names;
+	uint count = gDevices.CountItems();
+	for (uint i = 0; i < count; i++) {
+		names.push_back(gDevices.ItemAt(i)->name);
+	}
+	settings.MarkConnected(names);
+	// Unique enough to tell the changes apart, and never 0
+	uint32 traceId = ((uint32)real_time_clock_usecs() & ~0xffU) | (++sTraceSerial & 0xff);
+	settings.SetTrace(traceId ? traceId : 1, sCommandStarted,
+		tracedDevice ? tracedDevice->fingerprint : 0);
+	ScopedTiming timing(kTimingSettingsSave);
+	settings.Save();
+}
+
+
+/**	\brief		Loads the settings, accounting the time for "--timings".
+ *	\details	The first load of a command takes the file read in the background
+ *				by main(), waiting for it if it's not there yet. The others read
+ *				the file again, as it may have been saved since.
+ */
+void LoadSettings(Settings& settings) {
+	ScopedTiming timing(kTimingSettingsLoad);
+	if (sSettingsPrefetch) {
+		sSettingsPrefetch->Wait();
+		sSettingsPrefetch = NULL;
+		if (B_OK == sPrefetchStatus) {
+			settings.Load(&sPrefetchedSettings);
+			return;
+		}
+	}
+	settings.Load();
+}
+
+
+/**	\brief		Stores the new status of the devices in the settings file.
+ *	\param[in]	settings	The loaded settings, which are changed and saved.
+ *	\param[in]	devices		The devices, e.g. all of a class. The first one is traced.
+ *	\param[in]	until		If not 0, `real_time_clock_usecs()` when the add-on
+ *							unignores the devices by itself.
+ *	\details	All devices are changed before the file is saved once, so the
+ *				add-on reloads the snapshot once, whatever their number.
+ *	\details	The add-on restores the stored status at boot, so the devices
+ *				stay ignored after reboot.
+ */
+void PersistStatus(Settings& settings, const std::vector<DeviceEntry*>& devices, bool ignored,
+	bigtime_t until) {
+	if (devices.empty()) return;
+	for (const DeviceEntry* dev : devices) {
+		if (ignored && until != 0)
+			settings.SetIgnoredUntil(dev->name, until, dev->ordinal);
+		else
+			settings.SetStatus(dev->name, ignored, dev->ordinal);
+	}
+	SaveSettings(settings, devices.front());
+}
+
+
+/**	\brief		Parses a duration such as "90s", "30m" or "2h".
+ *	\returns	The duration in microseconds, or 0 if it can't be parsed.
+ *	\note		A number without a suffix is taken as minutes.
+ */
+bigtime_t ParseDuration(const std::string& text) {
+	char* end = NULL;
+	long long value = strtoll(text.c_str(), &end, 10);
+	if (end == text.c_str() || value <= 0) return 0;
+
+	bigtime_t unit = 60000000LL;
+	if (strcmp(end, "s") == 0)		unit = 1000000LL;
+	else if (strcmp(end, "h") == 0)	unit = 3600000000LL;
+	else if (strcmp(end, "m") != 0 && *end != '\0') return 0;
+	return value * unit;
+}
+
+
+/**	\brief		Sets how long the hotplug-driven work waits for the devices to settle.
+ *	\param[in]	text	The hysteresis in milliseconds, "0" or "off" to react
+ *						to every notification.
+ *	\note		The replicant and the running "top" and "wait" pick it up
+ *				from the settings notification.
+ */
+status_t SetHotplugHysteresis(const std::string& text) {
+	char* end = NULL;
+	errno = 0;
+	long long milliseconds = text == "off" ? 0 : strtoll(text.c_str(), &end, 10);
+	if (text != "off" && (end == text.c_str() || *end != '\0' || milliseconds < 0
+			|| errno == ERANGE)) {
+		fprintf(stderr, B_TRANSLATE("[Hotplug] Can't understand the time \'%s\'.\n"), text.c_str());
+		return B_BAD_VALUE;
+	}
+	if (milliseconds > kMaxHotplugHysteresis / 1000) {
+		fprintf(stderr, B_TRANSLATE("[Hotplug] The hysteresis can't be longer than %lld ms.\n"),
+			(long long)(kMaxHotplugHysteresis / 1000));
+		return B_BAD_VALUE;
+	}
+
+	Settings settings;
+	LoadSettings(settings);
+	settings.SetHotplugHysteresis(milliseconds * 1000);
+	SaveSettings(settings);
+	return B_OK;
+}
+
+
+/**	\brief		Stores the emergency "unignore all" chord for the add-on.
+ *	\param[in]	spec	Modifiers and a key joined with '+', e.g. "ctrl+alt+win+e",
+ *						or "off" to disable the chord.
+ *	\note		The add-on notices the new snapshot and switches to the new chord.
+ */
+status_t SetEmergencyChord(const std::string& spec) {
+	uint32 modifiers = 0;
+	uint32 key = 0;
+
+	if (spec != "off") {
+		std::istringstream iss(spec);
+		std::string token;
+		while (std::getline(iss, token, '+')) {
+			if (token == "ctrl")						modifiers |= B_CONTROL_KEY;
+			else if (token == "alt" || token == "cmd")	modifiers |= B_COMMAND_KEY;
+			else if (token == "win" || token == "opt")	modifiers |= B_OPTION_KEY;
+			else if (token == "shift")					modifiers |= B_SHIFT_KEY;
+			else if (token == "menu")					modifiers |= B_MENU_KEY;
+			else if (token.size() == 1 && key == 0)		key = (unsigned char)token[0];
+			else {
+				fprintf(stderr, B_TRANSLATE("[Chord] Unknown key \'%s\'.\n"), token.c_str());
+				return B_BAD_VALUE;
+			}
+		}
+		if (key == 0 || modifiers == 0) {
+			fprintf(stderr, B_TRANSLATE("[Chord] The chord needs at least one modifier and one key.\n"));
+			return B_BAD_VALUE;
+		}
+	}
+
+	Settings settings;
+	LoadSettings(settings);
+	settings.SetEmergencyChord(modifiers, key);
+	SaveSettings(settings);
+	return B_OK;
+}
+
+
+/**	\brief		Prints the per-device event counters published by the add-on.
+ *	\details	The counters are read straight from the shared area, the add-on
+ *				isn't asked anything.
+ */
+status_t PrintStatistics() {
+	SharedCounters counters;
+	status_t status = counters.Map();
+	if (B_OK != status) {
+		fprintf(stderr, B_TRANSLATE("[Stats] Could not read the counters, is the add-on running? %s\n"),
+				strerror(status));
+		return status;
+	}
+
+	const CountersArea* area = counters.Area();
+	int32 count = area->deviceCount.load(std::memory_order_acquire);
+	bigtime_t now = system_time();
+
+	if (count) printf(B_TRANSLATE("Events seen by the add-on since boot:\n"));
+	for (int32 i = 0; i < count; i++) {
+		const DeviceCounters& device = area->devices[i];
+		int64 dropped = 0;
+		for (int32 reason = 0; reason < kDropReasonCount; reason++)
+			dropped += device.dropped[reason].load(std::memory_order_relaxed);
+
+		printf(B_TRANSLATE(" %s - seen %lld, passed %lld, dropped %lld, last active %.1f s ago\n"),
+				device.name,
+				(long long)device.seen.load(std::memory_order_relaxed),
+				(long long)device.passed.load(std::memory_order_relaxed),
+				(long long)dropped,
+				(now - device.lastActivity.load(std::memory_order_relaxed)) / 1000000.0);
+	}
+	return B_OK;
+}
+
+
+/**	\brief		Prints how long the traced changes took to reach the add-on.
+ *	\param[in]	slo		If not empty, the time in ms the changes should be applied within.
+ *	\details	Each stage is timed from the moment the command was issued. A
+ *				device stopped by its strategy sends no more events, so its
+ *				trace usually ends at "applied"; "first drop" comes from the
+ *				devices which stay running, e.g. the filtered ones or those set
+ *				up by "mask" or "auto".
+ */
+status_t PrintTraceLatency(const std::string& slo) {
+	bigtime_t sloTime = 0;
+	if (!slo.empty()) {
+		sloTime = strtoll(slo.c_str(), NULL, 10) * 1000;
+		if (sloTime <= 0) {
+			fprintf(stderr, B_TRANSLATE("[Trace] The time must be positive.\n"));
+			return B_BAD_VALUE;
+		}
+	}
+
+	SharedCounters counters;
+	status_t status = counters.Map();
+	if (B_OK != status) {
+		fprintf(stderr, B_TRANSLATE("[Trace] Could not read the traces, is the add-on running? %s\n"),
+				strerror(status));
+		return status;
+	}
+
+	const CountersArea* area = counters.Area();
+	uint32 total = area->traceCount.load(std::memory_order_acquire);
+	std::vector<bigtime_t> latencies[kTraceStageCount];
+	int32 withinSlo = 0, traces = 0;
+	for (int32 i = 0; i < kMaxTraces && (uint32)i < total; i++) {
+		const TraceRecord& record = area->traces[i];
+		uint32 id = record.id.load(std::memory_order_acquire);
+		if (id == 0) continue;
+		bigtime_t started = record.started;
+		bigtime_t stages[kTraceStageCount];
+		for (int32 stage = 0; stage < kTraceStageCount; stage++)
+			stages[stage] = record.stages[stage].load(std::memory_order_relaxed);
+		// Rewritten by the add-on while it was read
+		if (record.id.load(std::memory_order_acquire) != id || started == 0) continue;
+
+		traces++;
+		for (int32 stage = 0; stage < kTraceStageCount; stage++) {
+			if (stages[stage] >= started) latencies[stage].push_back(stages[stage] - started);
+		}
+		if (stages[kTraceApplied] >= started && stages[kTraceApplied] - started <= sloTime)
+			withinSlo++;
+	}
+
+	if (traces == 0) {
+		printf(B_TRANSLATE("No traced changes yet.\n"));
+		return B_OK;
+	}
+
+	printf(B_TRANSLATE("Last %d changes, ms since the command was issued:\n"), (int)traces);
+	printf("  %-12s %5s %9s %9s %9s %9s\n", "", "n", "p50", "p90", "p99", "max");
+	for (int32 stage = 0; stage < kTraceStageCount; stage++) {
+		std::vector<bigtime_t>& values = latencies[stage];
+		printf("  %-12s %5d", kTraceStageNames[stage], (int)values.size());
+		if (values.empty()) {
+			printf("\n");
+			continue;
+		}
+		std::sort(values.begin(), values.end());
+		for (double percentile : { 0.5, 0.9, 0.99, 1.0 }) {
+			// Nearest rank
+			size_t rank = (size_t)(percentile * values.size() + 0.999999);
+			printf(" %9.2f", values[std::max<size_t>(rank, 1) - 1] / 1000.0);
+		}
+		printf("\n");
+	}
+	if (sloTime > 0) {
+		printf(B_TRANSLATE("Applied within %lld ms: %d of %d (%.1f%%)\n"), (long long)(sloTime / 1000),
+			(int)withinSlo, (int)traces, 100.0 * withinSlo / traces);
+	}
+	return B_OK;
+}
+
+
+// Checks the condition of "wait" against the connected devices and the settings
+static bool ConditionHolds(const ParsedCommand& command, const Settings& settings) {
+	const char* pattern = command.argument.c_str();
+	bool found = false;
+	if (command.condition == "connected" || command.condition == "disconnected") {
+		for (int32 i = 0; i < gDevices.CountItems() && !found; i++) {
+			DeviceEntry* dev = gDevices.ItemAt(i);
+			found = fnmatch(pattern, dev->name, 0) == 0;
+		}
+		return command.condition == "connected" ? found : !found;
+	}
+
+	for (const DeviceInfo& device : settings.GetDevices()) {
+		if (device.IsIgnored && fnmatch(pattern, device.DeviceName.String(), 0) == 0) {
+			found = true;
+			break;
+		}
+	}
+	return command.condition == "ignored" ? found : !found;
+}
+
+
+/**	\brief		Blocks until a device matching the pattern is connected, ignored, etc.
+ *	\details	`wait --connected "*Logitech*" --timeout 10s` returns as soon as a
+ *				matching device is connected. `--disconnected` waits until none
+ *				is, `--ignored` until one is ignored, `--enabled` until none is.
+ *				The pattern is matched against the device names as in the shell.
+ *	\details	The thread sleeps on a semaphore, released only by the hotplug
+ *				and the settings notifications, so no CPU is used while waiting.
+ *	\returns	B_OK if the condition holds, B_TIMED_OUT if the time is up.
+ */
+status_t WaitForCondition(const ParsedCommand& command) {
+	sem_id wakeUp = create_sem(0, "IgnoreTouchpad wait");
+	if (wakeUp < B_OK) return wakeUp;
+
+	ChangeLooper* looper = new ChangeLooper(wakeUp);
+	looper->Run();
+	BMessenger messenger(looper);
+	Settings settings;
+	settings.AddSubscriber(messenger, kChangeStatus);
+	settings.StartMonitoring();
+	watch_input_devices(messenger, true);
+
+	// Looked at after subscribing, so that no change is missed in between;
+	// the file read in the background by main() may be older than that
+	BuildListOfDevices();
+	settings.Load();
+	looper->SetHotplugHysteresis(settings.HotplugHysteresis());
+
+	bigtime_t deadline = command.timeout > 0 ? system_time() + command.timeout : B_INFINITE_TIMEOUT;
+	status_t status = B_OK;
+	while (!ConditionHolds(command, settings)) {
+		status = acquire_sem_etc(wakeUp, 1, B_ABSOLUTE_TIMEOUT, deadline);
+		if (B_OK != status) break;
+		if (looper->TakeDevicesChanged()) BuildListOfDevices();
+		while (BMessage* change = looper->TakeSettingsChange()) {
+			settings.ApplyChanges(change);
+			delete change;
+		}
+	}
+
+	watch_input_devices(messenger, false);
+	settings.StopMonitoring();
+	if (looper->Lock()) looper->Quit();
+	delete_sem(wakeUp);
+
+	if (B_TIMED_OUT == status)
+		fprintf(stderr, B_TRANSLATE("[Wait] Timed out.\n"));
+	return status;
+}
+
+
+/**	\brief		Makes the add-on ignore a device while another one is in active use.
+ *	\details	`auto N M [ms]` ignores device N while device M produced an event
+ *				within the last `ms` milliseconds. `auto N off` removes the policy.
+ */
+status_t SetAutoIgnore(const ParsedCommand& command) {
+	// The number of a device is its index in the table
+	DeviceEntry* device = gDevices.ItemAt(command.deviceNumber);
+	DeviceEntry* trigger = gDevices.ItemAt(command.otherDeviceNumber);
+	if (!device || (command.otherDeviceNumber >= 0 && !trigger)) {
+		fprintf(stderr, B_TRANSLATE("[Auto] No such device.\n"));
+		return B_BAD_VALUE;
+	}
+	if (device == trigger) {
+		fprintf(stderr, B_TRANSLATE("[Auto] A device can't suppress itself.\n"));
+		return B_BAD_VALUE;
+	}
+
+	bigtime_t window = kDefaultActivityWindow;
+	if (!command.argument.empty()) {
+		char* end = NULL;
+		errno = 0;
+		long long milliseconds = strtoll(command.argument.c_str(), &end, 10);
+		if (end == command.argument.c_str() || *end != '\0' || errno == ERANGE
+			|| milliseconds <= 0 || milliseconds > kMaxActivityWindow / 1000) {
+			fprintf(stderr, B_TRANSLATE("[Auto] The time must be between 1 and %lld ms.\n"),
+				(long long)(kMaxActivityWindow / 1000));
+			return B_BAD_VALUE;
+		}
+		window = milliseconds * 1000;
+	}
+
+	Settings settings;
+	LoadSettings(settings);
+	settings.SetSuppressWhileActive(device->name,
+		trigger ? trigger->name : "", window, device->ordinal);
+	SaveSettings(settings, device);
+	return B_OK;
+}
+
+
+/**	\brief		Makes the add-on drop only some classes of events of a device.
+ *	\details	`mask N motion,tap` drops the moves and the taps of device N and
+ *				passes everything else. `mask N none` passes everything again.
+ */
+status_t SetSuppressMask(const ParsedCommand& command) {
+	DeviceEntry* device = gDevices.ItemAt(command.deviceNumber);
+	if (!device) {
+		fprintf(stderr, B_TRANSLATE("[Mask] No such device.\n"));
+		return B_BAD_VALUE;
+	}
+
+	uint8 mask = 0;
+	if (command.argument == "all") {
+		mask = kEventAllMask;
+	} else if (command.argument != "none") {
+		std::istringstream iss(command.argument);
+		std::string token;
+		while (std::getline(iss, token, ',')) {
+			int32 eventClass = 0;
+			while (eventClass < kEventClassCount && token != kEventClassNames[eventClass])
+				eventClass++;
+			if (eventClass == kEventClassCount) {
+				fprintf(stderr, B_TRANSLATE("[Mask] Unknown event class \'%s\'.\n"), token.c_str());
+				return B_BAD_VALUE;
+			}
+			mask |= 1 << eventClass;
+		}
+	}
+
+	Settings settings;
+	LoadSettings(settings);
+	ClassifyDevices(settings);
+	if ((mask & (1 << kEventMotion)) != 0 && DeviceTable::IsUsable(*device, settings)
+		&& gDevices.CountUsable(settings, device) == 0) {
+		fprintf(stderr, B_TRANSLATE("[Mask] Can't drop the moves of the last usable pointing device!\n"));
+		return B_NOT_ALLOWED;
+	}
+	settings.SetSuppressMask(device->name, mask, device->ordinal);
+	SaveSettings(settings, device);
+	return B_OK;
+}
+
+
+/**	\brief		Makes the add-on ignore a device while some applications are active.
+ *	\details	`focus N application/x-vnd.Haiku-Terminal,application/x-vnd.Haiku-Pe`
+ *				ignores device N while the Terminal or Pe is the active application.
+ *				`focus N off` removes the policy.
+ */
+status_t SetFocusPolicy(const ParsedCommand& command) {
+	DeviceEntry* device = gDevices.ItemAt(command.deviceNumber);
+	if (!device) {
+		fprintf(stderr, B_TRANSLATE("[Focus] No such device.\n"));
+		return B_BAD_VALUE;
+	}
+
+	std::vector<BString> signatures;
+	if (command.argument != "off") {
+		std::istringstream iss(command.argument);
+		std::string token;
+		while (std::getline(iss, token, ',')) {
+			if (token.empty()) continue;
+			if (token.size() >= (size_t)kSnapshotNameLength) {
+				fprintf(stderr, B_TRANSLATE("[Focus] The signature \'%s\' is too long.\n"), token.c_str());
+				return B_BAD_VALUE;
+			}
+			signatures.push_back(token.c_str());
+		}
+	}
+
+	Settings settings;
+	LoadSettings(settings);
+	ClassifyDevices(settings);
+	if (!signatures.empty() && DeviceTable::IsUsable(*device, settings)
+		&& gDevices.CountUsable(settings, device) == 0) {
+		fprintf(stderr, B_TRANSLATE("[Focus] Can't ignore the last usable pointing device!\n"));
+		return B_NOT_ALLOWED;
+	}
+	settings.SetIgnoreWhileFocused(device->name, signatures, device->ordinal);
+	SaveSettings(settings, device);
+	return B_OK;
+}
+
+
+/**	\brief		Lists or chooses how the devices are kept quiet while they're ignored.
+ *	\details	`strategy` lists the strategies of the connected devices.
+ *				`strategy N stop` stops device N whenever it's ignored, `filter`
+ *				keeps it running and leaves it to the add-on, `throttle` asks its
+ *				driver to stop reporting, and `auto` stops it only if it's ignored
+ *				for long. An ignored device is switched over right away.
+ */
+status_t SetSuppressStrategy(const ParsedCommand& command) {
+	Settings settings;
+	LoadSettings(settings);
+
+	if (command.deviceNumber < 0) {
+		for (int32 i = 0; i < gDevices.CountItems(); i++) {
+			DeviceEntry* dev = gDevices.ItemAt(i);
+			suppress_strategy strategy = settings.GetStrategy(dev->name, dev->ordinal);
+			printf(" %d. %s - %s", dev->number, dev->name, kStrategyNames[strategy]);
+			if (settings.GetStatus(dev->name, dev->ordinal)) {
+				printf(B_TRANSLATE(", ignored by %s"),
+					kStrategyNames[settings.GetEffectiveStrategy(dev->name, dev->ordinal)]);
+			}
+			printf("\n");
+		}
+		return B_OK;
+	}
+
+	DeviceEntry* device = gDevices.ItemAt(command.deviceNumber);
+	if (!device) {
+		fprintf(stderr, B_TRANSLATE("[Strategy] No such device.\n"));
+		return B_BAD_VALUE;
+	}
+	suppress_strategy strategy;
+	if (!StrategyFromString(command.argument.c_str(), &strategy)) {
+		fprintf(stderr, B_TRANSLATE("[Strategy] Unknown strategy \'%s\'.\n"), command.argument.c_str());
+		return B_BAD_VALUE;
+	}
+
+	// The driver is told to report again before the throttle is forgotten
+	if (settings.GetStrategy(device->name, device->ordinal) == kStrategyThrottle
+		&& strategy != kStrategyThrottle && settings.GetStatus(device->name, device->ordinal))
+		ThrottleDevice(device, false);
+	settings.SetStrategy(device->name, strategy, device->ordinal);
+	SaveSettings(settings, device);
+	if (device->duplicate && strategy != kStrategyFilter) {
+		fprintf(stderr, B_TRANSLATE("[Strategy] Another device is also named '%s', "
+									"only the add-on drops its events while both are connected.\n"),
+				device->name);
+	}
+	return ApplyStrategy(device, settings);
+}
+
+
+// The team of input_server, -1 if it's not found
+static team_id FindInputServer() {
+	team_info info;
+	int32 cookie = 0;
+	while (get_next_team_info(&cookie, &info) == B_OK) {
+		if (strstr(info.args, "input_server") != NULL) return info.team;
+	}
+	return -1;
+}
+
+
+// Set by the signal handler of "measure", polled by MeasureSnooze()
+static volatile sig_atomic_t sMeasureInterrupted = 0;
+
+static void InterruptMeasure(int) {
+	sMeasureInterrupted = 1;
+}
+
+
+// Sleeps in short steps, false if "measure" was interrupted meanwhile
+static bool MeasureSnooze(bigtime_t duration) {
+	const bigtime_t kStep = 100000;
+	bigtime_t until = system_time() + duration;
+	for (bigtime_t now = system_time(); !sMeasureInterrupted && now < until; now = system_time())
+		snooze(std::min(until - now, kStep));
+	return !sMeasureInterrupted;
+}
+
+
+// CPU time used by the team so far, 0 if it can't be read
+static bigtime_t TeamCPUTime(team_id team) {
+	team_usage_info usage;
+	if (team < 0 || get_team_usage_info(team, B_TEAM_USAGE_SELF, &usage) != B_OK) return 0;
+	return usage.user_time + usage.kernel_time;
+}
+
+
+/**	\brief		Measures what an ignored device costs with each strategy.
+ *	\details	`measure N [time]` ignores device N with the filter, stopped and
+ *				throttled in turn, for the time each (10 s by default), and
+ *				prints how many of its events still reached the add-on, i.e.
+ *				how often it woke input_server up, and how much CPU time
+ *				input_server used meanwhile. Leave the device alone to see its
+ *				idle cost, rest a palm on it to see the cost of the stray touches.
+ *	\details	The device is ignored for a limited time only, so the add-on
+ *				brings it back even if the command is killed. Its status and
+ *				strategy are restored at the end, also when the command is
+ *				interrupted by SIGINT, SIGTERM or SIGHUP.
+ *	\note		The last usable device is never measured, it would be ignored.
+ *				A device with the same name as another one is only measured
+ *				with the filter, see ApplyStrategy().
+ */
+status_t MeasureStrategies(const ParsedCommand& command) {
+	DeviceEntry* device = gDevices.ItemAt(command.deviceNumber);
+	if (!device) {
+		fprintf(stderr, B_TRANSLATE("[Measure] No such device.\n"));
+		return B_BAD_VALUE;
+	}
+	bigtime_t duration = ParseDuration(command.argument.empty() ? "10s" : command.argument);
+	if (duration == 0) {
+		fprintf(stderr, B_TRANSLATE("[Measure] Can't understand the time \'%s\'.\n"),
+				command.argument.c_str());
+		return B_BAD_VALUE;
+	}
+
+	SharedCounters counters;
+	int32 slot = (B_OK == counters.Map()) ? counters.FindDevice(device->fingerprint) : -1;
+	team_id server = FindInputServer();
+	if (slot < 0)
+		fprintf(stderr, B_TRANSLATE("[Measure] The add-on hasn't seen the device, no event counts.\n"));
+	if (server < 0)
+		fprintf(stderr, B_TRANSLATE("[Measure] input_server is not found, no CPU times.\n"));
+
+	Settings settings;
+	LoadSettings(settings);
+	ClassifyDevices(settings);
+	if (DeviceTable::IsUsable(*device, settings) && gDevices.CountUsable(settings, device) == 0) {
+		fprintf(stderr, B_TRANSLATE("[Measure] Can't ignore the last usable pointing device!\n"));
+		return B_NOT_ALLOWED;
+	}
+	DeviceInfo saved(device->name, true, false, device->ordinal);
+	if (const DeviceInfo* stored = settings.GetDevice(device->fingerprint)) saved = *stored;
+
+	// A second to settle after each switch, e.g. for a restarted device to be probed
+	const bigtime_t kSettle = 1000000;
+	const suppress_strategy kMeasured[] = { kStrategyFilter, kStrategyStop, kStrategyThrottle };
+	bigtime_t deadline = real_time_clock_usecs() + 3 * (duration + kSettle) + kSettle;
+
+	// The signals only break the loop, the state is restored below it
+	sMeasureInterrupted = 0;
+	struct sigaction interrupt = {}, previous[3];
+	const int kSignals[] = { SIGINT, SIGTERM, SIGHUP };
+	interrupt.sa_handler = InterruptMeasure;
+	for (int i = 0; i < 3; i++) sigaction(kSignals[i], &interrupt, &previous[i]);
+
+	printf(B_TRANSLATE("Measuring \'%s\' for %.0f s per strategy:\n"), device->name,
+			duration / 1000000.0);
+	for (suppress_strategy strategy : kMeasured) {
+		if (sMeasureInterrupted) break;
+		if (device->duplicate && strategy != kStrategyFilter) {
+			printf(B_TRANSLATE("  %-9s not available: another device has the same name\n"),
+					kStrategyNames[strategy]);
+			continue;
+		}
+		settings.SetIgnoredUntil(device->name, deadline, device->ordinal);
+		settings.SetStrategy(device->name, strategy, device->ordinal);
+		SaveSettings(settings, device);
+
+		// ApplyStrategy() falls back to the filter, here a refusal is a result of its own
+		status_t status = B_OK;
+		if (strategy == kStrategyStop) {
+			status = device->running ? DisableDevice(device) : B_OK;
+		} else {
+			status = device->running ? B_OK : EnableDevice(device);
+			if (B_OK == status && strategy == kStrategyThrottle)
+				status = ThrottleDevice(device, true);
+		}
+		if (B_OK != status) {
+			printf(B_TRANSLATE("  %-9s not available: %s\n"), kStrategyNames[strategy],
+					strerror(status));
+			continue;
+		}
+
+		bool completed = MeasureSnooze(kSettle);
+		int64 seen = slot >= 0 ? counters.Area()->devices[slot].seen.load(std::memory_order_relaxed) : 0;
+		bigtime_t cpu = TeamCPUTime(server);
+		bigtime_t started = system_time();
+		completed = completed && MeasureSnooze(duration);
+		double seconds = (system_time() - started) / 1000000.0;
+		if (slot >= 0) seen = counters.Area()->devices[slot].seen.load(std::memory_order_relaxed) - seen;
+		cpu = TeamCPUTime(server) - cpu;
+
+		if (strategy == kStrategyThrottle) ThrottleDevice(device, false);
+		if (!completed) {
+			printf(B_TRANSLATE("  Interrupted, restoring \'%s\'.\n"), device->name);
+			break;
+		}
+		printf(B_TRANSLATE("  %-9s %9.1f events/s  %8.2f ms of input_server CPU/s\n"),
+				kStrategyNames[strategy], seen / seconds, cpu / 1000.0 / seconds);
+	}
+
+	if (saved.IsIgnored && saved.IgnoredUntil != 0)
+		settings.SetIgnoredUntil(device->name, saved.IgnoredUntil, device->ordinal);
+	else
+		settings.SetStatus(device->name, saved.IsIgnored, device->ordinal);
+	settings.SetStrategy(device->name, (suppress_strategy)saved.Strategy, device->ordinal);
+	SaveSettings(settings, device);
+	status_t status = ApplyStrategy(device, settings);
+	for (int i = 0; i < 3; i++) sigaction(kSignals[i], &previous[i], NULL);
+	return sMeasureInterrupted ? B_INTERRUPTED : status;
+}
+
+
+/**	\brief		Starts the devices which are not ignored, and stops or throttles
+ *				those which are, as their strategies say.
+ *	\param[in]	settings	The settings of the activated profile, already saved.
+ *	\details	Called after a profile switch: the devices which stay usable
+ *				are started first, the others are stopped after them. The caller
+ *				makes sure that a usable one is left, see ManageProfiles().
+ */
+void ReconcileDevices(Settings& settings) {
+	std::vector<DeviceEntry*> toStop;
+	uint count = gDevices.CountItems();
+	for (uint i = 0; i < count; i++) {
+		DeviceEntry* dev = gDevices.ItemAt(i);
+		if (dev->running && settings.GetEffectiveStrategy(dev->name, dev->ordinal) == kStrategyStop)
+			toStop.push_back(dev);
+		else
+			ApplyStrategy(dev, settings);
+	}
+	for (DeviceEntry* dev : toStop) ApplyStrategy(dev, settings);
+}
+
+
+/**	\brief		Lists, activates, saves or deletes the named profiles.
+ *	\details	`profile` lists the profiles, `profile <name>` switches to one,
+ *				`profile save <name>` stores the current state of the devices
+ *				under that name, `profile delete <name>` removes it.
+ */
+status_t ManageProfiles(const ParsedCommand& command) {
+	Settings settings;
+	LoadSettings(settings);
+
+	status_t status = B_OK;
+	switch (command.type) {
+		case CommandType::kProfileSave:
+			settings.SaveProfile(command.argument.c_str());
+			break;
+
+		case CommandType::kProfileDelete:
+			status = settings.DeleteProfile(command.argument.c_str());
+			break;
+
+		default:
+			if (command.argument.empty()) {
+				BString active = settings.GetActiveProfile();
+				for (const BString& name : settings.GetProfileNames()) {
+					printf(" %s%s\n", name.String(),
+						name == active ? B_TRANSLATE(" (active)") : "");
+				}
+				return B_OK;
+			}
+			status = settings.ActivateProfile(command.argument.c_str());
+			break;
+	}
+	if (B_OK != status) {
+		fprintf(stderr, B_TRANSLATE("[Profile] No profile named \'%s\'.\n"),
+				command.argument.c_str());
+		return status;
+	}
+
+	// Checked before anything is saved, a stopped device counts if the profile starts it
+	if (command.type == CommandType::kProfile) {
+		ClassifyDevices(settings);
+		if (gDevices.CountItems() > 0 && gDevices.CountUsable(settings, NULL, true) == 0) {
+			fprintf(stderr, B_TRANSLATE("[Profile] The profile \'%s\' leaves no usable pointing "
+										"device, it's not activated.\n"), command.argument.c_str());
+			return B_NOT_ALLOWED;
+		}
+	}
+
+	SaveSettings(settings);
+	if (command.type == CommandType::kProfile) ReconcileDevices(settings);
+	return B_OK;
+}
+
+
 void PrintUsage() {
 	printf(B_TRANSLATE("This utility disables or enables a pointing device (mouse or touchpad). "
 		   "Its aim is to ignore accidental clicks on the touchpad when an external pointing "
@@ -213,20 +1257,67 @@ void PrintUsage() {
 	printf(B_TRANSLATE("Supported options (in both modes, unless stated othwerwise):\n"));
 	printf(B_TRANSLATE("  list         - Build and print a numbered list of the pointing input devices.\n"
 					   "                 Note: this option recreates the list of devices and updates it.\n"));
+	printf(B_TRANSLATE("  list --class <class> - List only the devices of a class: mouse, touchpad,\n"
+					   "                 tablet or unknown. The class is guessed from the name of the\n"
+					   "                 device, and confirmed once the device taps or is used as a tablet.\n"));
 	printf(B_TRANSLATE("  refresh      - Equals to \"list\".\n"));
 	printf(B_TRANSLATE("  enable #     - Enable a device number #. The number you take from the \"list\" command.\n"));
 	printf(B_TRANSLATE("                 If a device is already enabled, or if the number is wrong, nothing happens.\n"));
 	printf(B_TRANSLATE("  e # or E #   - Equals to \"enable #\", just fewer symbols to type. :) \n"));
 	printf(B_TRANSLATE("  disable #    - Disable a device number #. The number you take from the \"list\" command.\n"));
 	printf(B_TRANSLATE("                 If a device is already disabled, or if the number is wrong, nothing happens.\n"));
+	printf(B_TRANSLATE("  disable # --for <time> - Disable a device for a while, e.g. \"--for 30m\".\n"
+					   "                 The time is in seconds (s), minutes (m) or hours (h).\n"));
 	printf(B_TRANSLATE("  d # or D #   - Equals to \"disable #\", just fewer symbols to type. :) \n"));
+	printf(B_TRANSLATE("  enable --class <class>, disable --class <class> - Enable or disable all devices\n"
+					   "                 of a class, e.g. \"disable --class touchpad --for 1h\".\n"));
 	printf(B_TRANSLATE("  enable_all   - Immediately enable all devices. If you accidentally disabled the last\n"
 					   "                 mouse, you can enable it.\n\tDefault shortcut: Ctrl + Alt + Win + E.\n"
 					   "                 (You can change in \'Shortcuts\', if you want, but this text won't be updated.\n"));
 	printf(B_TRANSLATE("  EA or ea     - Equals to \"enable all\", just fewer symbols to type. :) \n"));
+	printf(B_TRANSLATE("  chord <keys> - Set the emergency \"enable all\" chord, which works even when\n"
+					   "                 no pointing device does, e.g. \"chord ctrl+alt+win+e\" (default).\n"
+					   "                 \"chord off\" disables it.\n"));
+	printf(B_TRANSLATE("  hotplug <ms> - Wait this long for the devices to settle before reacting to\n"
+					   "                 a device being plugged or unplugged (300 by default). A device\n"
+					   "                 that comes back within the time is not noticed. \"hotplug off\" reacts\n"
+					   "                 to every notification.\n"));
+	printf(B_TRANSLATE("  auto # # [ms] - Ignore the first device while the second one is in use, e.g.\n"
+					   "                 \"auto 0 1\" ignores the touchpad #0 for 500 ms (or [ms])\n"
+					   "                 after each event of the mouse #1. \"auto # off\" turns it off.\n"));
+	printf(B_TRANSLATE("  mask # <classes> - Drop only some events of device #. The classes are joined\n"
+					   "                 with \',\' out of: motion, down, up, wheel, tap; e.g.\n"
+					   "                 \"mask 0 tap\" ignores the taps on the touchpad #0.\n"
+					   "                 \"mask # all\" drops everything, \"mask # none\" nothing.\n"));
+	printf(B_TRANSLATE("  focus # <signatures> - Ignore device # while one of the applications is active,\n"
+					   "                 e.g. \"focus 0 application/x-vnd.Haiku-Terminal\". The signatures\n"
+					   "                 are joined with \',\'. \"focus # off\" turns it off.\n"));
+	printf(B_TRANSLATE("  strategy [# <strategy>] - Choose what is done to device # while it's ignored,\n"
+					   "                 or list the strategies. \"filter\" keeps it running and drops its\n"
+					   "                 events, \"stop\" stops it, \"throttle\" asks its\n"
+					   "                 driver to stop reporting. \"auto\" (default) stops the devices ignored\n"
+					   "                 for more than an hour or for good, and filters the others.\n"));
+	printf(B_TRANSLATE("  measure # [time] - Ignore device # with each strategy in turn for the time\n"
+					   "                 (10s by default), and print its events and the CPU time of\n"
+					   "                 input_server. Its status is restored afterwards.\n"));
+	printf(B_TRANSLATE("  profile [name] - Switch all devices to the named profile, or list the\n"
+					   "                 profiles. \"profile save <name>\" stores the current state\n"
+					   "                 of the devices as a profile, \"profile delete <name>\" removes it.\n"));
+	printf(B_TRANSLATE("  stats        - Print how many events of each device the add-on passed and dropped.\n"));
+	printf(B_TRANSLATE("  top          - Full-screen live view of the devices, their state and event rates.\n"));
+	printf(B_TRANSLATE("  trace-latency [ms] - Print how long the last changes took to be applied by the\n"
+					   "                 add-on, and to drop the first event of their device. With [ms],\n"
+					   "                 also print how many changes were applied within that time.\n"));
+	printf(B_TRANSLATE("  wait --connected|--disconnected|--ignored|--enabled <pattern> [--timeout <time>]\n"
+					   "               - Wait until a device whose name matches the pattern (e.g. \"*Logitech*\")\n"
+					   "                 is connected or ignored, or until none is. Fails when the time is up.\n"));
 	printf(B_TRANSLATE("  help or ?    - Display list of the available commands.\n"));
 	printf(B_TRANSLATE("  interactive  - (Command line option only) Enter interactive mode.\n"));
 	printf(B_TRANSLATE("  quit or exit - (Interactive mode only) Quit interactive mode.\n"));
+	printf(B_TRANSLATE("  --log-level <level> - (Command line option only, goes first) Print the messages up\n"
+	                   "                 to this level: error, warning (default), info or debug.\n"));
+	printf(B_TRANSLATE("  --timings    - (Command line option only, goes first) Print where the time of the\n"
+	                   "                 command went, and fail if it took longer than the budget.\n"));
 }
 
 
@@ -235,50 +1326,119 @@ status_t ExecuteCommand(const ParsedCommand& command) {
 	
 	switch (command.type) {
 		case CommandType::kList:
-			ListDevices();
+			ListDevices(command.deviceClass);
 			return B_OK;
 
 		case CommandType::kEnable:
-			if (command.deviceNumber >= 0) {
+			if (command.deviceNumber >= 0 || command.deviceClass >= 0) {
+				Settings settings;
+				LoadSettings(settings);
+				if (command.deviceClass >= 0) ClassifyDevices(settings);
+				std::vector<DeviceEntry*> targets;
 				uint count = gDevices.CountItems();
 				for (uint i = 0; i < count; i++) {
-					DeviceStructure* dev = (DeviceStructure*)gDevices.ItemAt(i);
-					if (dev->number == i) {
-						return EnableDevice(dev->device);
-					}	
+					DeviceEntry* dev = gDevices.ItemAt(i);
+					if (command.deviceClass >= 0 ? dev->deviceClass == command.deviceClass
+						: (int)dev->number == command.deviceNumber)
+						targets.push_back(dev);
+				}
+				PersistStatus(settings, targets, false);
+				status_t result = B_OK;
+				for (DeviceEntry* dev : targets) {
+					status_t status = ApplyStrategy(dev, settings);
+					if (B_OK != status) result = status;
 				}
+				return result;
 			}
 			return B_OK;
 
 		case CommandType::kDisable:
-			if (command.deviceNumber >= 0) {
+			if (command.deviceNumber >= 0 || command.deviceClass >= 0) {
 				uint count = gDevices.CountItems();
-				uint enabledDevices = 0;
-				
-				// Can't disable last pointing device!
+				Settings settings;
+				LoadSettings(settings);
+				ClassifyDevices(settings);
+
+				std::vector<DeviceEntry*> targets;
+				uint remaining = 0;
 				for (uint i = 0; i < count; i++) {
-					DeviceStructure* dev = (DeviceStructure*)gDevices.ItemAt(i);
-					if (dev->enabled) {
-						enabledDevices++;
-					}	
+					DeviceEntry* dev = gDevices.ItemAt(i);
+					if (command.deviceClass >= 0 ? dev->deviceClass == command.deviceClass
+						: (int)dev->number == command.deviceNumber)
+						targets.push_back(dev);
+					// A tablet can't stand in for a mouse, e.g. in a menu far from the pen
+					else if (DeviceTable::IsUsable(*dev, settings))
+						remaining++;
 				}
-				
-				if (enabledDevices == 1) {
+				if (targets.empty()) return B_OK;
+
+				// Can't disable last pointing device!
+				if (remaining == 0) {
 					fprintf (stderr, "[Disable Device]: Can't disable last active pointing device!\n");
 					return B_OK;
 				}
-				for (uint i = 0; i < count; i++) {
-					DeviceStructure* dev = (DeviceStructure*)gDevices.ItemAt(i);
-					if (dev->number == command.deviceNumber) {
-						return DisableDevice(dev->device);
-					}	
+				bigtime_t until = 0;
+				if (!command.argument.empty()) {
+					bigtime_t duration = ParseDuration(command.argument);
+					if (duration == 0) {
+						fprintf(stderr, B_TRANSLATE("[Disable Device] Can't understand the time \'%s\'.\n"),
+								command.argument.c_str());
+						return B_BAD_VALUE;
+					}
+					until = real_time_clock_usecs() + duration;
 				}
+				status_t result = B_OK;
+				// Stored first, so the add-on drops the events whatever the strategy does
+				PersistStatus(settings, targets, true, until);
+				for (DeviceEntry* dev : targets) {
+					status_t status = ApplyStrategy(dev, settings);
+					if (B_OK != status) result = status;
+				}
+				return result;
 			}
 			return B_OK;
 
 		case CommandType::kEnableAll:			
 			return EnableAll();
 
+		case CommandType::kChord:
+			return SetEmergencyChord(command.argument);
+
+		case CommandType::kHotplug:
+			return SetHotplugHysteresis(command.argument);
+
+		case CommandType::kStats:
+			return PrintStatistics();
+
+		case CommandType::kTop:
+			return RunDashboard();
+
+		case CommandType::kTraceLatency:
+			return PrintTraceLatency(command.argument);
+
+		case CommandType::kWait:
+			return WaitForCondition(command);
+
+		case CommandType::kAuto:
+			return SetAutoIgnore(command);
+
+		case CommandType::kMask:
+			return SetSuppressMask(command);
+
+		case CommandType::kFocus:
+			return SetFocusPolicy(command);
+
+		case CommandType::kStrategy:
+			return SetSuppressStrategy(command);
+
+		case CommandType::kMeasure:
+			return MeasureStrategies(command);
+
+		case CommandType::kProfile:
+		case CommandType::kProfileSave:
+		case CommandType::kProfileDelete:
+			return ManageProfiles(command);
+
 		case CommandType::kHelp:
 			PrintUsage();
 			return B_OK;
@@ -5,12 +5,12 @@
 #ifndef IGNORE_TOUCHPAD_CLI_H
 #define IGNORE_TOUCHPAD_CLI_H
 
-#include <List.h>
 #include <SupportDefs.h>
-#include <Input.h>
 #include <vector>
 #include <string>
 
+#include "device_table.h"
+
 enum class CommandType {
     kUnknown,
     kList,
@@ -19,32 +19,86 @@ enum class CommandType {
     kEnableAll,
     kHelp,
     kInteractive,
+    kChord,
+    kHotplug,
+    kStats,
+    kAuto,
+    kMask,
+    kFocus,
+    kStrategy,
+    kMeasure,
+    kProfile,
+    kProfileSave,
+    kProfileDelete,
+    kTop,
+    kTraceLatency,
+    kWait,
     kQuit
 };
 
 struct ParsedCommand {
     CommandType type;
     int deviceNumber = -1; // By default, no device is affected
+    int otherDeviceNumber = -1; // Second device, e.g. the trigger for "auto"
+    int deviceClass = -1; // Selects the devices by their device_class instead of by number
+    std::string argument;  // Free-form argument, e.g. the chord for "chord"
+    std::string condition; // What "wait" waits for: connected, disconnected, ignored or enabled
+    bigtime_t timeout = 0; // How long "wait" waits, 0 is forever
 };
 
-struct DeviceStructure {
-	BInputDevice* device;
-	bool		  enabled;
-	uint		  number;
-	
-	virtual ~DeviceStructure();
+// The connected pointing devices, refreshed by BuildListOfDevices()
+extern DeviceTable gDevices;
+
+// Phases of an invocation, as printed by "--timings"
+enum TimingPhase {
+	kTimingStartup,			// From the start of the team to main(), CPU time
+	kTimingCatalog,			// Loading the catalog for B_TRANSLATE
+	kTimingGetDevices,		// get_input_devices(), and picking the pointing devices
+	kTimingSettingsRead,	// Reading the settings file, in the background
+	kTimingSettingsLoad,	// Settings::Load(), including the wait for the read
+	kTimingSettingsSave,	// Settings::Save(), including the snapshot
+	kTimingDeviceControl,	// Starting and stopping the devices
+	kTimingCount
 };
 
-BList gDevices;
+// Adds the time spent in its scope to a phase, if "--timings" was given
+class ScopedTiming {
+public:
+	ScopedTiming(TimingPhase phase);
+	~ScopedTiming();
+private:
+	TimingPhase	fPhase;
+	bigtime_t	fStart;
+};
 
 ParsedCommand ParseCommand(const std::vector<std::string>& args);
 void BuildListOfDevices();
-void ListDevices();
+class Settings;
+void ClassifyDevices(Settings&);
+void ListDevices(int deviceClass = -1);
 void PrintUsage();
-status_t DisableDevice(BInputDevice*);
-status_t EnableDevice(BInputDevice*);
+status_t DisableDevice(DeviceEntry*);
+status_t EnableDevice(DeviceEntry*);
 status_t EnableAll();
-void Clean(BList*, bool);
+void LoadSettings(Settings&);
+void SaveSettings(Settings&, const DeviceEntry* tracedDevice = NULL);
+void PrintTimings(bigtime_t total);
+void PersistStatus(Settings&, const std::vector<DeviceEntry*>&, bool, bigtime_t until = 0);
+status_t ThrottleDevice(DeviceEntry*, bool);
+status_t ApplyStrategy(DeviceEntry*, Settings&);
+bigtime_t ParseDuration(const std::string&);
+status_t SetEmergencyChord(const std::string&);
+status_t SetHotplugHysteresis(const std::string&);
+status_t PrintStatistics();
+status_t PrintTraceLatency(const std::string& slo);
+status_t WaitForCondition(const ParsedCommand&);
+status_t SetAutoIgnore(const ParsedCommand&);
+status_t SetSuppressMask(const ParsedCommand&);
+status_t SetFocusPolicy(const ParsedCommand&);
+status_t SetSuppressStrategy(const ParsedCommand&);
+status_t MeasureStrategies(const ParsedCommand&);
+status_t ManageProfiles(const ParsedCommand&);
+void ReconcileDevices(Settings&);
 status_t ExecuteCommand(const ParsedCommand& command);
 void RunInteractiveLoop();
 
@@ -0,0 +1,372 @@
+/*
+ * Copyright 2025, Alex Hitech <ahitech@gmail.com>
+ * All rights reserved. Distributed under the terms of the MIT license.
+ */
+
+
+#include "Dashboard.h"
+#include "CLI.h"
+#include "counters.h"
+#include "settings.h"
+
+#include <Autolock.h>
+#include <Catalog.h>
+#include <Input.h>
+#include <Messenger.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/ioctl.h>
+#include <termios.h>
+#include <unistd.h>
+
+
+#undef B_TRANSLATION_CONTEXT
+#define B_TRANSLATION_CONTEXT "Ignore Touchpad CLI"
+
+
+// How often the event rates are recomputed. Nothing else wakes the dashboard up.
+const bigtime_t kDashboardTick = 1000000;
+
+// Rows below the devices
+const int32 kDashboardFooterRows = 2;
+
+static int32 sQuitRequested = 0;
+static int32 sRedrawRequested = 0;
+
+
+ScreenBuffer::ScreenBuffer()
+	: fRows(0),
+	  fColumns(0),
+	  fClear(true)
+{
+}
+
+
+// Adapts to the size of the terminal, redrawing everything if it changed
+void ScreenBuffer::Resize(int32 rows, int32 columns) {
+	if (rows == fRows && columns == fColumns) return;
+	fRows = rows;
+	fColumns = columns;
+	fWanted.assign(rows, std::string());
+	Invalidate();
+}
+
+
+// Makes the next Flush() redraw the whole screen
+void ScreenBuffer::Invalidate() {
+	fShown.assign(fRows, std::string());
+	fClear = true;
+}
+
+
+// Sets the text of a row, cut to the width of the terminal
+void ScreenBuffer::SetRow(int32 row, const std::string& text) {
+	if (row < 0 || row >= fRows) return;
+	// Writing into the last column would scroll on some terminals
+	size_t width = fColumns > 1 ? fColumns - 1 : 0;
+	fWanted[row] = text.size() > width ? text.substr(0, width) : text;
+}
+
+
+void ScreenBuffer::Flush() {
+	std::string out;
+	if (fClear) {
+		out += "\033[H\033[2J";
+		fClear = false;
+	}
+	for (int32 row = 0; row < fRows; row++) {
+		const std::string& wanted = fWanted[row];
+		const std::string& shown = fShown[row];
+		if (wanted == shown) continue;
+
+		size_t first = 0;
+		while (first < wanted.size() && first < shown.size() && wanted[first] == shown[first])
+			first++;
+		size_t end = wanted.size();
+		if (wanted.size() == shown.size()) {
+			while (end > first && wanted[end - 1] == shown[end - 1]) end--;
+		}
+
+		char position[32];
+		snprintf(position, sizeof(position), "\033[%d;%dH", (int)row + 1, (int)first + 1);
+		out += position;
+		out.append(wanted, first, end - first);
+		if (wanted.size() < shown.size()) out += "\033[K";
+		fShown[row] = wanted;
+	}
+
+	const char* data = out.data();
+	size_t left = out.size();
+	while (left > 0) {
+		ssize_t written = write(STDOUT_FILENO, data, left);
+		if (written <= 0) break;
+		data += written;
+		left -= written;
+	}
+}
+
+
+ChangeLooper::ChangeLooper(sem_id wakeUp)
+	: BLooper("IgnoreTouchpad changes"),
+	  fWakeUp(wakeUp),
+	  fPendingLock("Change notifications"),
+	  fDevicesChanged(0)
+{
+	fHotplug.SetOwner(BMessenger(this));
+}
+
+
+ChangeLooper::~ChangeLooper() {
+	for (BMessage* message : fPending) delete message;
+}
+
+
+BMessage* ChangeLooper::TakeSettingsChange() {
+	BAutolock lock(fPendingLock);
+	if (fPending.empty()) return NULL;
+	BMessage* message = fPending.front();
+	fPending.erase(fPending.begin());
+	return message;
+}
+
+
+void ChangeLooper::MessageReceived(BMessage* message) {
+	switch (message->what) {
+		case kMsgSettingsChanged:
+		{
+			BAutolock lock(fPendingLock);
+			fPending.push_back(DetachCurrentMessage());
+			release_sem(fWakeUp);
+			break;
+		}
+		case B_INPUT_DEVICES_CHANGED:
+			if (fHotplug.Transition(message)) DevicesChanged();
+			break;
+		case kMsgHotplugSettled:
+			if (fHotplug.Settled()) DevicesChanged();
+			break;
+		default:
+			BLooper::MessageReceived(message);
+	}
+}
+
+
+void ChangeLooper::DevicesChanged() {
+	atomic_or(&fDevicesChanged, 1);
+	release_sem(fWakeUp);
+}
+
+
+void ChangeLooper::SetHotplugHysteresis(bigtime_t hysteresis) {
+	if (!Lock()) return;
+	fHotplug.SetHysteresis(hysteresis);
+	Unlock();
+}
+
+
+HotplugStats ChangeLooper::HotplugStatistics() {
+	HotplugStats stats = HotplugStats();
+	if (!Lock()) return stats;
+	stats = fHotplug.Stats();
+	Unlock();
+	return stats;
+}
+
+
+// Reads the keys in raw mode: 'q' or Ctrl+C quits, 'r' redraws the screen
+static int32 ReadKeys(void* data) {
+	sem_id wakeUp = (sem_id)(addr_t)data;
+	char key;
+	while (read(STDIN_FILENO, &key, 1) == 1) {
+		if (key == 'q' || key == 'Q' || key == 3) break;
+		if (key == 'r' || key == 'R' || key == 12) {
+			atomic_or(&sRedrawRequested, 1);
+			release_sem(wakeUp);
+		}
+	}
+	atomic_or(&sQuitRequested, 1);
+	release_sem(wakeUp);
+	return 0;
+}
+
+
+// Human-readable policy of a device
+static std::string DescribeState(const MergedDevice& device, bigtime_t now) {
+	std::string state;
+	const DeviceInfo* stored = device.stored;
+	if (stored && stored->IsIgnored) {
+		state = "ignored";
+		if (stored->IgnoredUntil > now) {
+			char left[16];
+			snprintf(left, sizeof(left), " %lldm",
+				(long long)((stored->IgnoredUntil - now + 59999999) / 60000000));
+			state += left;
+		}
+	} else if (stored && stored->SuppressWhileActive.Length() > 0) {
+		state = "auto";
+	} else if (stored && !stored->IgnoreWhileFocused.empty()) {
+		state = "focus";
+	} else if (stored && stored->SuppressMask != 0) {
+		state = "masked";
+	} else {
+		state = "active";
+	}
+	if (!device.connected) state += ", away";
+	return state;
+}
+
+
+/**	\brief		Full-screen view of the devices, their state and event rates.
+ *	\details	Sleeps until the settings or the set of devices change, a key
+ *				is pressed, or kDashboardTick passes; only then is the screen
+ *				rebuilt, and only its changed cells are written out. The rates
+ *				come from the counters the add-on shares, which cost nothing to
+ *				read.
+ */
+status_t RunDashboard() {
+	if (!isatty(STDIN_FILENO) || !isatty(STDOUT_FILENO)) {
+		fprintf(stderr, B_TRANSLATE("[Top] Needs a terminal.\n"));
+		return B_ERROR;
+	}
+
+	sem_id wakeUp = create_sem(0, "IgnoreTouchpad dashboard");
+	if (wakeUp < B_OK) return wakeUp;
+
+	ChangeLooper* looper = new ChangeLooper(wakeUp);
+	looper->Run();
+	BMessenger messenger(looper);
+	watch_input_devices(messenger, true);
+	Settings settings;
+	LoadSettings(settings);
+	looper->SetHotplugHysteresis(settings.HotplugHysteresis());
+	settings.AddSubscriber(messenger, kChangeStatus | kChangePolicy | kChangeProfiles | kChangeHotplug);
+	settings.StartMonitoring();
+
+	SharedCounters counters;
+	bool mapped = B_OK == counters.Map();
+	int64 lastPassed[kMaxCounterDevices] = { 0 };
+	int64 lastDropped[kMaxCounterDevices] = { 0 };
+	double passedRate[kMaxCounterDevices] = { 0 };
+	double droppedRate[kMaxCounterDevices] = { 0 };
+	bigtime_t lastSample = 0;
+
+	struct termios original, raw;
+	tcgetattr(STDIN_FILENO, &original);
+	raw = original;
+	raw.c_lflag &= ~(ICANON | ECHO | ISIG);
+	raw.c_cc[VMIN] = 1;
+	raw.c_cc[VTIME] = 0;
+	tcsetattr(STDIN_FILENO, TCSAFLUSH, &raw);
+	// Alternate screen, no cursor
+	write(STDOUT_FILENO, "\033[?1049h\033[?25l", 14);
+
+	atomic_set(&sQuitRequested, 0);
+	thread_id reader = spawn_thread(ReadKeys, "IgnoreTouchpad keys", B_NORMAL_PRIORITY,
+		(void*)(addr_t)wakeUp);
+	resume_thread(reader);
+
+	ScreenBuffer screen;
+	while (atomic_get(&sQuitRequested) == 0) {
+		if (looper->TakeDevicesChanged()) BuildListOfDevices();
+		while (BMessage* change = looper->TakeSettingsChange()) {
+			settings.ApplyChanges(change);
+			int32 changes = 0;
+			if (B_OK == change->FindInt32("changes", &changes) && (changes & kChangeHotplug))
+				looper->SetHotplugHysteresis(settings.HotplugHysteresis());
+			delete change;
+		}
+		if (atomic_and(&sRedrawRequested, 0) != 0) screen.Invalidate();
+
+		// Event rates, per counters slot
+		bigtime_t now = system_time();
+		if (!mapped) mapped = B_OK == counters.Map();
+		const CountersArea* area = mapped ? counters.Area() : NULL;
+		if (area && now - lastSample >= kDashboardTick) {
+			int32 count = area->deviceCount.load(std::memory_order_acquire);
+			double seconds = lastSample ? (now - lastSample) / 1000000.0 : 0;
+			for (int32 i = 0; i < count; i++) {
+				const DeviceCounters& device = area->devices[i];
+				int64 passed = device.passed.load(std::memory_order_relaxed);
+				int64 dropped = 0;
+				for (int32 reason = 0; reason < kDropReasonCount; reason++)
+					dropped += device.dropped[reason].load(std::memory_order_relaxed);
+				passedRate[i] = seconds > 0 ? (passed - lastPassed[i]) / seconds : 0;
+				droppedRate[i] = seconds > 0 ? (dropped - lastDropped[i]) / seconds : 0;
+				lastPassed[i] = passed;
+				lastDropped[i] = dropped;
+			}
+			lastSample = now;
+		}
+
+		struct winsize size;
+		if (ioctl(STDOUT_FILENO, TIOCGWINSZ, &size) == 0 && size.ws_row > 0)
+			screen.Resize(size.ws_row, size.ws_col);
+		else
+			screen.Resize(24, 80);
+
+		char line[512];
+		int32 row = 0;
+		BString profile = settings.GetActiveProfile();
+		snprintf(line, sizeof(line), "%s%s%s",
+			B_TRANSLATE("Ignore Touchpad - q: quit, r: redraw"),
+			profile.Length() > 0 ? "    profile: " : "", profile.String());
+		screen.SetRow(row++, line);
+		snprintf(line, sizeof(line), " %-3s %-36s %-16s %10s %10s %8s",
+			"#", "Device", "State", "Passed/s", "Dropped/s", "Idle");
+		screen.SetRow(row++, line);
+		screen.SetRow(row++, "");
+
+		ConnectedDevice connected[kMaxDeviceHistory];
+		size_t connectedCount = 0;
+		for (int32 i = 0; i < gDevices.CountItems() && connectedCount < (size_t)kMaxDeviceHistory; i++) {
+			DeviceEntry* dev = gDevices.ItemAt(i);
+			connected[connectedCount++].SetTo(dev->name, dev->ordinal);
+		}
+
+		bigtime_t wallClock = real_time_clock_usecs();
+		int32 lastDeviceRow = screen.Rows() - kDashboardFooterRows;
+		for (const MergedDevice& device : settings.GetMergedListOfDevices(connected, connectedCount)) {
+			if (!device.connected && !(device.stored && device.stored->HasPolicy())) continue;
+			if (row >= lastDeviceRow) break;
+
+			// The merge sorts the array, the table knows the numbers by fingerprint
+			char number[8] = "";
+			if (const DeviceEntry* entry = device.connected ? gDevices.Find(device.fingerprint) : NULL)
+				snprintf(number, sizeof(number), "%u", (unsigned)entry->number);
+			std::string name(device.name);
+			if (device.ordinal > 0) name += " (" + std::to_string(device.ordinal + 1) + ")";
+
+			int32 slot = area ? counters.FindDevice(device.fingerprint) : -1;
+			char passed[16] = "-", dropped[16] = "-", idle[16] = "-";
+			if (slot >= 0) {
+				snprintf(passed, sizeof(passed), "%.0f", passedRate[slot]);
+				snprintf(dropped, sizeof(dropped), "%.0f", droppedRate[slot]);
+				bigtime_t active = area->devices[slot].lastActivity.load(std::memory_order_relaxed);
+				if (active > 0) snprintf(idle, sizeof(idle), "%llds", (long long)((now - active) / 1000000));
+			}
+			snprintf(line, sizeof(line), " %-3s %-36.36s %-16s %10s %10s %8s", number, name.c_str(),
+				DescribeState(device, wallClock).c_str(), passed, dropped, idle);
+			screen.SetRow(row++, line);
+		}
+		while (row < screen.Rows() - 1) screen.SetRow(row++, "");
+		HotplugStats hotplug = looper->HotplugStatistics();
+		snprintf(line, sizeof(line), B_TRANSLATE("Hotplug: %u changes, %u reconciles, %u suppressed"),
+			(unsigned)hotplug.transitions, (unsigned)hotplug.reconciles, (unsigned)hotplug.Suppressed());
+		screen.SetRow(row, mapped ? line : B_TRANSLATE("The add-on is not running, no event rates."));
+		screen.Flush();
+
+		// Idle: one wake-up per tick, and nothing is written unless a cell changed
+		acquire_sem_etc(wakeUp, 1, B_RELATIVE_TIMEOUT, kDashboardTick - (system_time() - lastSample) % kDashboardTick);
+	}
+
+	write(STDOUT_FILENO, "\033[?25h\033[?1049l", 14);
+	tcsetattr(STDIN_FILENO, TCSAFLUSH, &original);
+
+	watch_input_devices(messenger, false);
+	settings.StopMonitoring();
+	if (looper->Lock()) looper->Quit();
+	delete_sem(wakeUp);
+	status_t exitValue;
+	wait_for_thread(reader, &exitValue);
+	return B_OK;
+}
@@ -0,0 +1,82 @@
+/*
+ * Copyright 2025, Alex Hitech <ahitech@gmail.com>
+ * All rights reserved. Distributed under the terms of the MIT license.
+ */
+#ifndef IGNORE_TOUCHPAD_DASHBOARD_H
+#define IGNORE_TOUCHPAD_DASHBOARD_H
+
+#include <Locker.h>
+#include <Looper.h>
+#include <OS.h>
+#include <SupportDefs.h>
+
+#include "hotplug.h"
+
+#include <string>
+#include <vector>
+
+
+/**	\class		ScreenBuffer
+ *	\brief		What the terminal shows, kept to redraw only the changed cells.
+ *	\details	Flush() compares each row with the one drawn last time and
+ *				writes out only the span between the first and the last
+ *				differing cells, all in a single write().
+ */
+class ScreenBuffer {
+public:
+	ScreenBuffer();
+
+	void Resize(int32 rows, int32 columns);
+	void Invalidate();
+	void SetRow(int32 row, const std::string& text);
+	void Flush();
+
+	int32 Rows() const { return fRows; }
+	int32 Columns() const { return fColumns; }
+
+private:
+	int32						fRows;
+	int32						fColumns;
+	std::vector<std::string>	fShown;		// What the terminal has now
+	std::vector<std::string>	fWanted;	// What it should have after Flush()
+	bool						fClear;		// Clear the whole screen first
+};
+
+
+/**	\class		ChangeLooper
+ *	\brief		Turns the change notifications into wake-ups of a waiting thread.
+ *	\details	Receives the settings notifications and B_INPUT_DEVICES_CHANGED,
+ *				queues or flags them, and releases the semaphore the thread
+ *				waits on. Used by the dashboard and by the "wait" command.
+ *				The device notifications go through a HotplugDebouncer, so a
+ *				flapping device wakes the thread once per window at most.
+ */
+class ChangeLooper : public BLooper {
+public:
+	ChangeLooper(sem_id wakeUp);
+	virtual ~ChangeLooper();
+	virtual void MessageReceived(BMessage* message);
+
+	// Next queued settings notification, or NULL. The caller owns it.
+	BMessage* TakeSettingsChange();
+	// Returns and clears the flag
+	bool TakeDevicesChanged() { return atomic_and(&fDevicesChanged, 0) != 0; }
+
+	// Both lock the looper, the debouncer lives on its thread
+	void SetHotplugHysteresis(bigtime_t hysteresis);
+	HotplugStats HotplugStatistics();
+
+private:
+	void DevicesChanged();
+
+	sem_id					fWakeUp;
+	BLocker					fPendingLock;
+	std::vector<BMessage*>	fPending;		// Settings notifications, oldest first
+	int32					fDevicesChanged;
+	HotplugDebouncer		fHotplug;
+};
+
+
+status_t RunDashboard();
+
+#endif // IGNORE_TOUCHPAD_DASHBOARD_H
@@ -5,6 +5,7 @@
 
 
 #include "GUISettings.h"
+#include "log.h"
 
 #include <iostream>
 #include <stdio.h>
@@ -41,17 +42,17 @@ IgnoreTouchpadSettings::IgnoreTouchpadSettings()
 	if (_settingsMessage.Unflatten(&_settingsFile) == B_OK){
 	
 		if (_settingsMessage.FindBool(AR_ACTIVE, &_confActive) != B_OK)
-			fprintf(stderr, "IgnoreTouchpadSettings::IgnoreTouchpadSettings();\tFailed to load active boolean from settings file. Using default\n");
+			LOG_DEBUG("GUI Settings", "Failed to load active boolean from settings file. Using default");
 			
 		if (_settingsMessage.FindInt64(AR_DELAY, &_confDelay) != B_OK)
-			fprintf(stderr, "IgnoreTouchpadSettings::IgnoreTouchpadSettings();\tFailed to load delay from settings file. Using default\n");
+			LOG_DEBUG("GUI Settings", "Failed to load delay from settings file. Using default");
 
 		if (_settingsMessage.FindInt32(AR_MODE, &_confMode) != B_OK)
-			fprintf(stderr, "IgnoreTouchpadSettings::IgnoreTouchpadSettings();\tFailed to load mode from settings file. Using default\n");
+			LOG_DEBUG("GUI Settings", "Failed to load mode from settings file. Using default");
 	}
 	else
 	{
-		fprintf(stderr, "IgnoreTouchpadSettings::IgnoreTouchpadSettings();\nUnable to open settings file (either corrupted or doesn't exist), using defaults.\n");		
+		LOG_DEBUG("GUI Settings", "Unable to open settings file (either corrupted or doesn't exist), using defaults.");
 	}
 	
 	_settingsFile.Unset();
@@ -76,7 +77,7 @@ IgnoreTouchpadSettings::~IgnoreTouchpadSettings()
 
 	//write message to settings file
 	if (_settingsMessage.Flatten(&_settingsFile) != B_OK)
-		fprintf(stderr, "IgnoreTouchpadSettings::~IgnoreTouchpadSettings();\tError occurred writing settings\n");
+		LOG_ERROR("GUI Settings", "Error occurred writing settings");
 
 	_settingsFile.Unset();	
 }
@@ -5,6 +5,8 @@
 
 
 #include "GUIView.h"
+#include "log.h"
+#include "settings.h"
 
 //#define DEBUG 1
 #include <BeBuild.h>
@@ -68,24 +70,34 @@ ConfigMenu::ConfigMenu(TrayView *tv, bool useMag)
 
 	SetFont(be_plain_font);
 	
-	BList devicesList;
-	BuildDevicesList(devicesList);
-	int itemsCount = devicesList.Count();
+	const DeviceTable& devices = tv->RefreshDevices();
+	const CountersArea* counters = tv->Counters();
 	
-	for (int i = 0; i < itemsCount; ++i) {
+	for (const DeviceEntry& device : devices) {
+		const DeviceEntry* currentDevice = &device;
 		msg = new BMessage('TOGL');
-		msg->AddInt16("device", i);
-		DeviceStructure* currentDevice = static_cast<DeviceStructure*>devicesList.ItemAt(i);
-		if (!currentDevice) { continue; }
-		tmpi = new BMenuItem(currentDevice->deviceName.String(), tmpm);
+		msg->AddInt16("device", currentDevice->number);
+		
+		// Show how much the add-on has dropped, straight from the shared counters
+		BString label(currentDevice->name);
+		int32 slot = counters ? tv->fCounters.FindDevice(currentDevice->fingerprint) : -1;
+		if (slot >= 0) {
+			int64 dropped = 0;
+			for (int32 reason = 0; reason < kDropReasonCount; reason++)
+				dropped += counters->devices[slot].dropped[reason].load(std::memory_order_relaxed);
+			if (dropped > 0)
+				label << " (" << dropped << B_TRANSLATE(" dropped") << ")";
+		}
+		tmpi = new BMenuItem(label.String(), msg);
 		
 		// If the device is active, its item is checked
-		if (currentDevice->enabled) {
+		bool usable = tv->IsUsable(*currentDevice);
+		if (usable) {
 			tmpi->SetMarked();
 		}
 		
 		// Don't allow disabling the last active pointing device
-		if (itemsCount == 1 && currentDevice->enabled) {
+		if (tv->CountUsable() == 1 && usable) {
 			tmpi->SetEnabled(false);
 		}
 		
@@ -94,6 +106,66 @@ ConfigMenu::ConfigMenu(TrayView *tv, bool useMag)
 	
 	AddSeparatorItem();
 	
+	// Per-device classes of events dropped by the add-on
+	::Settings settings;
+	settings.Load();
+	BMenu *masks = new BMenu(B_TRANSLATE("Ignore only"));
+	for (const DeviceEntry& device : devices) {
+		const DeviceEntry* currentDevice = &device;
+		
+		uint8 mask = settings.GetSuppressMask(currentDevice->name, currentDevice->ordinal);
+		tmpm = new BMenu(currentDevice->name);
+		for (int32 eventClass = 0; eventClass < kEventClassCount; eventClass++) {
+			msg = new BMessage('MASK');
+			msg->AddString("name", currentDevice->name);
+			msg->AddInt32("class", eventClass);
+			tmpi = new BMenuItem(kEventClassNames[eventClass], msg);
+			tmpi->SetMarked((mask & (1 << eventClass)) != 0);
+			tmpm->AddItem(tmpi);
+		}
+		tmpm->SetTargetForItems(tv);
+		masks->AddItem(tmpm);
+	}
+	AddItem(masks);
+	
+	// Timed ignores, the add-on brings the device back by itself
+	static const int32 kIgnoreMinutes[] = { 15, 30, 60, 120 };
+	BMenu *timed = new BMenu(B_TRANSLATE("Ignore for"));
+	for (const DeviceEntry& device : devices) {
+		const DeviceEntry* currentDevice = &device;
+		
+		tmpm = new BMenu(currentDevice->name);
+		for (int32 minutes : kIgnoreMinutes) {
+			msg = new BMessage('TIME');
+			msg->AddString("name", currentDevice->name);
+			msg->AddInt32("minutes", minutes);
+			BString label;
+			label << minutes << B_TRANSLATE(" minutes");
+			tmpm->AddItem(new BMenuItem(label.String(), msg));
+		}
+		tmpm->SetTargetForItems(tv);
+		timed->AddItem(tmpm);
+	}
+	AddItem(timed);
+	
+	// Named profiles, the active one is checked
+	std::vector<BString> profiles = settings.GetProfileNames();
+	if (!profiles.empty()) {
+		BString active = settings.GetActiveProfile();
+		tmpm = new BMenu(B_TRANSLATE("Profiles"));
+		for (const BString& name : profiles) {
+			msg = new BMessage('PRFL');
+			msg->AddString("name", name);
+			tmpi = new BMenuItem(name.String(), msg);
+			tmpi->SetMarked(name == active);
+			tmpm->AddItem(tmpi);
+		}
+		tmpm->SetTargetForItems(tv);
+		AddItem(tmpm);
+	}
+	
+	AddSeparatorItem();
+	
 	msg = new BMessage('ENAA');
 	tmpi = new BMenuItem(B_TRANSLATE("Enable all"), msg);
 	AddItem(tmpi);
@@ -133,8 +205,10 @@ void TrayView::_init()
 {
 	thread_info ti;
 
+	fCreatedAt = system_time();
 	watching = false;
 	_settings = new AutoRaiseSettings;
+	fControl = DeviceControl::Create();
 
 	raise_delay = _settings->Delay();
 	current_window = 0;
@@ -149,15 +223,30 @@ void TrayView::_init()
 	get_thread_info(find_thread(NULL), &ti);
 	fDeskbarTeam = ti.team;
 
+	// Reading the resources doesn't need the Deskbar, the icons are joined
+	// in AttachedToWindow(), before the first Draw()
+	fIconStatus = B_NO_INIT;
+	fIconLoader = new BackgroundTask("IgnoreTouchpad icons",
+		[this] { fIconStatus = _LoadIcons(); });
 
+	SetDrawingMode(B_OP_ALPHA);
+	SetFlags(Flags() | B_WILL_DRAW);
+
+	// begin watching if we want
+	// (doesn't work here, better do it in AttachedToWindow())
+}
+
+// Loads the icons from the resources of our image. The Deskbar isn't
+// touched here, a failure is dealt with in AttachedToWindow().
+status_t TrayView::_LoadIcons()
+{
 	image_info info;
 	{
 		status_t result = our_image(info);
 		if (result != B_OK) {
 			printf("Unable to lookup image_info for the AutoRaise image: %s\n",
 				strerror(result));
-			removeFromDeskbar(NULL);
-			return;
+			return result;
 		}
 	}
 
@@ -165,16 +254,14 @@ void TrayView::_init()
 	if (file.InitCheck() != B_OK) {
 		printf("Unable to access AutoRaise image file: %s\n",
 			strerror(file.InitCheck()));
-		removeFromDeskbar(NULL);
-		return;
+		return file.InitCheck();
 	}
 
 	BResources res(&file);
 	if (res.InitCheck() != B_OK) {
 		printf("Unable to load image resources: %s\n",
 			strerror(res.InitCheck()));
-		removeFromDeskbar(NULL);
-		return;
+		return res.InitCheck();
 	}
 
 	size_t bmsz;
@@ -185,8 +272,7 @@ void TrayView::_init()
 		B_CMAP8);
 	if (p == NULL) {
 		puts("ERROR loading active icon");
-		removeFromDeskbar(NULL);
-		return;
+		return B_ERROR;
 	}
 	_activeIcon->SetBits(p, B_MINI_ICON * B_MINI_ICON, 0, B_CMAP8);
 
@@ -195,16 +281,11 @@ void TrayView::_init()
 		B_CMAP8);
 	if (p == NULL) {
 		puts("ERROR loading inactive icon");
-		removeFromDeskbar(NULL);
-		return;
+		return B_ERROR;
 	}
 	_inactiveIcon->SetBits(p, B_MINI_ICON * B_MINI_ICON, 0, B_CMAP8);
 
-	SetDrawingMode(B_OP_ALPHA);
-	SetFlags(Flags() | B_WILL_DRAW);
-
-	// begin watching if we want
-	// (doesn't work here, better do it in AttachedToWindow())
+	return B_OK;
 }
 
 TrayView::~TrayView(){
@@ -216,9 +297,11 @@ TrayView::~TrayView(){
 	}
 	delete_sem(fPollerSem);
 	wait_for_thread(poller_thread, &ret);
+	delete fIconLoader;
 	if (_activeIcon) delete _activeIcon;
 	if (_inactiveIcon) delete _inactiveIcon;
 	if (_settings) delete _settings;
+	delete fControl;
 
 	return;
 }
@@ -250,6 +333,37 @@ void TrayView::AttachedToWindow() {
 		release_sem(fPollerSem);
 		watching = true;
 	}
+
+	// The scripting replies come from here, not from a new enumeration.
+	// The settings file is read while input_server lists the devices.
+	fSelf = BMessenger(this);
+	BMessage stored;
+	status_t readStatus = B_NO_INIT;
+	{
+		BackgroundTask read("IgnoreTouchpad settings",
+			[&] { readStatus = fIgnoreSettings.ReadFile(&stored); });
+		fDevices.Refresh(fControl);
+	}
+	if (B_OK == readStatus)
+		fIgnoreSettings.Load(&stored);
+	fHotplug.SetOwner(fSelf);
+	fHotplug.SetHysteresis(fIgnoreSettings.HotplugHysteresis());
+	fIgnoreSettings.AddSubscriber(fSelf,
+		kChangeStatus | kChangePolicy | kChangeProfiles | kChangeHotplug);
+	fIgnoreSettings.StartMonitoring();
+	watch_input_devices(fSelf, true);
+
+	fIconLoader->Wait();
+	if (B_OK != fIconStatus) {
+		removeFromDeskbar(NULL);
+		return;
+	}
+	LOG_DEBUG("TrayView", "Ready in %lld us.", (long long)(system_time() - fCreatedAt));
+}
+
+void TrayView::DetachedFromWindow() {
+	watch_input_devices(fSelf, false);
+	fIgnoreSettings.StopMonitoring();
 }
 
 void TrayView::Draw(BRect updaterect) {
@@ -327,13 +441,78 @@ void TrayView::MessageReceived(BMessage* message)
 	switch(message->what)
 	{
 		case 'TOGL':
+		{
 			int deviceId = 0;
 			if (B_OK != message->FindInt16("device", &deviceId)) break;
 			Toggle(deviceId);
 			break;
+		}
+		case B_INPUT_DEVICES_CHANGED:
+			if (fHotplug.Transition(message))
+				fDevices.Refresh(fControl);
+			break;
+		case kMsgHotplugSettled:
+			if (fHotplug.Settled())
+				fDevices.Refresh(fControl);
+			break;
+		case kMsgSettingsChanged:
+			// Also our own saves, the file has changed either way
+			fIgnoreSettings.ApplyChanges(message);
+			fHotplug.SetHysteresis(fIgnoreSettings.HotplugHysteresis());
+			break;
+		case B_GET_PROPERTY:
+		case B_SET_PROPERTY:
+		case B_EXECUTE_PROPERTY:
+			if (!HandleScripting(message))
+				BView::MessageReceived(message);
+			break;
 		case 'ENAA':
 			EnableAll();
 			break;
+		case 'MASK':
+		{
+			BString name;
+			int32 eventClass = 0;
+			if (B_OK != message->FindString("name", &name)
+				|| B_OK != message->FindInt32("class", &eventClass)
+				|| eventClass < 0 || eventClass >= kEventClassCount)
+			{
+				break;
+			}
+			// The add-on picks the new mask up from the snapshot written by Save()
+			DeviceEntry* device = fDevices.FindByName(name.String());
+			if (device) {
+				SetSuppressMask(device, fIgnoreSettings.GetSuppressMask(device->name,
+					device->ordinal) ^ (1 << eventClass));
+			}
+			break;
+		}
+		case 'TIME':
+		{
+			BString name;
+			int32 minutes = 0;
+			if (B_OK != message->FindString("name", &name)
+				|| B_OK != message->FindInt32("minutes", &minutes) || minutes <= 0)
+			{
+				break;
+			}
+			// Never the last usable device, like SetIgnored()
+			DeviceEntry* device = fDevices.FindByName(name.String());
+			if (!device || (IsUsable(*device) && CountUsable() <= 1))
+				break;
+			fIgnoreSettings.SetIgnoredUntil(device->name,
+				real_time_clock_usecs() + minutes * 60000000LL, device->ordinal);
+			SaveSettings(fIgnoreSettings);
+			ApplyStrategy(device);
+			break;
+		}
+		case 'PRFL':
+		{
+			BString name;
+			if (B_OK != message->FindString("name", &name)) break;
+			ActivateProfile(name);
+			break;
+		}
 		case REMOVE_FROM_TRAY:
 		{
 			thread_id tid = spawn_thread(removeFromDeskbar, "RemoveFromDeskbar", B_NORMAL_PRIORITY, (void*)this);
@@ -358,6 +537,7 @@ void TrayView::MessageReceived(BMessage* message)
 		default:
 			BView::MessageReceived(message);
 	}
+	LogFlush();
 }
 
 AutoRaiseSettings *TrayView::Settings() const
@@ -365,105 +545,251 @@ AutoRaiseSettings *TrayView::Settings() const
 	return _settings;
 }
 
-void TrayView::Toggle(int deviceNo)
+
+// Properties of the scripting suite. The devices are addressed by their index
+// in the menu or by their name.
+static property_info sTrayProperties[] = {
+	{ "Devices", { B_GET_PROPERTY, 0 }, { B_DIRECT_SPECIFIER, 0 },
+		"Returns the names of the pointing devices, in the order of the menu.",
+		0, { B_STRING_TYPE } },
+	{ "Ignored", { B_GET_PROPERTY, B_SET_PROPERTY, 0 },
+		{ B_INDEX_SPECIFIER, B_NAME_SPECIFIER, 0 },
+		"Gets or sets whether the input of the device is ignored.",
+		0, { B_BOOL_TYPE } },
+	{ "Mask", { B_GET_PROPERTY, B_SET_PROPERTY, 0 },
+		{ B_INDEX_SPECIFIER, B_NAME_SPECIFIER, 0 },
+		"Gets or sets the events dropped for the device: 1 motion, 2 down, "
+		"4 up, 8 wheel, 16 tap.",
+		0, { B_INT32_TYPE } },
+	{ "Profile", { B_GET_PROPERTY, B_SET_PROPERTY, 0 }, { B_DIRECT_SPECIFIER, 0 },
+		"Gets the active profile, or switches to another one.",
+		0, { B_STRING_TYPE } },
+	{ "EnableAll", { B_EXECUTE_PROPERTY, 0 }, { B_DIRECT_SPECIFIER, 0 },
+		"Unignores all devices.", 0 },
+	{ "Hotplug", { B_GET_PROPERTY, 0 }, { B_DIRECT_SPECIFIER, 0 },
+		"Returns how many device notifications came, how many rebuilds they "
+		"caused, how many were coalesced and how many bursts cancelled out.",
+		0, { B_INT32_TYPE } },
+	{ 0 }
+};
+
+BHandler* TrayView::ResolveSpecifier(BMessage* message, int32 index,
+	BMessage* specifier, int32 form, const char* property)
 {
-	BList devList;
-	BuildDevicesList(devList);
-	int totalItems = devList.CountItems();
-	for (int i = 0; i < totalItems; i++) {
-		if (i == deviceNo) {
-			DeviceStructure* devStruct = static_cast<DeviceStructure>(devList.ItemAt(i));
-			if (devStruct) {
-				if (devStruct->enabled && totalItems > 1) {
-					device->Stop();
-				}
-				if (!devStruct->enabled) {
-					device->Start();
-				}
-			}
-		}
-	}
-	Clean(&toReturn, true);
+	BPropertyInfo info(sTrayProperties);
+	if (info.FindMatch(message, index, specifier, form, property) >= 0)
+		return this;
+	return BView::ResolveSpecifier(message, index, specifier, form, property);
 }
 
+status_t TrayView::GetSupportedSuites(BMessage* data)
+{
+	data->AddString("suites", IGNORE_TOUCHPAD_SUITE);
+	BPropertyInfo info(sTrayProperties);
+	data->AddFlat("messages", &info);
+	return BView::GetSupportedSuites(data);
+}
 
-void TrayView::EnableAll() {
-	BList devList;
-	BuildDevicesList(devList);
-	int totalItems = devList.CountItems();
-	for (int i = 0; i < totalItems; i++) {
-		DeviceStructure* devStruct = static_cast<DeviceStructure>(devList.ItemAt(i));
-		if (devStruct) {
-			if (!devStruct->enabled) {
-				device->Start();
+// Answers a scripting message from the cached model. Returns false if the
+// message is not for our suite.
+bool TrayView::HandleScripting(BMessage* message)
+{
+	int32 index;
+	BMessage specifier;
+	int32 form;
+	const char* property;
+	if (message->GetCurrentSpecifier(&index, &specifier, &form, &property) != B_OK)
+		return false;
+	BPropertyInfo info(sTrayProperties);
+	if (info.FindMatch(message, index, &specifier, form, property) < 0)
+		return false;
+
+	BMessage reply(B_REPLY);
+	status_t status = B_OK;
+	BString name(property);
+	if (name == "Devices") {
+		for (const DeviceEntry& device : fDevices)
+			reply.AddString("result", device.name);
+	} else if (name == "Profile") {
+		if (message->what == B_GET_PROPERTY) {
+			reply.AddString("result", fIgnoreSettings.GetActiveProfile());
+		} else {
+			BString profile;
+			status = message->FindString("data", &profile);
+			if (status == B_OK)
+				status = ActivateProfile(profile);
+		}
+	} else if (name == "Hotplug") {
+		const HotplugStats& stats = fHotplug.Stats();
+		reply.AddInt32("result", stats.transitions);
+		reply.AddInt32("result", stats.reconciles);
+		reply.AddInt32("result", stats.coalesced);
+		reply.AddInt32("result", stats.cancelled);
+	} else if (name == "EnableAll") {
+		status = EnableAll();
+	} else {
+		DeviceEntry* device = FindCachedDevice(&specifier, form);
+		if (!device) {
+			status = B_BAD_INDEX;
+		} else if (name == "Ignored") {
+			bool ignored;
+			if (message->what == B_GET_PROPERTY)
+				reply.AddBool("result", fIgnoreSettings.GetStatus(device->name, device->ordinal));
+			else if ((status = message->FindBool("data", &ignored)) == B_OK)
+				status = SetIgnored(device, ignored);
+		} else if (name == "Mask") {
+			int32 mask;
+			if (message->what == B_GET_PROPERTY) {
+				reply.AddInt32("result", fIgnoreSettings.GetSuppressMask(device->name, device->ordinal));
+			} else if ((status = message->FindInt32("data", &mask)) == B_OK) {
+				status = SetSuppressMask(device, mask);
 			}
 		}
 	}
-	Clean(&toReturn, true);
-}
-
-
-
-void BuildDevicesList(BList& toReturn) {
-	Clean(&toReturn, true);
-	BList devices;
-    status_t err = get_input_devices(&devices);
-    if (err != B_OK) {
-        fprintf(stderr, "[BuildListOfDevices] Failed to get input devices: %s\n", strerror(err));
-    }
-    
-    int count = devices.CountItems();
-    for (int32 i = count - 1; i >= 0; i--) {
-        BInputDevice* info = static_cast<BInputDevice*>(devices.ItemAt(i));
-        if (!info || info->Type() != B_POINTING_DEVICE) {
-        	devices.RemoveItem(i);
-        	delete info;
-        }
-    }
-    
-    count = devices.CountItems();
-    for (uint i = 0; i < count; i++) {
-    	DeviceStructure* device = new DeviceStructure();
-    	device->device = static_cast<BInputDevice*>(devices.ItemAt(i));
-    	device->name.SetTo(device->device->Name());
-    	device->enabled = device->device->IsRunning();
-    	device->number = i;
-    	toReturn.AddItem(device, i);
-    }
-    
-    this->Clean(&devices, false);
-}
-
-
-void Clean(BList *in, bool cleaningGlobalDevices = false) {
-	if (!in) return;
-	uint count = in->CountItems();
-	for (int32 i = count-1; i >=0; i--) {
-		if (cleaningGlobalDevices) {
-			DeviceStructure* delStr = static_cast<DeviceStructure*>(in->ItemAt(i));
-//			delete delStr;
-		} else {
-			BInputDevice* delDev = static_cast<BInputDevice*>(in->ItemAt(i));
-//			delete delDev;
-		}
+
+	if (status != B_OK)
+		reply.AddString("message", strerror(status));
+	reply.AddInt32("error", status);
+	message->SendReply(&reply);
+	return true;
+}
+
+// The cached device addressed by an index or a name specifier
+DeviceEntry* TrayView::FindCachedDevice(BMessage* specifier, int32 form)
+{
+	if (form == B_INDEX_SPECIFIER) {
+		int32 index;
+		if (specifier->FindInt32("index", &index) != B_OK)
+			return NULL;
+		return fDevices.ItemAt(index);
 	}
-	in->MakeEmpty();
+	const char* name;
+	if (specifier->FindString("name", &name) != B_OK)
+		return NULL;
+	return fDevices.FindByName(name);
 }
 
+// Stores the new status of the device, then stops, throttles or starts it
+// as its strategy says. The last usable device is never ignored.
+status_t TrayView::SetIgnored(DeviceEntry* device, bool ignored)
+{
+	if (ignored && IsUsable(*device) && CountUsable() <= 1)
+		return B_NOT_ALLOWED;
+	fIgnoreSettings.SetStatus(device->name, ignored, device->ordinal);
+	SaveSettings(fIgnoreSettings);
+	return ApplyStrategy(device);
+}
 
-void ListDevices() {
-	BList devices;
-	BuildListOfDevices();
-	
-    int32 count = 0;
-    count = fInputDevices.CountItems();
-
-	if (count) printf("Connected pointing devices:\n");
-    for (int32 i = 0; i < count; i++) {
-    	DeviceStructure* dev = (DeviceStructure*)gDevices.ItemAt(i);
-    	
-        printf(" %d. %s - %s\n", dev->number,
-        			 dev->device->Name(),
-            		(dev->enabled ? "enabled" : "disabled"));
-    }
+// Stores which events of the device the add-on drops. Like the CLI's "mask",
+// the moves of the last usable device are never dropped.
+status_t TrayView::SetSuppressMask(DeviceEntry* device, uint8 mask)
+{
+	if ((mask & (1 << kEventMotion)) != 0 && IsUsable(*device)
+		&& fDevices.CountUsable(fIgnoreSettings, device) == 0)
+		return B_NOT_ALLOWED;
+	fIgnoreSettings.SetSuppressMask(device->name, mask, device->ordinal);
+	SaveSettings(fIgnoreSettings);
+	return B_OK;
+}
+
+// Stops, throttles or starts the device as its stored status and strategy
+// say. The add-on drops the events of an ignored device whatever happens here.
+// A device named like another one is left to the add-on, as the control goes
+// by the name and could silence the other one instead.
+status_t TrayView::ApplyStrategy(DeviceEntry* device)
+{
+	bool ignored = fIgnoreSettings.GetStatus(device->name, device->ordinal);
+	suppress_strategy strategy = fIgnoreSettings.GetEffectiveStrategy(device->name, device->ordinal);
+	if (device->duplicate)
+		strategy = kStrategyFilter;
+	else if (fIgnoreSettings.GetStrategy(device->name, device->ordinal) == kStrategyThrottle)
+		fControl->Throttle(device->name, ignored);
+	status_t status = B_OK;
+	if (strategy == kStrategyStop && device->running)
+		status = fControl->Suppress(device->name);
+	else if (strategy != kStrategyStop && !device->running)
+		status = fControl->Release(device->name);
+	if (status == B_OK)
+		device->running = strategy != kStrategyStop;
+	return status;
+}
+
+// Switches to the profile, then starts, stops or throttles every device as
+// it says, like the CLI's "profile". A profile which would leave no usable
+// pointer isn't activated.
+status_t TrayView::ActivateProfile(const BString& name)
+{
+	fDevices.Refresh(fControl);
+	status_t status = fIgnoreSettings.ActivateProfile(name);
+	if (status != B_OK)
+		return status;
+	if (fDevices.CountItems() > 0 && fDevices.CountUsable(fIgnoreSettings, NULL, true) == 0) {
+		// Back to what is stored, nothing was saved yet
+		fIgnoreSettings.Load();
+		return B_NOT_ALLOWED;
+	}
+	SaveSettings(fIgnoreSettings);
+	for (DeviceEntry& device : fDevices)
+		ApplyStrategy(&device);
+	return B_OK;
+}
+
+// Saves the settings, marking the cached devices as connected first like the
+// CLI does, so the device history is compacted by the real age of the devices
+void TrayView::SaveSettings(::Settings& settings)
+{
+	std::vector<BString> names;
+	for (const DeviceEntry& device : fDevices)
+		names.push_back(device.name);
+	settings.MarkConnected(names);
+	settings.Save();
+}
+
+// A device is usable if it runs and the add-on passes its moves
+bool TrayView::IsUsable(const DeviceEntry& device)
+{
+	return DeviceTable::IsUsable(device, fIgnoreSettings);
+}
+
+// Number of the usable devices, see IsUsable()
+int32 TrayView::CountUsable()
+{
+	return fDevices.CountUsable(fIgnoreSettings);
+}
+
+// Maps the add-on's counters on first use. NULL if the add-on isn't running.
+const CountersArea* TrayView::Counters()
+{
+	if (fCounters.Map() != B_OK)
+		return NULL;
+	return fCounters.Area();
+}
+
+// Lists the devices again, for the menu which is about to be shown
+const DeviceTable& TrayView::RefreshDevices()
+{
+	fDevices.Refresh(fControl);
+	return fDevices;
+}
+
+// Toggles the device of the menu item, never ignoring the last usable one
+void TrayView::Toggle(int deviceNo)
+{
+	DeviceEntry* device = fDevices.ItemAt(deviceNo);
+	if (device)
+		SetIgnored(device, IsUsable(*device));
+}
+
+// Starts all devices and forgets that any of them was ignored
+status_t TrayView::EnableAll()
+{
+	status_t status = fControl->ReleaseAll();
+	for (DeviceEntry& device : fDevices) {
+		device.running = true;
+		if (fIgnoreSettings.GetStrategy(device.name, device.ordinal) == kStrategyThrottle)
+			fControl->Throttle(device.name, false);
+	}
+	fIgnoreSettings.ClearAllIgnored();
+	SaveSettings(fIgnoreSettings);
+	return status;
 }
@@ -8,8 +8,14 @@
 #ifndef _GUI_VIEW_H_
 #define _GUI_VIEW_H_
 
+#include "background_task.h"
 #include "common.h"
+#include "counters.h"
+#include "device_control.h"
+#include "device_table.h"
 #include "GUISettings.h"
+#include "hotplug.h"
+#include "settings.h"
 
 #include <InterfaceDefs.h>
 #include <TranslationKit.h>
@@ -17,6 +23,7 @@
 #include <List.h>
 #include <InputDevice.h>
 #include <OS.h>
+#include <PropertyInfo.h>
 
 
 #include <Roster.h>
@@ -32,6 +39,9 @@
 
 
 
+// Scripting suite of the replicant, see TrayView::GetSupportedSuites()
+#define IGNORE_TOUCHPAD_SUITE "suite/vnd.IgnoreTouchpad-tray"
+
 //exported instantiator function
 extern "C" _EXPORT BView* instantiate_deskbar_item();
 
@@ -44,20 +54,6 @@ status_t removeFromDeskbar(void *);
 class _EXPORT TrayView;
 
 
-struct DeviceStructure {
-	BInputDevice* device;
-	BString		  deviceName;
-	bool		  enabled;
-	uint		  number;
-	
-	virtual ~DeviceStructure() {if (device) { delete device; device = NULL; }};
-};
-
-		
-void ListDevices();	
-void BuildDevicesList(BList& );
-void Clean(BList*, bool cleaningGlobalDevices = false);
-
 class TrayView : 
 	public BView
 {
@@ -67,7 +63,25 @@ class TrayView :
 		bool fWatching;
 
 		void _init(void); //initialization common to all constructors
-
+		status_t _LoadIcons(void);	// Runs on fIconLoader
+		BackgroundTask* fIconLoader;	// Loads the icons while the Deskbar goes on
+		status_t fIconStatus;			// Result of _LoadIcons(), once fIconLoader is joined
+		bigtime_t fCreatedAt;			// When _init() was entered
+
+		// Cached model for scripting, refreshed by notifications only
+		DeviceTable fDevices;			// The pointing devices, refreshed on hotplug
+		::Settings fIgnoreSettings;		// Loaded again when the file changes
+		BMessenger fSelf;				// Target of the notifications
+		DeviceControl* fControl;		// Starts and stops the devices
+		HotplugDebouncer fHotplug;		// Rebuilds fDevices once per burst of hotplug
+
+		bool HandleScripting(BMessage* message);
+		DeviceEntry* FindCachedDevice(BMessage* specifier, int32 form);
+		status_t SetIgnored(DeviceEntry* device, bool ignored);
+		status_t SetSuppressMask(DeviceEntry* device, uint8 mask);
+		status_t ApplyStrategy(DeviceEntry* device);
+		status_t ActivateProfile(const BString& name);
+		void SaveSettings(::Settings& settings);
 		
 
 	public:
@@ -77,9 +91,12 @@ class TrayView :
 		bigtime_t polling_delay;
 		sem_id fPollerSem;
 		thread_id poller_thread;
+		SharedCounters fCounters;		// Read-only view of the add-on's counters
 		
-		Toggle(int deviceNo);
-		EnableAll();
+		void Toggle(int deviceNo);
+		status_t EnableAll();
+		bool IsUsable(const DeviceEntry& device);
+		int32 CountUsable();
 
 		TrayView();
 		TrayView(BMessage *mdArchive);
@@ -90,11 +107,17 @@ class TrayView :
 
 		virtual void Draw(BRect updateRect );
 		virtual void AttachedToWindow();
+		virtual void DetachedFromWindow();
 		virtual void MouseDown(BPoint where);
 		virtual void MessageReceived(BMessage* message);
 		virtual void GetPreferredSize(float *w, float *h);
+		virtual BHandler* ResolveSpecifier(BMessage* message, int32 index,
+			BMessage* specifier, int32 form, const char* property);
+		virtual status_t GetSupportedSuites(BMessage* data);
 
 		void SetActive(bool);
+		const CountersArea* Counters();
+		const DeviceTable& RefreshDevices();
 };
 
 int32 fronter(void *);
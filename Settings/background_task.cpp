@@ -0,0 +1,62 @@
+/*
+	Copyright 2025, Alexey "Hitech" Burshtein.   All Rights Reserved.
+	This file may be used under the terms of the MIT License.
+*/
+
+/**
+ * @file background_task.cpp
+ * @brief Implementation of the BackgroundTask class.
+ * @ingroup SettingsModule
+ */
+
+#include "background_task.h"
+
+
+/**	\brief		Constructor. Starts the job right away.
+ *	\param[in]	name		Name of the thread.
+ *	\param[in]	job			The job. Everything it touches must outlive the task.
+ *	\param[in]	priority	Priority of the thread.
+ */
+BackgroundTask::BackgroundTask(const char* name, std::function<void()> job,
+	int32 priority)
+	:	fJob(job),
+		fThread(-1)
+{
+	fThread = spawn_thread(&BackgroundTask::Run, name, priority, this);
+	if (fThread < 0 || B_OK != resume_thread(fThread)) {
+		if (fThread >= 0) { kill_thread(fThread); }
+		fThread = -1;
+		fJob();
+	}
+}
+
+
+/**	\brief		Destructor. Waits for the job to finish.
+ */
+BackgroundTask::~BackgroundTask()
+{
+	Wait();
+}
+
+
+/**	\brief		Waits for the job to finish. Returns at once if it's already joined.
+ */
+void
+BackgroundTask::Wait()
+{
+	if (fThread < 0) { return; }
+	status_t result;
+	wait_for_thread(fThread, &result);
+	fThread = -1;
+}
+
+
+/**	\brief		Body of the thread.
+ *	\param[in]	data	The task.
+ */
+int32
+BackgroundTask::Run(void* data)
+{
+	static_cast<BackgroundTask*>(data)->fJob();
+	return B_OK;
+}
@@ -0,0 +1,58 @@
+/*
+	Copyright 2025, Alexey "Hitech" Burshtein.   All Rights Reserved.
+	This file may be used under the terms of the MIT License.
+*/
+
+/**
+ * @file background_task.h
+ * @brief A job run on its own thread, to overlap the independent startup stages.
+ * @ingroup SettingsModule
+ *
+ * At startup the CLI and the Deskbar replicant wait for input_server to list
+ * the devices, for the disk to return the settings file, and for the
+ * resources of the image. None of these depend on each other, so each of them
+ * can be started as a BackgroundTask and joined with Wait() right before its
+ * result is first used.
+ *
+ * How much this saves hasn't been measured yet: a thread costs a spawn and a
+ * join, which may well eat the gain when the file is in the cache. Take
+ * `ignore_touchpad --timings list` on Haiku before relying on it.
+ */
+
+#ifndef _BACKGROUND_TASK_H_
+#define _BACKGROUND_TASK_H_
+
+#include <OS.h>
+#include <SupportDefs.h>
+
+#include <functional>
+
+
+/**	\class		BackgroundTask
+ *	\brief		Runs a job on a new thread, and joins it on Wait() or on destruction.
+ *	\details	If the thread can't be spawned, the job is run by the constructor,
+ *				so the results are there after Wait() either way.
+ *	\note		Wait() must be called by a single thread.
+ */
+class BackgroundTask {
+public:
+	//!	\copydoc	BackgroundTask::BackgroundTask
+	BackgroundTask(const char* name, std::function<void()> job,
+		int32 priority = B_NORMAL_PRIORITY);
+	~BackgroundTask();							//!<	\copydoc	BackgroundTask::~BackgroundTask
+
+	void Wait();								//!<	\copydoc	BackgroundTask::Wait
+	//!	`true` once the job has finished and was joined.
+	bool IsDone() const { return fThread < 0; }
+
+private:
+	BackgroundTask(const BackgroundTask&);
+	BackgroundTask& operator=(const BackgroundTask&);
+
+	static int32 Run(void* data);				//!<	\copydoc	BackgroundTask::Run
+
+	std::function<void()>	fJob;		//!<	What the thread does
+	thread_id				fThread;	//!<	The thread, -1 once joined
+};
+
+#endif // _BACKGROUND_TASK_H_
@@ -0,0 +1,280 @@
+/*
+	Copyright 2025, Alexey "Hitech" Burshtein.   All Rights Reserved.
+	This file may be used under the terms of the MIT License.
+*/
+
+/**
+ * @file counters.cpp
+ * @brief Implementation of the SharedCounters class.
+ * @ingroup SettingsModule
+ */
+
+#include "counters.h"
+
+#include <string.h>
+
+#ifndef __HAIKU__
+#	include <errno.h>
+#	include <fcntl.h>
+#	include <sys/mman.h>
+#	include <unistd.h>
+
+//!	Name of the POSIX shared memory object standing in for the area.
+static const char* kCountersShmName = "/IgnoreTouchpad-counters";
+#endif
+
+
+//!	Size of the area, rounded up to the whole pages.
+static const size_t kCountersAreaSize
+	= (sizeof(CountersArea) + B_PAGE_SIZE - 1) / B_PAGE_SIZE * B_PAGE_SIZE;
+
+
+/**	\brief		Constructor. Nothing is mapped yet.
+ */
+SharedCounters::SharedCounters()
+	:	fArea(NULL),
+		fWritable(false)
+#ifdef __HAIKU__
+		, fAreaId(-1)
+#else
+		, fFd(-1)
+#endif
+{
+}
+
+
+/**	\brief		Destructor. Unmaps the area; the publisher also destroys it.
+ */
+SharedCounters::~SharedCounters()
+{
+	Unmap();
+}
+
+
+/**	\brief		Creates the area and initializes it. Called by the add-on only.
+ *	\returns	B_OK if the area is ready for writing, an error code otherwise.
+ */
+status_t
+SharedCounters::Publish()
+{
+	if (fArea) { return fWritable ? B_OK : B_NOT_ALLOWED; }
+
+	void* address = NULL;
+#ifdef __HAIKU__
+	fAreaId = create_area(IGNORE_COUNTERS_AREA_NAME, &address, B_ANY_ADDRESS,
+		kCountersAreaSize, B_NO_LOCK, B_READ_AREA | B_WRITE_AREA | B_CLONEABLE_AREA);
+	if (fAreaId < 0) { return fAreaId; }
+#else
+	shm_unlink(kCountersShmName);
+	fFd = shm_open(kCountersShmName, O_CREAT | O_EXCL | O_RDWR, 0644);
+	if (fFd < 0) { return errno; }
+	if (ftruncate(fFd, kCountersAreaSize) != 0) {
+		status_t status = errno;
+		close(fFd);
+		fFd = -1;
+		return status;
+	}
+	address = mmap(NULL, kCountersAreaSize, PROT_READ | PROT_WRITE, MAP_SHARED, fFd, 0);
+	if (address == MAP_FAILED) {
+		status_t status = errno;
+		close(fFd);
+		fFd = -1;
+		return status;
+	}
+#endif
+
+	// Fresh memory is zeroed, so the counters are zeroes already
+	fArea = static_cast<CountersArea*>(address);
+	fWritable = true;
+	fArea->magic = IGNORE_COUNTERS_MAGIC;
+	fArea->version = IGNORE_COUNTERS_VERSION;
+	fArea->deviceCount.store(0, std::memory_order_release);
+	return B_OK;
+}
+
+
+/**	\brief		Maps the area published by the add-on, read-only.
+ *	\returns	B_OK				If the area is mapped and has the expected layout.
+ *				B_NAME_NOT_FOUND	If the add-on isn't running.
+ *				B_MISMATCHED_VALUES	If the add-on is of a different version.
+ *				Some other error	If the area could not be mapped.
+ */
+status_t
+SharedCounters::Map()
+{
+	if (fArea) { return B_OK; }
+
+	void* address = NULL;
+#ifdef __HAIKU__
+	area_id source = find_area(IGNORE_COUNTERS_AREA_NAME);
+	if (source < 0) { return B_NAME_NOT_FOUND; }
+	fAreaId = clone_area(IGNORE_COUNTERS_AREA_NAME " (reader)", &address,
+		B_ANY_ADDRESS, B_READ_AREA, source);
+	if (fAreaId < 0) { return fAreaId; }
+#else
+	fFd = shm_open(kCountersShmName, O_RDONLY, 0);
+	if (fFd < 0) { return errno == ENOENT ? B_NAME_NOT_FOUND : errno; }
+	address = mmap(NULL, kCountersAreaSize, PROT_READ, MAP_SHARED, fFd, 0);
+	if (address == MAP_FAILED) {
+		status_t status = errno;
+		close(fFd);
+		fFd = -1;
+		return status;
+	}
+#endif
+
+	fArea = static_cast<CountersArea*>(address);
+	fWritable = false;
+	if (fArea->magic != IGNORE_COUNTERS_MAGIC
+		|| fArea->version != IGNORE_COUNTERS_VERSION)
+	{
+		Unmap();
+		return B_MISMATCHED_VALUES;
+	}
+	return B_OK;
+}
+
+
+/**	\brief		Unmaps the area. The publisher also removes it from the system.
+ */
+void
+SharedCounters::Unmap()
+{
+	if (!fArea) { return; }
+#ifdef __HAIKU__
+	delete_area(fAreaId);
+	fAreaId = -1;
+#else
+	munmap(fArea, kCountersAreaSize);
+	close(fFd);
+	fFd = -1;
+	if (fWritable) { shm_unlink(kCountersShmName); }
+#endif
+	fArea = NULL;
+	fWritable = false;
+}
+
+
+/**	\brief		Looks for the slot of the device.
+ *	\param[in]	fingerprint	DeviceFingerprint() of the device, so identical
+ *							devices are told apart.
+ *	\returns	Index of the slot, or -1 if the device has none.
+ */
+int32
+SharedCounters::FindDevice(uint64 fingerprint) const
+{
+	if (!fArea) { return -1; }
+
+	int32 count = fArea->deviceCount.load(std::memory_order_acquire);
+	for (int32 i = 0; i < count; i++) {
+		if (fArea->devices[i].fingerprint == fingerprint) { return i; }
+	}
+	return -1;
+}
+
+
+/**	\brief		Returns the slot of the device, claiming a new one if necessary.
+ *	\param[in]	fingerprint	DeviceFingerprint() of the device.
+ *	\param[in]	name		Name of the device, for display.
+ *	\returns	Index of the slot, or -1 if all slots are taken or the area isn't writable.
+ *	\note		Only the publisher may call this, and only from one thread.
+ */
+int32
+SharedCounters::AddDevice(uint64 fingerprint, const char* name)
+{
+	int32 slot = FindDevice(fingerprint);
+	if (slot >= 0 || !fWritable) { return slot; }
+
+	int32 count = fArea->deviceCount.load(std::memory_order_relaxed);
+	if (count >= kMaxCounterDevices) { return -1; }
+
+	strlcpy(fArea->devices[count].name, name, kSnapshotNameLength);
+	fArea->devices[count].fingerprint = fingerprint;
+	fArea->deviceCount.store(count + 1, std::memory_order_release);
+	return count;
+}
+
+
+/**	\brief		Counts a single event.
+ *	\param[in]	slot	Slot returned by AddDevice(). Invalid slots are ignored.
+ *	\param[in]	passed	`true` if the event was passed on.
+ *	\param[in]	reason	Why the event was dropped. Ignored if `passed` is `true`.
+ *	\param[in]	when	Time of the event.
+ */
+void
+SharedCounters::Count(int32 slot, bool passed, drop_reason reason, bigtime_t when)
+{
+	if (!fWritable || slot < 0 || slot >= kMaxCounterDevices) { return; }
+
+	DeviceCounters& counters = fArea->devices[slot];
+	counters.seen.fetch_add(1, std::memory_order_relaxed);
+	if (passed) {
+		counters.passed.fetch_add(1, std::memory_order_relaxed);
+	} else {
+		counters.dropped[reason].fetch_add(1, std::memory_order_relaxed);
+	}
+	counters.lastActivity.store(when, std::memory_order_relaxed);
+}
+
+
+/**	\brief		Records what the device was seen doing, see device_trait.
+ *	\param[in]	slot	Slot returned by AddDevice(). Invalid slots are ignored.
+ *	\param[in]	traits	device_trait bits of the event.
+ *	\details	The bits only ever get set, and mostly are already, so the
+ *				shared cache line is only written the first time.
+ */
+void
+SharedCounters::AddTraits(int32 slot, uint32 traits)
+{
+	if (!fWritable || slot < 0 || slot >= kMaxCounterDevices) { return; }
+
+	std::atomic<uint32>& current = fArea->devices[slot].traits;
+	if ((current.load(std::memory_order_relaxed) & traits) != traits) {
+		current.fetch_or(traits, std::memory_order_relaxed);
+	}
+}
+
+
+/**	\brief		Claims a record of the trace ring for a traced change.
+ *	\param[in]	id			Correlation id of the change, see Settings::SetTrace().
+ *	\param[in]	started		When the command was issued.
+ *	\param[in]	saved		When the snapshot was written.
+ *	\param[in]	notified	When the add-on was told about the new snapshot.
+ *	\returns	Index of the record for MarkTrace(), or -1 if the area isn't writable.
+ *	\note		Only the publisher may call this, and only from one thread.
+ */
+int32
+SharedCounters::BeginTrace(uint32 id, bigtime_t started, bigtime_t saved,
+	bigtime_t notified)
+{
+	if (!fWritable || id == 0) { return -1; }
+
+	uint32 ticket = fArea->traceCount.load(std::memory_order_relaxed);
+	int32 index = ticket % kMaxTraces;
+	TraceRecord& record = fArea->traces[index];
+
+	// Readers skip the record until its id is set again
+	record.id.store(0, std::memory_order_relaxed);
+	std::atomic_thread_fence(std::memory_order_release);
+	record.started = started;
+	record.stages[kTraceSaved].store(saved, std::memory_order_relaxed);
+	record.stages[kTraceNotified].store(notified, std::memory_order_relaxed);
+	record.stages[kTraceApplied].store(0, std::memory_order_relaxed);
+	record.stages[kTraceFirstDrop].store(0, std::memory_order_relaxed);
+	record.id.store(id, std::memory_order_release);
+	fArea->traceCount.store(ticket + 1, std::memory_order_release);
+	return index;
+}
+
+
+/**	\brief		Records that a traced change reached a stage.
+ *	\param[in]	trace	Record returned by BeginTrace(). Invalid records are ignored.
+ *	\param[in]	stage	The stage.
+ *	\param[in]	when	`system_time()` when the stage was reached.
+ */
+void
+SharedCounters::MarkTrace(int32 trace, trace_stage stage, bigtime_t when)
+{
+	if (!fWritable || trace < 0 || trace >= kMaxTraces) { return; }
+	fArea->traces[trace].stages[stage].store(when, std::memory_order_relaxed);
+}
@@ -0,0 +1,155 @@
+/*
+	Copyright 2025, Alexey "Hitech" Burshtein.   All Rights Reserved.
+	This file may be used under the terms of the MIT License.
+*/
+
+/**
+ * @file counters.h
+ * @brief Per-device event counters shared by the add-on with everyone else.
+ * @ingroup SettingsModule
+ *
+ * The add-on publishes a small shared memory area and bumps the counters in
+ * it on every pointer event, using relaxed atomics. The CLI and the Deskbar
+ * replicant map the same area read-only, so asking "what is the touchpad
+ * doing" costs no messages at all, and the filter never has to answer any
+ * requests. On Haiku the area is created with `create_area()`; elsewhere a
+ * POSIX shared memory object with the same layout stands in for it.
+ *
+ * The area also keeps the last kMaxTraces traced settings changes (see
+ * Settings::SetTrace()): when each of them was issued, saved, noticed and
+ * applied by the add-on, and when the first event of its device was dropped.
+ */
+
+#ifndef _COUNTERS_H_
+#define _COUNTERS_H_
+
+#include "platform.h"
+
+#include <atomic>
+
+#include "snapshot.h"
+
+
+//!	Name of the area (or of the POSIX shared memory object).
+#define IGNORE_COUNTERS_AREA_NAME	"IgnoreTouchpad counters"
+//!	Magic number in the beginning of the area.
+#define IGNORE_COUNTERS_MAGIC		'ITcn'
+//!	Bumped every time the layout of the area changes.
+#define IGNORE_COUNTERS_VERSION		7
+
+const int32	kMaxCounterDevices = 32;		//!<	Devices beyond this are not counted.
+const int32	kMaxTraces = 64;				//!<	Older traced changes are overwritten.
+
+
+/**	\enum		drop_reason
+ *	\brief		Why the filter dropped an event.
+ */
+enum drop_reason {
+	kDropIgnored = 0,		//!<	The device is ignored
+	kDropWhileActive,		//!<	Another device is in active use
+	kDropMasked,			//!<	This class of events is suppressed for the device
+	kDropFocused,			//!<	An application the device is ignored for is active
+	kDropReasonCount		//!<	Number of reasons, not a reason itself
+};
+
+
+/**	\struct		DeviceCounters
+ *	\brief		Counters of a single device.
+ *	\note		Only the add-on writes here. The name and the fingerprint are
+ *				written once, before the slot is published via
+ *				CountersArea::deviceCount.
+ */
+struct DeviceCounters {
+	char					name[kSnapshotNameLength];		//!<	Name of the device
+	uint64					fingerprint;					//!<	DeviceFingerprint() of the device
+	std::atomic<int64>		seen;							//!<	Pointer events seen
+	std::atomic<int64>		passed;							//!<	Events passed on
+	std::atomic<int64>		dropped[kDropReasonCount];		//!<	Events dropped, per reason
+	std::atomic<bigtime_t>	lastActivity;					//!<	`system_time()` of the last event
+	std::atomic<uint32>		traits;							//!<	device_trait bits seen so far
+};
+
+
+/**	\enum		trace_stage
+ *	\brief		Stages a traced settings change goes through, in this order.
+ */
+enum trace_stage {
+	kTraceSaved = 0,		//!<	The snapshot was written
+	kTraceNotified,			//!<	The add-on was told that the snapshot changed
+	kTraceApplied,			//!<	The add-on enforces the new state
+	kTraceFirstDrop,		//!<	The first event of the device was dropped
+	kTraceStageCount		//!<	Number of stages, not a stage itself
+};
+
+
+/**	\struct		TraceRecord
+ *	\brief		Timeline of a single traced change, all times are `system_time()`.
+ *	\note		Only the add-on writes here. `id` is 0 while the record is being
+ *				reused; a stage that wasn't reached yet is 0.
+ */
+struct TraceRecord {
+	std::atomic<uint32>		id;								//!<	Correlation id of the change
+	bigtime_t				started;						//!<	When the command was issued
+	std::atomic<bigtime_t>	stages[kTraceStageCount];		//!<	When each stage was reached
+};
+
+
+/**	\struct		CountersArea
+ *	\brief		Layout of the whole shared area.
+ */
+struct CountersArea {
+	uint32					magic;			//!<	Always IGNORE_COUNTERS_MAGIC
+	uint32					version;		//!<	Always IGNORE_COUNTERS_VERSION
+	std::atomic<int32>		deviceCount;	//!<	Number of published slots
+	DeviceCounters			devices[kMaxCounterDevices];	//!<	The slots
+	std::atomic<uint32>		traceCount;		//!<	Number of traces ever started
+	TraceRecord				traces[kMaxTraces];	//!<	The last traces, a ring
+};
+
+
+static_assert(std::atomic<int64>::is_always_lock_free,
+	"The counters are shared between processes, their atomics must be lock-free");
+
+
+/**	\class		SharedCounters
+ *	\brief		Owner or reader of the counters area.
+ *	\details	The add-on calls Publish() and gets a writable mapping; everyone
+ *				else calls Map() and gets a read-only one.
+ */
+class SharedCounters {
+public:
+	SharedCounters();						//!<	\copydoc	SharedCounters::SharedCounters
+	~SharedCounters();						//!<	\copydoc	SharedCounters::~SharedCounters
+
+	status_t Publish();						//!<	\copydoc	SharedCounters::Publish
+	status_t Map();							//!<	\copydoc	SharedCounters::Map
+	void Unmap();							//!<	\copydoc	SharedCounters::Unmap
+
+	//!	The mapped area, or `NULL` if neither Publish() nor Map() succeeded.
+	const CountersArea* Area() const { return fArea; }
+
+	//!	\copydoc	SharedCounters::FindDevice
+	int32 FindDevice(uint64 fingerprint) const;
+	//!	\copydoc	SharedCounters::AddDevice
+	int32 AddDevice(uint64 fingerprint, const char* name);
+	//!	\copydoc	SharedCounters::Count
+	void Count(int32 slot, bool passed, drop_reason reason, bigtime_t when);
+	//!	\copydoc	SharedCounters::AddTraits
+	void AddTraits(int32 slot, uint32 traits);
+
+	//!	\copydoc	SharedCounters::BeginTrace
+	int32 BeginTrace(uint32 id, bigtime_t started, bigtime_t saved, bigtime_t notified);
+	//!	\copydoc	SharedCounters::MarkTrace
+	void MarkTrace(int32 trace, trace_stage stage, bigtime_t when);
+
+protected:
+	CountersArea*	fArea;			//!<	The mapping
+	bool			fWritable;		//!<	`true` if this is the publisher
+#ifdef __HAIKU__
+	area_id			fAreaId;		//!<	Our own area (or clone)
+#else
+	int				fFd;			//!<	File descriptor of the shared memory object
+#endif
+};
+
+#endif // _COUNTERS_H_
@@ -0,0 +1,301 @@
+/*
+	Copyright 2025, Alexey "Hitech" Burshtein.   All Rights Reserved.
+	This file may be used under the terms of the MIT License.
+*/
+
+/**
+ * @file device_control.cpp
+ * @brief The Haiku and Linux implementations of DeviceControl.
+ * @ingroup SettingsModule
+ */
+
+#include "device_control.h"
+
+#ifdef __HAIKU__
+#	include <Input.h>
+#	include <List.h>
+#	include <Message.h>
+#else
+#	include <dirent.h>
+#	include <errno.h>
+#	include <fcntl.h>
+#	include <linux/input.h>
+#	include <sys/ioctl.h>
+#	include <unistd.h>
+#	include <algorithm>
+#	include <string>
+#	include <unordered_map>
+#endif
+
+#include <stdio.h>
+#include <string.h>
+
+
+#ifdef __HAIKU__
+
+/**	\class		HaikuDeviceControl
+ *	\brief		DeviceControl on top of BInputDevice.
+ *	\note		Not to be used from the event path of the add-on: the calls
+ *				wait for input_server.
+ */
+class HaikuDeviceControl : public DeviceControl {
+public:
+	virtual status_t GetPointingDevices(std::vector<std::string>* names);
+	virtual status_t Suppress(const char* name);
+	virtual status_t Release(const char* name);
+	virtual status_t ReleaseAll();
+	virtual bool IsSuppressed(const char* name);
+	virtual status_t Throttle(const char* name, bool throttled);
+};
+
+
+status_t
+HaikuDeviceControl::GetPointingDevices(std::vector<std::string>* names)
+{
+	BList devices;
+	status_t status = get_input_devices(&devices);
+	if (B_OK != status) { return status; }
+
+	for (int32 i = 0; i < devices.CountItems(); i++) {
+		BInputDevice* device = static_cast<BInputDevice*>(devices.ItemAt(i));
+		if (device->Type() == B_POINTING_DEVICE) { names->push_back(device->Name()); }
+		delete device;
+	}
+	return B_OK;
+}
+
+
+status_t
+HaikuDeviceControl::Suppress(const char* name)
+{
+	BInputDevice* device = find_input_device(name);
+	if (!device) { return B_NAME_NOT_FOUND; }
+	status_t status = device->Stop();
+	delete device;
+	return status;
+}
+
+
+status_t
+HaikuDeviceControl::Release(const char* name)
+{
+	BInputDevice* device = find_input_device(name);
+	if (!device) { return B_NAME_NOT_FOUND; }
+	status_t status = device->IsRunning() ? B_OK : device->Start();
+	delete device;
+	return status;
+}
+
+
+status_t
+HaikuDeviceControl::ReleaseAll()
+{
+	return BInputDevice::Start(B_POINTING_DEVICE);
+}
+
+
+bool
+HaikuDeviceControl::IsSuppressed(const char* name)
+{
+	BInputDevice* device = find_input_device(name);
+	if (!device) { return false; }
+	bool stopped = !device->IsRunning();
+	delete device;
+	return stopped;
+}
+
+
+status_t
+HaikuDeviceControl::Throttle(const char* name, bool throttled)
+{
+	BInputDevice* device = find_input_device(name);
+	if (!device) { return B_NAME_NOT_FOUND; }
+	BMessage request(kMsgThrottleDevice);
+	request.AddBool("throttled", throttled);
+	status_t status = device->Control(kMsgThrottleDevice, &request);
+	delete device;
+	return status;
+}
+
+
+/**	\brief		Returns the device control of the platform.
+ *	\note		The caller owns the returned object.
+ */
+DeviceControl*
+DeviceControl::Create()
+{
+	return new HaikuDeviceControl();
+}
+
+#else	// !__HAIKU__
+
+//!	Directory with the evdev nodes.
+static const char* const kEvdevDirectory = "/dev/input";
+
+//!	Tests a bit in the array filled by `EVIOCGBIT`.
+#define TEST_EVDEV_BIT(array, bit) \
+	(((array)[(bit) / (8 * sizeof(long))] >> ((bit) % (8 * sizeof(long)))) & 1)
+
+
+/**	\class		EvdevDeviceControl
+ *	\brief		DeviceControl on top of the Linux evdev nodes.
+ *	\details	A device is suppressed by an `EVIOCGRAB` on its node. The grab
+ *				lasts as long as the node stays open, so the object has to
+ *				live as long as the devices should stay suppressed, and
+ *				deleting it releases all of them. Nothing can keep a grab
+ *				after the process exits, the kernel drops it with the node.
+ *	\note		Devices with the same name are grabbed in the order of their
+ *				nodes, the first one that is not grabbed yet goes first.
+ */
+class EvdevDeviceControl : public DeviceControl {
+public:
+	virtual ~EvdevDeviceControl();
+
+	virtual status_t GetPointingDevices(std::vector<std::string>* names);
+	virtual status_t Suppress(const char* name);
+	virtual status_t Release(const char* name);
+	virtual status_t ReleaseAll();
+	virtual bool IsSuppressed(const char* name);
+	//!	evdev has no way to ask a driver to stop reporting.
+	virtual status_t Throttle(const char*, bool) { return B_NOT_SUPPORTED; }
+
+protected:
+	//!	Calls `visitor(path, fd, name)` for every pointing node, stops when it returns `true`.
+	template<typename Visitor>
+	status_t ForEachPointer(Visitor visitor);
+
+	//!	Grabbed nodes: path of the node, and its descriptor
+	std::unordered_map<std::string, int>		fGrabbed;
+	//!	Device name of each grabbed node
+	std::unordered_map<std::string, std::string>	fGrabbedNames;
+};
+
+
+EvdevDeviceControl::~EvdevDeviceControl()
+{
+	ReleaseAll();
+}
+
+
+template<typename Visitor>
+status_t
+EvdevDeviceControl::ForEachPointer(Visitor visitor)
+{
+	DIR* directory = opendir(kEvdevDirectory);
+	if (!directory) { return errno; }
+
+	// readdir() has no order, but the duplicates need a stable one
+	std::vector<std::string> nodes;
+	while (struct dirent* entry = readdir(directory)) {
+		if (strncmp(entry->d_name, "event", 5) == 0) { nodes.push_back(entry->d_name); }
+	}
+	closedir(directory);
+	std::sort(nodes.begin(), nodes.end(), [](const std::string& a, const std::string& b) {
+		return a.size() != b.size() ? a.size() < b.size() : a < b;
+	});
+
+	for (const std::string& node : nodes) {
+		std::string path = std::string(kEvdevDirectory) + "/" + node;
+		int fd = open(path.c_str(), O_RDONLY | O_NONBLOCK | O_CLOEXEC);
+		if (fd < 0) { continue; }
+
+		char name[256] = "";
+		unsigned long relBits[REL_MAX / (8 * sizeof(long)) + 1] = { 0 };
+		unsigned long keyBits[KEY_MAX / (8 * sizeof(long)) + 1] = { 0 };
+		ioctl(fd, EVIOCGNAME(sizeof(name)), name);
+		ioctl(fd, EVIOCGBIT(EV_REL, sizeof(relBits)), relBits);
+		ioctl(fd, EVIOCGBIT(EV_KEY, sizeof(keyBits)), keyBits);
+
+		// Mice move relatively, touchpads report finger touches
+		bool pointer = TEST_EVDEV_BIT(relBits, REL_X)
+			|| TEST_EVDEV_BIT(keyBits, BTN_TOUCH) || TEST_EVDEV_BIT(keyBits, BTN_TOOL_FINGER);
+		bool stop = pointer && visitor(path, fd, name);
+		close(fd);
+		if (stop) { break; }
+	}
+	return B_OK;
+}
+
+
+status_t
+EvdevDeviceControl::GetPointingDevices(std::vector<std::string>* names)
+{
+	return ForEachPointer([names](const std::string&, int, const char* name) {
+		names->push_back(name);
+		return false;
+	});
+}
+
+
+status_t
+EvdevDeviceControl::Suppress(const char* name)
+{
+	status_t result = B_NAME_NOT_FOUND;
+	ForEachPointer([&](const std::string& path, int fd, const char* nodeName) {
+		if (strcmp(nodeName, name) != 0 || fGrabbed.count(path) != 0) { return false; }
+
+		// The descriptor of the visitor is closed after it, so the grab needs its own
+		int grabFd = dup(fd);
+		if (grabFd < 0 || ioctl(grabFd, EVIOCGRAB, 1) != 0) {
+			result = errno;
+			if (grabFd >= 0) { close(grabFd); }
+			return true;
+		}
+		fGrabbed[path] = grabFd;
+		fGrabbedNames[path] = name;
+		result = B_OK;
+		return true;
+	});
+	return result;
+}
+
+
+status_t
+EvdevDeviceControl::Release(const char* name)
+{
+	for (auto it = fGrabbedNames.begin(); it != fGrabbedNames.end(); ++it) {
+		if (it->second != name) { continue; }
+		int fd = fGrabbed[it->first];
+		ioctl(fd, EVIOCGRAB, 0);
+		close(fd);
+		fGrabbed.erase(it->first);
+		fGrabbedNames.erase(it);
+		return B_OK;
+	}
+	return B_OK;
+}
+
+
+status_t
+EvdevDeviceControl::ReleaseAll()
+{
+	for (auto& grabbed : fGrabbed) {
+		ioctl(grabbed.second, EVIOCGRAB, 0);
+		close(grabbed.second);
+	}
+	fGrabbed.clear();
+	fGrabbedNames.clear();
+	return B_OK;
+}
+
+
+bool
+EvdevDeviceControl::IsSuppressed(const char* name)
+{
+	for (const auto& grabbed : fGrabbedNames) {
+		if (grabbed.second == name) { return true; }
+	}
+	return false;
+}
+
+
+/**	\brief		Returns the device control of the platform.
+ *	\note		The caller owns the returned object.
+ */
+DeviceControl*
+DeviceControl::Create()
+{
+	return new EvdevDeviceControl();
+}
+
+#endif	// !__HAIKU__
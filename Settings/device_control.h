@@ -0,0 +1,66 @@
+/*
+	Copyright 2025, Alexey "Hitech" Burshtein.   All Rights Reserved.
+	This file may be used under the terms of the MIT License.
+*/
+
+/**
+ * @file device_control.h
+ * @brief Starting and stopping the input devices, per platform.
+ * @ingroup SettingsModule
+ *
+ * Besides dropping their events in the filter, the ignored devices can be
+ * stopped at the source. On Haiku this is `BInputDevice::Stop()`, which asks
+ * input_server to stop the device. On Linux an evdev node is grabbed with
+ * `EVIOCGRAB`, so nobody else receives its events; this lets the rest of the
+ * logic run and be measured outside of Haiku. The kernel drops a grab with
+ * the last descriptor of the node, so on Linux a device stays suppressed only
+ * while the process which suppressed it runs: a "disable" of the CLI is undone
+ * when it exits.
+ *
+ * A device can also be throttled: its driver is asked, through
+ * `BInputDevice::Control()`, to stop reporting while it keeps running. The
+ * stock input_server add-ons don't know the request and refuse it; a driver
+ * which knows it can stop sampling, which may be cheaper than a restart.
+ */
+
+#ifndef _DEVICE_CONTROL_H_
+#define _DEVICE_CONTROL_H_
+
+#include "platform.h"
+
+#include <string>
+#include <vector>
+
+
+/**	Sent to the device through `BInputDevice::Control()` by DeviceControl::Throttle().
+ *	The bool "throttled" tells whether the driver should stop reporting or go on. */
+const uint32	kMsgThrottleDevice = 'ITth';
+
+/**	\class		DeviceControl
+ *	\brief		Starts and stops the pointing devices of the platform.
+ *	\details	The devices are addressed by their names, the same names the
+ *				settings use. Get an instance with DeviceControl::Create().
+ */
+class DeviceControl {
+public:
+	virtual ~DeviceControl() {}
+
+	//!	Lists the names of the pointing devices, in the platform's order.
+	virtual status_t GetPointingDevices(std::vector<std::string>* names) = 0;
+	//!	Stops the device, so its events don't reach anyone.
+	virtual status_t Suppress(const char* name) = 0;
+	//!	Starts the device again.
+	virtual status_t Release(const char* name) = 0;
+	//!	Starts all pointing devices.
+	virtual status_t ReleaseAll() = 0;
+	//!	`true` if the device is stopped.
+	virtual bool IsSuppressed(const char* name) = 0;
+	/**	Asks the driver to stop reporting, or to go on, without stopping the
+	 *	device. B_NOT_SUPPORTED or the error of the driver if it can't. */
+	virtual status_t Throttle(const char* name, bool throttled) = 0;
+
+	//!	\copydoc	DeviceControl::Create
+	static DeviceControl* Create();
+};
+
+#endif // _DEVICE_CONTROL_H_
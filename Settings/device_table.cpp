@@ -0,0 +1,196 @@
+/*
+	Copyright 2025, Alexey "Hitech" Burshtein.   All Rights Reserved.
+	This file may be used under the terms of the MIT License.
+*/
+
+/**
+ * @file device_table.cpp
+ * @brief Implementation of DeviceTable.
+ * @ingroup SettingsModule
+ */
+
+#include "device_table.h"
+#include "device_control.h"
+#include "log.h"
+
+#ifdef __HAIKU__
+#	include <Input.h>
+#	include <List.h>
+#endif
+
+#include <string.h>
+
+#include <algorithm>
+
+
+/**	\brief		Constructor. The table is empty until Refresh().
+ */
+DeviceTable::DeviceTable()
+{
+}
+
+
+/**	\brief		Lists the connected pointing devices again.
+ *	\param[in]	control		Only used outside of Haiku: it lists the devices,
+ *							and tells which of them it stopped. Without it,
+ *							the table stays empty there.
+ *	\returns	B_OK, or the error of `get_input_devices()`. The table is
+ *				empty after an error.
+ *	\details	The classes of the devices are reset to kDeviceUnknown; the
+ *				CLI fills them from the settings.
+ *	\note		All the entries and their names are replaced.
+ */
+status_t
+DeviceTable::Refresh(DeviceControl* control)
+{
+	MakeEmpty();
+
+#ifdef __HAIKU__
+	(void)control;
+	BList devices;
+	status_t status = get_input_devices(&devices);
+	if (B_OK != status) {
+		LOG_ERROR("DeviceTable", "Failed to get input devices: %s", strerror(status));
+	}
+	for (int32 i = 0; i < devices.CountItems(); i++) {
+		BInputDevice* device = static_cast<BInputDevice*>(devices.ItemAt(i));
+		if (device && device->Type() == B_POINTING_DEVICE)
+			Add(device->Name(), device->IsRunning());
+		delete device;
+	}
+#else
+	status_t status = B_OK;
+	if (control) {
+		std::vector<std::string> names;
+		status = control->GetPointingDevices(&names);
+		for (const std::string& name : names)
+			Add(name.c_str(), !control->IsSuppressed(name.c_str()));
+	}
+#endif
+
+	// The names are in place now, the vector won't move any more
+	for (size_t i = 0; i < fEntries.size(); i++)
+		fEntries[i].name = fNames[i].text;
+
+	std::sort(fIndex.begin(), fIndex.end(), [](const IndexSlot& a, const IndexSlot& b) {
+		return a.fingerprint < b.fingerprint;
+	});
+	return status;
+}
+
+
+/**	\brief		Forgets all devices, keeping the storage for the next Refresh().
+ */
+void
+DeviceTable::MakeEmpty()
+{
+	fEntries.clear();
+	fNames.clear();
+	fIndex.clear();
+}
+
+
+/**	\brief		Returns the device with the fingerprint, `NULL` if it isn't connected.
+ */
+DeviceEntry*
+DeviceTable::Find(device_fingerprint fingerprint)
+{
+	auto found = std::lower_bound(fIndex.begin(), fIndex.end(), fingerprint,
+		[](const IndexSlot& slot, device_fingerprint value) { return slot.fingerprint < value; });
+	if (found == fIndex.end() || found->fingerprint != fingerprint) { return NULL; }
+	return &fEntries[found->number];
+}
+
+
+/**	\brief		Returns the first device with the name, `NULL` if none is connected.
+ *	\details	The first of the devices with the same name is the one with
+ *				ordinal 0, whose fingerprint is the hash of the name alone.
+ */
+DeviceEntry*
+DeviceTable::FindByName(const char* name)
+{
+	return Find(DeviceFingerprint(name, 0));
+}
+
+
+/**	\brief		Returns the number of the devices which aren't stopped.
+ */
+int32
+DeviceTable::CountRunning() const
+{
+	int32 running = 0;
+	for (const DeviceEntry& entry : *this) {
+		if (entry.running) { running++; }
+	}
+	return running;
+}
+
+
+/**	\brief		Tells whether a device can still move the pointer.
+ *	\param[in]	entry		The device.
+ *	\param[in]	settings	The policies to check, as they are or are about to be saved.
+ *	\param[in]	ifStarted	Count a stopped device as if it were running,
+ *							e.g. when it's about to be started.
+ *	\details	The device must run and must not be a tablet, and the add-on
+ *				must pass its moves: it isn't ignored, its mask doesn't drop
+ *				the moves, and no application silences it. A device which is
+ *				only ignored while another one is active stays usable, as the
+ *				other one is in use then.
+ */
+bool
+DeviceTable::IsUsable(const DeviceEntry& entry, const Settings& settings, bool ifStarted)
+{
+	if ((!entry.running && !ifStarted) || entry.deviceClass == kDeviceTablet) { return false; }
+	const DeviceInfo* stored = settings.GetDevice(entry.fingerprint);
+	if (!stored) { return true; }
+	return !stored->IsIgnored && (stored->SuppressMask & (1 << kEventMotion)) == 0
+		&& stored->IgnoreWhileFocused.empty();
+}
+
+
+/**	\brief		Counts the devices which can still move the pointer, see IsUsable().
+ *	\param[in]	except		A device not to count, e.g. the one about to be silenced.
+ */
+int32
+DeviceTable::CountUsable(const Settings& settings, const DeviceEntry* except,
+	bool ifStarted) const
+{
+	int32 usable = 0;
+	for (const DeviceEntry& entry : *this) {
+		if (&entry != except && IsUsable(entry, settings, ifStarted)) { usable++; }
+	}
+	return usable;
+}
+
+
+/**	\brief		Appends a device, numbering it and marking the ones with the same name.
+ *	\param[in]	name		Name of the device. Cut at kDeviceNameLength.
+ *	\param[in]	running		`true` if the device isn't stopped.
+ *	\note		`name` of the entry is set by Refresh(), once all are added.
+ */
+void
+DeviceTable::Add(const char* name, bool running)
+{
+	NameSlot slot;
+	strlcpy(slot.text, name, sizeof(slot.text));
+	fNames.push_back(slot);
+
+	DeviceEntry entry;
+	entry.number = (uint32)fEntries.size();
+	entry.ordinal = 0;
+	for (size_t i = 0; i < fEntries.size(); i++) {
+		if (strcmp(fNames[i].text, slot.text) == 0) {
+			entry.ordinal++;
+			fEntries[i].duplicate = true;
+		}
+	}
+	entry.duplicate = entry.ordinal > 0;
+	entry.fingerprint = DeviceFingerprint(slot.text, entry.ordinal);
+	entry.running = running;
+	entry.deviceClass = kDeviceUnknown;
+	entry.name = NULL;
+	fEntries.push_back(entry);
+
+	IndexSlot index = { entry.fingerprint, (int32)entry.number };
+	fIndex.push_back(index);
+}
@@ -0,0 +1,117 @@
+/*
+	Copyright 2025, Alexey "Hitech" Burshtein.   All Rights Reserved.
+	This file may be used under the terms of the MIT License.
+*/
+
+/**
+ * @file device_table.h
+ * @brief Flat table of the connected pointing devices, shared by the CLI and the replicant.
+ * @ingroup SettingsModule
+ *
+ * The devices are plain values in one contiguous array, in the order of
+ * `get_input_devices()`, so the number of a device is its index. The fields
+ * every listing and lookup reads come first and take half a cache line; the
+ * names, which are only read to print them or to address a device, live in
+ * a second array beside it. A sorted index maps the fingerprints to the
+ * positions.
+ *
+ * The table owns everything in it. The BInputDevice objects returned by
+ * input_server are deleted as soon as they were read; a device is started or
+ * stopped by its name, through DeviceControl, which can't tell identical
+ * devices apart, so only the add-on may silence a `duplicate` one. Refresh()
+ * reuses the storage of the previous one, so once the table has seen the
+ * usual number of devices, refreshing it allocates nothing.
+ */
+
+#ifndef _DEVICE_TABLE_H_
+#define _DEVICE_TABLE_H_
+
+#include <SupportDefs.h>
+
+#include <vector>
+
+#include "settings.h"
+
+class DeviceControl;
+
+
+//!	Longest name of a device the table keeps, including the terminating zero.
+const size_t	kDeviceNameLength = 256;
+
+
+/**	\struct		DeviceEntry
+ *	\brief		A connected pointing device.
+ *	\note		`name` points into the table and is valid until its next Refresh().
+ */
+struct DeviceEntry {
+	device_fingerprint	fingerprint;	//!<	DeviceFingerprint() of the name and the ordinal
+	uint32				number;			//!<	Index in the table, as shown by "list"
+	uint32				ordinal;		//!<	See DeviceInfo::Ordinal
+	bool				running;		//!<	Not stopped, as of the last Refresh() or change
+	bool				duplicate;		//!<	Another connected device has the same name
+	uint8				deviceClass;	//!<	device_class, kDeviceUnknown until classified
+	const char*			name;			//!<	Name of the device
+};
+
+
+/**	\class		DeviceTable
+ *	\brief		The connected pointing devices, see the file description.
+ *	\note		Not thread-safe. Not copyable, the entries point into the table.
+ */
+class DeviceTable {
+public:
+	DeviceTable();							//!<	\copydoc	DeviceTable::DeviceTable
+
+	//!	\copydoc	DeviceTable::Refresh
+	status_t Refresh(DeviceControl* control = NULL);
+	void MakeEmpty();						//!<	\copydoc	DeviceTable::MakeEmpty
+
+	//!	Number of the devices.
+	int32 CountItems() const { return (int32)fEntries.size(); }
+	//!	The device with the number, `NULL` if there's none.
+	DeviceEntry* ItemAt(int32 number) {
+		return number >= 0 && number < CountItems() ? &fEntries[number] : NULL;
+	}
+	//!	\copydoc	DeviceTable::ItemAt
+	const DeviceEntry* ItemAt(int32 number) const {
+		return number >= 0 && number < CountItems() ? &fEntries[number] : NULL;
+	}
+	//!	\copydoc	DeviceTable::Find
+	DeviceEntry* Find(device_fingerprint fingerprint);
+	//!	\copydoc	DeviceTable::FindByName
+	DeviceEntry* FindByName(const char* name);
+	int32 CountRunning() const;				//!<	\copydoc	DeviceTable::CountRunning
+	//!	\copydoc	DeviceTable::IsUsable
+	static bool IsUsable(const DeviceEntry& entry, const Settings& settings,
+		bool ifStarted = false);
+	//!	\copydoc	DeviceTable::CountUsable
+	int32 CountUsable(const Settings& settings, const DeviceEntry* except = NULL,
+		bool ifStarted = false) const;
+
+	DeviceEntry* begin() { return fEntries.data(); }
+	DeviceEntry* end() { return fEntries.data() + fEntries.size(); }
+	const DeviceEntry* begin() const { return fEntries.data(); }
+	const DeviceEntry* end() const { return fEntries.data() + fEntries.size(); }
+
+private:
+	DeviceTable(const DeviceTable&);
+	DeviceTable& operator=(const DeviceTable&);
+
+	void Add(const char* name, bool running);	//!<	\copydoc	DeviceTable::Add
+
+	//!	Storage of a name, cold.
+	struct NameSlot {
+		char	text[kDeviceNameLength];
+	};
+	//!	Entry of the fingerprint index.
+	struct IndexSlot {
+		device_fingerprint	fingerprint;
+		int32				number;
+	};
+
+	std::vector<DeviceEntry>	fEntries;	//!<	The devices, by number
+	std::vector<NameSlot>		fNames;		//!<	Their names, by number
+	std::vector<IndexSlot>		fIndex;		//!<	Sorted by fingerprint
+};
+
+#endif // _DEVICE_TABLE_H_
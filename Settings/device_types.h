@@ -0,0 +1,72 @@
+/*
+	Copyright 2025, Alexey "Hitech" Burshtein.   All Rights Reserved.
+	This file may be used under the terms of the MIT License.
+*/
+
+/**
+ * @file device_types.h
+ * @brief The identity of a device and the classes of its events.
+ * @ingroup SettingsModule
+ *
+ * These are all the filter's table of devices needs from the settings, so
+ * they live apart from settings.h, which needs the Haiku headers. That keeps
+ * DeviceSlots and TimerWheel buildable, and testable, off Haiku.
+ */
+
+#ifndef _DEVICE_TYPES_H_
+#define _DEVICE_TYPES_H_
+
+#include "platform.h"
+
+
+/**	\enum		event_class
+ *	\brief		Classes of pointer events, which may be suppressed separately.
+ *	\see		DeviceInfo::SuppressMask
+ */
+enum event_class {
+	kEventMotion = 0,		//!<	B_MOUSE_MOVED
+	kEventButtonDown,		//!<	B_MOUSE_DOWN of a physical button
+	kEventButtonUp,			//!<	B_MOUSE_UP of a physical button
+	kEventWheel,			//!<	B_MOUSE_WHEEL_CHANGED, i.e. scrolling
+	kEventTap,				//!<	B_MOUSE_DOWN or B_MOUSE_UP generated by a tap on a touchpad
+	kEventClassCount		//!<	Number of classes, not a class itself
+};
+
+//!	Mask with all event classes, i.e. the whole device.
+const uint8		kEventAllMask = (1 << kEventClassCount) - 1;
+
+
+/**	\typedef	device_fingerprint
+ *	\brief		64-bit identity of a device, see DeviceFingerprint().
+ *	\details	All lookups of the devices compare these as integers instead of
+ *				comparing the names.
+ */
+typedef uint64	device_fingerprint;
+
+
+/**	\brief		Computes the identity of a device.
+ *	\param[in]	name		Name of the device.
+ *	\param[in]	ordinal		Number of the device among those with the same name.
+ *	\returns	64-bit FNV-1a hash of the name, with the ordinal mixed in.
+ *	\details	BInputDevice exposes nothing about the bus or the path of a device,
+ *				so two identical mice differ only by their order. The fingerprint
+ *				of the first one (ordinal 0) is the hash of the name alone, which
+ *				is all the add-on can compute from an input event.
+ */
+inline device_fingerprint
+DeviceFingerprint(const char* name, uint32 ordinal = 0)
+{
+	const uint64 kPrime = 0x100000001b3ULL;
+	uint64 hash = 0xcbf29ce484222325ULL;
+	for (const uint8* c = (const uint8*)name; c && *c; c++) {
+		hash ^= *c;
+		hash *= kPrime;
+	}
+	for (int32 i = 0; ordinal && i < 4; i++) {
+		hash ^= (ordinal >> (i * 8)) & 0xff;
+		hash *= kPrime;
+	}
+	return hash;
+}
+
+#endif // _DEVICE_TYPES_H_
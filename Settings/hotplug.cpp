@@ -0,0 +1,142 @@
+/*
+	Copyright 2025, Alexey "Hitech" Burshtein.   All Rights Reserved.
+	This file may be used under the terms of the MIT License.
+*/
+
+/**
+ * @file hotplug.cpp
+ * @brief Implementation of HotplugDebouncer.
+ * @ingroup SettingsModule
+ */
+
+#include "hotplug.h"
+#include "log.h"
+
+#include <Input.h>
+#include <MessageRunner.h>
+
+
+/**	\brief		Constructor.
+ *	\param[in]	owner		Receives kMsgHotplugSettled, usually the looper
+ *							which gets the notifications. See SetOwner().
+ *	\param[in]	hysteresis	See SetHysteresis().
+ */
+HotplugDebouncer::HotplugDebouncer(const BMessenger& owner, bigtime_t hysteresis)
+	:
+	fOwner(owner),
+	fHysteresis(hysteresis > 0 ? hysteresis : 0),
+	fRunner(NULL),
+	fOpaque(false),
+	fStats()
+{
+}
+
+
+/**	\brief		Destructor. An open window is dropped, its kMsgHotplugSettled is never sent.
+ */
+HotplugDebouncer::~HotplugDebouncer()
+{
+	delete fRunner;
+}
+
+
+/**	\brief		Sets the length of the windows.
+ *	\param[in]	hysteresis	In microseconds. 0 or less passes each notification
+ *							right through, as if there were no debouncer.
+ *	\note		An open window keeps the length it was opened with.
+ */
+void
+HotplugDebouncer::SetHysteresis(bigtime_t hysteresis)
+{
+	fHysteresis = hysteresis > 0 ? hysteresis : 0;
+}
+
+
+/**	\brief		Takes a B_INPUT_DEVICES_CHANGED notification.
+ *	\param[in]	notification	The notification, with "be:opcode" and
+ *								"be:device_name". One without them always
+ *								leads to a reconcile.
+ *	\returns	`true` if the owner should reconcile now, which only happens
+ *				without hysteresis or if the window can't be timed.
+ *	\details	Opens a window if none is open; kMsgHotplugSettled is sent to
+ *				the owner when it ends.
+ */
+bool
+HotplugDebouncer::Transition(const BMessage* notification)
+{
+	fStats.transitions++;
+	if (fHysteresis == 0) {
+		fStats.reconciles++;
+		return true;
+	}
+
+	int32 opcode = 0;
+	const char* name = NULL;
+	if (!notification || B_OK != notification->FindInt32("be:opcode", &opcode)
+		|| B_OK != notification->FindString("be:device_name", &name) || !name)
+	{
+		fOpaque = true;
+	} else {
+		Balance* balance = NULL;
+		for (Balance& known : fBalances) {
+			if (known.name == name) { balance = &known; break; }
+		}
+		if (!balance) {
+			fBalances.push_back(Balance{ name, 0, 0 });
+			balance = &fBalances.back();
+		}
+		switch (opcode) {
+			case B_INPUT_DEVICE_ADDED:		balance->present++;	break;
+			case B_INPUT_DEVICE_REMOVED:	balance->present--;	break;
+			case B_INPUT_DEVICE_STARTED:	balance->running++;	break;
+			case B_INPUT_DEVICE_STOPPED:	balance->running--;	break;
+			default:						fOpaque = true;		break;
+		}
+	}
+
+	if (fRunner) {
+		fStats.coalesced++;
+		return false;
+	}
+
+	BMessage settled(kMsgHotplugSettled);
+	fRunner = new BMessageRunner(fOwner, &settled, fHysteresis, 1);
+	if (B_OK != fRunner->InitCheck()) {
+		LOG_WARNING("Hotplug", "Can't time the window, reconciling right away.");
+		delete fRunner;
+		fRunner = NULL;
+		fBalances.clear();
+		fOpaque = false;
+		fStats.reconciles++;
+		return true;
+	}
+	return false;
+}
+
+
+/**	\brief		Takes the kMsgHotplugSettled which ends the open window.
+ *	\returns	`true` if the owner should reconcile now, `false` if every
+ *				device ended the window where it started it.
+ */
+bool
+HotplugDebouncer::Settled()
+{
+	if (!fRunner) { return false; }
+	delete fRunner;
+	fRunner = NULL;
+
+	bool changed = fOpaque;
+	for (const Balance& balance : fBalances) {
+		if (balance.present != 0 || balance.running != 0) { changed = true; }
+	}
+	fBalances.clear();
+	fOpaque = false;
+
+	if (!changed) {
+		fStats.cancelled++;
+		LOG_DEBUG("Hotplug", "A burst cancelled itself out, nothing to do.");
+		return false;
+	}
+	fStats.reconciles++;
+	return true;
+}
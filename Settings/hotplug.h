@@ -0,0 +1,108 @@
+/*
+	Copyright 2025, Alexey "Hitech" Burshtein.   All Rights Reserved.
+	This file may be used under the terms of the MIT License.
+*/
+
+/**
+ * @file hotplug.h
+ * @brief Debouncing of the device notifications in front of the hotplug-driven work.
+ * @ingroup SettingsModule
+ *
+ * A flaky USB hub or a Bluetooth mouse can drop off and come back several
+ * times a second. Each time input_server sends a B_INPUT_DEVICES_CHANGED, and
+ * everything that reacts to it (enumerating the devices, redrawing, starting
+ * and stopping them, saving the settings) would run once per notification.
+ *
+ * A HotplugDebouncer sits between the notifications and that work. The first
+ * notification of a burst opens a window of the configured hysteresis; the
+ * ones inside it are only folded into a per-device balance. When the window
+ * ends, the owner is told to reconcile once, or not at all if every device
+ * ended up where it started. So there is at most one reconcile per window,
+ * and a device that flaps for less than the hysteresis is not noticed.
+ */
+
+#ifndef _HOTPLUG_H_
+#define _HOTPLUG_H_
+
+#include <Message.h>
+#include <Messenger.h>
+#include <String.h>
+#include <SupportDefs.h>
+
+#include <vector>
+
+class BMessageRunner;
+
+
+//!	Default hysteresis of the hotplug-driven work, in microseconds.
+const bigtime_t	kDefaultHotplugHysteresis = 300000;
+
+//!	Longest hysteresis accepted, in microseconds. Longer ones would hide real plugs.
+const bigtime_t	kMaxHotplugHysteresis = 10000000;
+
+//!	Sent to the owner of a HotplugDebouncer when its window ends, see HotplugDebouncer::Settled().
+const uint32	kMsgHotplugSettled = 'IThs';
+
+
+/**	\struct		HotplugStats
+ *	\brief		What a HotplugDebouncer did with the notifications it got.
+ */
+struct HotplugStats {
+	uint32		transitions;	//!<	Notifications received
+	uint32		reconciles;		//!<	Times the owner was told to act
+	uint32		coalesced;		//!<	Notifications folded into an already open window
+	uint32		cancelled;		//!<	Windows that ended where they started, without a reconcile
+
+	//!	Notifications which caused no reconcile of their own.
+	uint32 Suppressed() const { return transitions - reconciles; }
+};
+
+
+/**	\class		HotplugDebouncer
+ *	\brief		Coalesces the B_INPUT_DEVICES_CHANGED notifications of a looper.
+ *	\details	The owner passes each notification to Transition() and each
+ *				kMsgHotplugSettled to Settled(), and does its hotplug work
+ *				only when either of them returns `true`.
+ *	\note		Not thread-safe: all the calls must come from the owner's looper.
+ */
+class HotplugDebouncer {
+public:
+	//!	\copydoc	HotplugDebouncer::HotplugDebouncer
+	HotplugDebouncer(const BMessenger& owner = BMessenger(),
+		bigtime_t hysteresis = kDefaultHotplugHysteresis);
+	~HotplugDebouncer();					//!<	\copydoc	HotplugDebouncer::~HotplugDebouncer
+
+	//!	Where kMsgHotplugSettled goes, for the owners which have no messenger yet when constructed.
+	void SetOwner(const BMessenger& owner) { fOwner = owner; }
+	void SetHysteresis(bigtime_t hysteresis);	//!<	\copydoc	HotplugDebouncer::SetHysteresis
+	//!	The length of the window, 0 if the notifications are passed right through.
+	bigtime_t Hysteresis() const { return fHysteresis; }
+
+	bool Transition(const BMessage* notification);	//!<	\copydoc	HotplugDebouncer::Transition
+	bool Settled();							//!<	\copydoc	HotplugDebouncer::Settled
+
+	//!	What was done with the notifications so far.
+	const HotplugStats& Stats() const { return fStats; }
+
+private:
+	HotplugDebouncer(const HotplugDebouncer&);
+	HotplugDebouncer& operator=(const HotplugDebouncer&);
+
+	/**	\struct		Balance
+	 *	\brief		How a device moved during the open window.
+	 */
+	struct Balance {
+		BString		name;		//!<	Name of the device
+		int32		present;	//!<	Additions minus removals
+		int32		running;	//!<	Starts minus stops
+	};
+
+	BMessenger				fOwner;			//!<	Receives kMsgHotplugSettled
+	bigtime_t				fHysteresis;	//!<	Length of the window
+	BMessageRunner*			fRunner;		//!<	Ends the open window, `NULL` if none is open
+	std::vector<Balance>	fBalances;		//!<	The devices seen during the open window
+	bool					fOpaque;		//!<	A notification didn't say what changed
+	HotplugStats			fStats;			//!<	See Stats()
+};
+
+#endif // _HOTPLUG_H_
@@ -0,0 +1,154 @@
+/*
+	Copyright 2025, Alexey "Hitech" Burshtein.   All Rights Reserved.
+	This file may be used under the terms of the MIT License.
+*/
+
+/**
+ * @file log.cpp
+ * @brief Implementation of the logging ring buffer.
+ * @ingroup SettingsModule
+ */
+
+#include "log.h"
+
+#include <stdarg.h>
+#include <string.h>
+#include <strings.h>
+
+#include <atomic>
+
+
+const char* const kLogLevelNames[kLogLevelCount] = {
+	"error", "warning", "info", "debug"
+};
+
+const uint32	kLogRingSize = 256;			//!<	Number of slots, a power of two
+const size_t	kLogTagLength = 24;			//!<	Including the terminating zero
+const size_t	kLogTextLength = 200;		//!<	Including the terminating zero
+
+
+/**	\struct		LogEntry
+ *	\brief		A single slot of the ring.
+ *	\details	`sequence` is 0 while the slot is being written, and the
+ *				ticket of the message plus one when it's complete.
+ */
+struct LogEntry {
+	std::atomic<uint32>	sequence;
+	log_level			level;
+	bigtime_t			when;
+	char				tag[kLogTagLength];
+	char				text[kLogTextLength];
+};
+
+
+static LogEntry					sRing[kLogRingSize];
+static std::atomic<uint32>		sHead(0);			// Next ticket to hand out
+static uint32					sTail = 0;			// Next ticket to flush, flusher only
+static std::atomic_flag			sFlushing = ATOMIC_FLAG_INIT;
+static std::atomic<int32>		sLevel(kLogWarning);
+
+
+/**	\brief		Sets the highest level of the messages that are logged.
+ *	\note		Levels above IGNORE_LOG_MAX_LEVEL stay disabled anyway.
+ */
+void
+SetLogLevel(log_level level)
+{
+	sLevel.store(level, std::memory_order_relaxed);
+}
+
+
+/**	\brief		Returns the highest level of the messages that are logged.
+ */
+log_level
+GetLogLevel()
+{
+	return (log_level)sLevel.load(std::memory_order_relaxed);
+}
+
+
+/**	\brief		Parses the name of a level, see kLogLevelNames.
+ *	\param[in]	name	Name of the level, case-insensitive.
+ *	\param[out]	level	Receives the level. Untouched if the name is unknown.
+ *	\returns	`true` if the name is known.
+ */
+bool
+LogLevelFromString(const char* name, log_level* level)
+{
+	for (int32 i = 0; i < kLogLevelCount; i++) {
+		if (strcasecmp(name, kLogLevelNames[i]) == 0) {
+			*level = (log_level)i;
+			return true;
+		}
+	}
+	return false;
+}
+
+
+/**	\brief		Puts the message into the ring buffer.
+ *	\param[in]	level	Level of the message.
+ *	\param[in]	tag		Where the message comes from, e.g. "Settings Load".
+ *	\param[in]	format	`printf()`-style format of the message.
+ *	\details	Never blocks: a slot is claimed with an atomic increment. The
+ *				message is cut at kLogTextLength.
+ *	\note		Use the LOG_* macros instead, they skip the disabled levels.
+ */
+void
+LogWrite(log_level level, const char* tag, const char* format, ...)
+{
+	uint32 ticket = sHead.fetch_add(1, std::memory_order_relaxed);
+	LogEntry& entry = sRing[ticket & (kLogRingSize - 1)];
+
+	entry.sequence.store(0, std::memory_order_relaxed);
+	std::atomic_thread_fence(std::memory_order_release);
+
+	entry.level = level;
+	entry.when = system_time();
+	strlcpy(entry.tag, tag, sizeof(entry.tag));
+	va_list args;
+	va_start(args, format);
+	vsnprintf(entry.text, sizeof(entry.text), format, args);
+	va_end(args);
+
+	entry.sequence.store(ticket + 1, std::memory_order_release);
+}
+
+
+/**	\brief		Prints the buffered messages.
+ *	\param[in]	stream	Where to print them.
+ *	\returns	Number of the printed messages.
+ *	\details	Only one thread flushes at a time, the others return right
+ *				away. Stops at the first message which is still being written.
+ */
+int32
+LogFlush(FILE* stream)
+{
+	if (sFlushing.test_and_set(std::memory_order_acquire)) { return 0; }
+
+	uint32 head = sHead.load(std::memory_order_acquire);
+	if (head - sTail > kLogRingSize) {
+		fprintf(stream, "[Log] %u messages were lost.\n", (unsigned)(head - sTail - kLogRingSize));
+		sTail = head - kLogRingSize;
+	}
+
+	int32 printed = 0;
+	for (; sTail != head; sTail++) {
+		LogEntry& entry = sRing[sTail & (kLogRingSize - 1)];
+		uint32 sequence = entry.sequence.load(std::memory_order_acquire);
+		if (sequence == 0 || sequence < sTail + 1) { break; }	// Still being written
+		if (sequence != sTail + 1) { continue; }				// Already overwritten
+
+		char tag[kLogTagLength], text[kLogTextLength];
+		memcpy(tag, entry.tag, sizeof(tag));
+		memcpy(text, entry.text, sizeof(text));
+		std::atomic_thread_fence(std::memory_order_acquire);
+		if (entry.sequence.load(std::memory_order_relaxed) != sequence) { continue; }
+
+		tag[sizeof(tag) - 1] = text[sizeof(text) - 1] = '\0';
+		fprintf(stream, "[%s] %s\n", tag, text);
+		printed++;
+	}
+
+	sFlushing.clear(std::memory_order_release);
+	return printed;
+}
@@ -0,0 +1,80 @@
+/*
+	Copyright 2025, Alexey "Hitech" Burshtein.   All Rights Reserved.
+	This file may be used under the terms of the MIT License.
+*/
+
+/**
+ * @file log.h
+ * @brief Leveled logging into an in-memory ring buffer.
+ * @ingroup SettingsModule
+ *
+ * The LOG_* macros check the level against IGNORE_LOG_MAX_LEVEL first, which
+ * is a compile-time constant, so the calls above it vanish from the binary
+ * altogether: release builds have no debug logging at all. The remaining
+ * levels are checked against the runtime level (see SetLogLevel()).
+ *
+ * An enabled message is formatted into a slot of a fixed ring buffer, claimed
+ * with a single atomic increment; nothing is locked and nothing is written
+ * to a file. LogFlush() prints the buffered messages to stderr; it's called
+ * by the CLI after each command and by the add-on's worker thread, never from
+ * the event path. If the ring overflows before it's flushed, the oldest
+ * messages are lost and counted.
+ */
+
+#ifndef _IGNORE_LOG_H_
+#define _IGNORE_LOG_H_
+
+#include "platform.h"
+
+#include <stdio.h>
+
+
+/**	\enum		log_level
+ *	\brief		Severity of a log message, a message is shown if its level is at most the current one.
+ */
+enum log_level {
+	kLogError = 0,		//!<	Something failed
+	kLogWarning,		//!<	Something is off, but it was dealt with
+	kLogInfo,			//!<	Notable events, e.g. a device was unignored
+	kLogDebug,			//!<	Everything, e.g. each device of the loaded settings
+	kLogLevelCount		//!<	Number of levels, not a level itself
+};
+
+//!	Levels above this are compiled out.
+#ifndef IGNORE_LOG_MAX_LEVEL
+#	ifdef DEBUG
+#		define IGNORE_LOG_MAX_LEVEL	kLogDebug
+#	else
+#		define IGNORE_LOG_MAX_LEVEL	kLogInfo
+#	endif
+#endif
+
+//!	Names of the levels, as accepted by LogLevelFromString().
+extern const char* const	kLogLevelNames[kLogLevelCount];
+
+//!	\copydoc	SetLogLevel
+void		SetLogLevel(log_level level);
+//!	\copydoc	GetLogLevel
+log_level	GetLogLevel();
+//!	\copydoc	LogLevelFromString
+bool		LogLevelFromString(const char* name, log_level* level);
+//!	\copydoc	LogWrite
+void		LogWrite(log_level level, const char* tag, const char* format, ...)
+				__attribute__((format(printf, 3, 4)));
+//!	\copydoc	LogFlush
+int32		LogFlush(FILE* stream = stderr);
+
+
+//!	Logs the message if `level` is compiled in and enabled.
+#define IGNORE_LOG(level, tag, ...) \
+	do { \
+		if ((level) <= IGNORE_LOG_MAX_LEVEL && (level) <= GetLogLevel()) \
+			LogWrite((level), (tag), __VA_ARGS__); \
+	} while (0)
+
+#define LOG_ERROR(tag, ...)		IGNORE_LOG(kLogError, tag, __VA_ARGS__)		//!<	See IGNORE_LOG
+#define LOG_WARNING(tag, ...)	IGNORE_LOG(kLogWarning, tag, __VA_ARGS__)	//!<	See IGNORE_LOG
+#define LOG_INFO(tag, ...)		IGNORE_LOG(kLogInfo, tag, __VA_ARGS__)		//!<	See IGNORE_LOG
+#define LOG_DEBUG(tag, ...)		IGNORE_LOG(kLogDebug, tag, __VA_ARGS__)		//!<	See IGNORE_LOG
+
+#endif // _IGNORE_LOG_H_
@@ -0,0 +1,135 @@
+/*
+	Copyright 2025, Alexey "Hitech" Burshtein.   All Rights Reserved.
+	This file may be used under the terms of the MIT License.
+*/
+
+/**
+ * @file platform.h
+ * @brief The few Haiku types and calls the portable parts of the settings use.
+ * @ingroup SettingsModule
+ *
+ * The shared counters, the snapshot, the log and the evdev DeviceControl are
+ * built on Linux too, so that the logic can run and be tested outside of
+ * Haiku. On Haiku this is just `<OS.h>` and `<SupportDefs.h>`; elsewhere the
+ * fixed-size integers, the status codes and the clocks are defined here
+ * with the same names and meanings.
+ */
+
+#ifndef _PLATFORM_H_
+#define _PLATFORM_H_
+
+#ifdef __HAIKU__
+#	include <OS.h>
+#	include <SupportDefs.h>
+#else
+#	include <errno.h>
+#	include <inttypes.h>
+#	include <stddef.h>
+#	include <stdint.h>
+#	include <string.h>
+#	include <time.h>
+#	include <unistd.h>
+
+typedef int8_t		int8;
+typedef uint8_t		uint8;
+typedef int16_t		int16;
+typedef uint16_t	uint16;
+typedef int32_t		int32;
+typedef uint32_t	uint32;
+typedef int64_t		int64;
+typedef uint64_t	uint64;
+typedef int32		status_t;
+typedef int64		bigtime_t;
+typedef int32		thread_id;
+
+//	Negative like on Haiku, so they never collide with the errno values
+enum {
+	B_OK					= 0,
+	B_ERROR					= -1,
+	B_NO_MEMORY				= -0x7fff0000,
+	B_BAD_VALUE,
+	B_NAME_NOT_FOUND,
+	B_NOT_ALLOWED,
+	B_NOT_SUPPORTED,
+	B_MISMATCHED_VALUES,
+	B_NO_INIT,
+	B_TIMED_OUT,
+	B_INTERRUPTED,
+	B_BAD_DATA,
+	B_IO_ERROR,
+	B_ENTRY_NOT_FOUND,
+	B_NAME_TOO_LONG
+};
+
+#	ifndef B_PAGE_SIZE
+#		define B_PAGE_SIZE	4096
+#	endif
+#	define B_PATH_NAME_LENGTH	1024
+#	define B_PRId32			PRId32
+
+//!	Id of the calling thread, like Haiku's `find_thread(NULL)`.
+inline thread_id
+find_thread(const char*)
+{
+	return (thread_id)gettid();
+}
+
+//!	Microseconds since boot, like Haiku's `system_time()`.
+inline bigtime_t
+system_time()
+{
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (bigtime_t)now.tv_sec * 1000000 + now.tv_nsec / 1000;
+}
+
+//!	Microseconds since the epoch, like Haiku's `real_time_clock_usecs()`.
+inline bigtime_t
+real_time_clock_usecs()
+{
+	struct timespec now;
+	clock_gettime(CLOCK_REALTIME, &now);
+	return (bigtime_t)now.tv_sec * 1000000 + now.tv_nsec / 1000;
+}
+
+#	if defined(__GLIBC__) && (__GLIBC__ < 2 || (__GLIBC__ == 2 && __GLIBC_MINOR__ < 38))
+//!	Copies at most `size - 1` characters and always terminates, like the BSD one.
+inline size_t
+strlcpy(char* destination, const char* source, size_t size)
+{
+	size_t length = strlen(source);
+	if (size > 0) {
+		size_t copied = length < size - 1 ? length : size - 1;
+		memcpy(destination, source, copied);
+		destination[copied] = '\0';
+	}
+	return length;
+}
+#	endif
+
+#	ifdef __cplusplus
+#		include <mutex>
+
+//!	Stand-in for Haiku's BLocker: a plain mutex.
+class BLocker {
+public:
+	BLocker(const char* = NULL) {}
+	bool Lock() { fMutex.lock(); return true; }
+	void Unlock() { fMutex.unlock(); }
+private:
+	std::mutex	fMutex;
+};
+
+//!	Stand-in for Haiku's BAutolock: holds the BLocker while it's in scope.
+class BAutolock {
+public:
+	BAutolock(BLocker& locker) : fLocker(locker) { fLocker.Lock(); }
+	BAutolock(BLocker* locker) : fLocker(*locker) { fLocker.Lock(); }
+	~BAutolock() { fLocker.Unlock(); }
+private:
+	BLocker&	fLocker;
+};
+#	endif
+#endif	// !__HAIKU__
+
+#endif // _PLATFORM_H_
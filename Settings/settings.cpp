@@ -13,13 +13,110 @@
  */
 
 #include "settings.h"
+#include "hotplug.h"
+#include "log.h"
+#include "snapshot.h"
 
+#include <Autolock.h>
+#include <Entry.h>
+#include <File.h>
 #include <FindDirectory.h>
-#include <InputDevice.h>
-#include <List.h>
+#include <Looper.h>
 #include <NodeMonitor.h>
+#include <OS.h>
+#include <Path.h>
 
 #include <stdio.h>
+#include <string.h>
+#include <strings.h>
+
+#include <algorithm>
+#include <unordered_set>
+
+
+const char* const kEventClassNames[kEventClassCount] = {
+	"motion", "down", "up", "wheel", "tap"
+};
+
+const char* const kDeviceClassNames[kDeviceClassCount] = {
+	"unknown", "mouse", "touchpad", "tablet"
+};
+
+const char* const kStrategyNames[kStrategyCount] = {
+	"auto", "filter", "stop", "throttle"
+};
+
+
+/**	\struct		ClassHint
+ *	\brief		A word which gives the class of a device away if its name has it.
+ */
+struct ClassHint {
+	const char*		word;
+	device_class	deviceClass;
+};
+
+//!	The words are tried in order, the more specific ones first.
+static const ClassHint kClassHints[] = {
+	{ "touchpad", kDeviceTouchpad },	{ "trackpad", kDeviceTouchpad },
+	{ "synaptics", kDeviceTouchpad },	{ "elantech", kDeviceTouchpad },
+	{ "alps", kDeviceTouchpad },		{ "glidepoint", kDeviceTouchpad },
+	{ "tablet", kDeviceTablet },		{ "wacom", kDeviceTablet },
+	{ "digitizer", kDeviceTablet },		{ "stylus", kDeviceTablet },
+	{ "mouse", kDeviceMouse },			{ "trackball", kDeviceMouse },
+	{ "trackpoint", kDeviceMouse },
+};
+
+
+/**	\brief		Tells what kind of pointing device a device is.
+ *	\param[in]	name	Name of the device.
+ *	\param[in]	traits	device_trait bits the add-on saw the device show, 0 if none.
+ *	\returns	The class, kDeviceUnknown if neither the traits nor the name give it away.
+ *	\details	The traits win over the name: a tap only comes from a touchpad,
+ *				an absolute position only from a tablet. Otherwise the name is
+ *				searched for the words of kClassHints, ignoring the case.
+ */
+device_class ClassifyDevice(const char* name, uint32 traits) {
+	if (traits & kTraitAbsolute)	{ return kDeviceTablet; }
+	if (traits & kTraitTap)			{ return kDeviceTouchpad; }
+
+	BString deviceName(name);
+	for (const ClassHint& hint : kClassHints) {
+		if (deviceName.IFindFirst(hint.word) >= 0) { return hint.deviceClass; }
+	}
+	return kDeviceUnknown;
+}
+
+
+/**	\brief		Parses the name of a device class, see kDeviceClassNames.
+ *	\param[in]	name		Name of the class, case-insensitive.
+ *	\param[out]	deviceClass	Receives the class. Untouched if the name is unknown.
+ *	\returns	`true` if the name is known.
+ */
+bool DeviceClassFromString(const char* name, device_class* deviceClass) {
+	for (int32 i = 0; i < kDeviceClassCount; i++) {
+		if (strcasecmp(name, kDeviceClassNames[i]) == 0) {
+			*deviceClass = (device_class)i;
+			return true;
+		}
+	}
+	return false;
+}
+
+
+/**	\brief		Parses the name of a strategy, see kStrategyNames.
+ *	\param[in]	name		Name of the strategy, case-insensitive.
+ *	\param[out]	strategy	Receives the strategy. Untouched if the name is unknown.
+ *	\returns	`true` if the name is known.
+ */
+bool StrategyFromString(const char* name, suppress_strategy* strategy) {
+	for (int32 i = 0; i < kStrategyCount; i++) {
+		if (strcasecmp(name, kStrategyNames[i]) == 0) {
+			*strategy = (suppress_strategy)i;
+			return true;
+		}
+	}
+	return false;
+}
 
 
 /**	\brief		Constructor of the device information, for easier initialization.
@@ -27,11 +124,21 @@
  *	\param[in]	connected	"true" if the device is connected (default), "false" otherwise.
  *	\param[in]	ignored		"true" if the input from the device is ignored,
  *							"false" otherwise (default).
+ *	\param[in]	ordinal		See DeviceInfo::Ordinal, 0 by default.
  */
-DeviceInfo::DeviceInfo(BString name, bool connected = true, bool ignored = false) {
+DeviceInfo::DeviceInfo(const BString& name, bool connected, bool ignored, uint32 ordinal) {
 	DeviceName = name;
+	Ordinal = ordinal;
+	Fingerprint = DeviceFingerprint(name.String(), ordinal);
 	IsConnected = connected;
+	LastSeen = connected ? real_time_clock_usecs() : 0;
 	IsIgnored = ignored;
+	IgnoredUntil = 0;
+	SuppressMask = 0;
+	ActivityWindow = kDefaultActivityWindow;
+	Class = kDeviceUnknown;
+	ClassSource = kClassNotYet;
+	Strategy = kStrategyAuto;
 }
 
 
@@ -42,11 +149,36 @@ DeviceInfo::DeviceInfo(BString name, bool connected = true, bool ignored = false
  */
 status_t	DeviceInfo::ToBMessage(BMessage* out) const {
 	if (!out)	{ return B_BAD_VALUE; }
-	
+
 	out->what = 'DEVI';
 	out->AddString("name", DeviceName);
+	out->AddUInt64("fingerprint", Fingerprint);
+	if (Ordinal != 0) {
+		out->AddUInt32("ordinal", Ordinal);
+	}
 	out->AddBool("ignored", IsIgnored);
+	if (IsIgnored && IgnoredUntil != 0) {
+		out->AddInt64("ignored_until", IgnoredUntil);
+	}
 	out->AddBool("connected", IsConnected);
+	out->AddInt64("last_seen", LastSeen);
+	if (SuppressMask != 0) {
+		out->AddUInt8("suppress_mask", SuppressMask);
+	}
+	if (SuppressWhileActive.Length() > 0) {
+		out->AddString("suppress_while_active", SuppressWhileActive);
+		out->AddInt64("activity_window", ActivityWindow);
+	}
+	for (const BString& signature : IgnoreWhileFocused) {
+		out->AddString("ignore_while_focused", signature);
+	}
+	if (ClassSource != kClassNotYet) {
+		out->AddUInt8("class", Class);
+		out->AddUInt8("class_source", ClassSource);
+	}
+	if (Strategy != kStrategyAuto) {
+		out->AddUInt8("strategy", Strategy);
+	}
 	return	B_OK;
 }
 
@@ -57,116 +189,466 @@ status_t	DeviceInfo::ToBMessage(BMessage* out) const {
  *				B_BAD_VALUE		If the input pointer is NULL
  *				B_BAD_TYPE		If the input BMessage has incorrect "what" field
  *				B_NAME_NOT_FOUND	If the name of the device is not found in the BMessage
- *	\note		Both boolean values are not required for successful initialization,
+ *	\note		The fingerprint is always recomputed from the name and the ordinal.
+ *				Both boolean values are not required for successful initialization,
  *				the convention is "IsConnected = false" and "IsIgnored = false".
+ *				Same goes for the suppression mask, the activity policy and
+ *				the focus policy, which are off by default, the class,
+ *				which is computed again if it's missing, and the strategy,
+ *				which is kStrategyAuto.
  */
 status_t	DeviceInfo::FromBMessage(const BMessage* in) {
 	if (!in)	return	B_BAD_VALUE;
 	if (in->what != 'DEVI')	return B_BAD_TYPE;
-	
+
 	if (B_OK != in->FindString("name", &DeviceName))	return B_NAME_NOT_FOUND;
+	if (B_OK != in->FindUInt32("ordinal", &Ordinal))	Ordinal = 0;
+	// Older files have no fingerprint, and a stale one is worse than none
+	Fingerprint = DeviceFingerprint(DeviceName.String(), Ordinal);
 	if (B_OK != in->FindBool("ignored", &IsIgnored))		IsIgnored = false;
+	if (B_OK != in->FindInt64("ignored_until", &IgnoredUntil))	IgnoredUntil = 0;
 	if (B_OK != in->FindBool("connected", &IsConnected))	IsConnected = false;
+	if (B_OK != in->FindInt64("last_seen", &LastSeen))		LastSeen = 0;
+	if (B_OK != in->FindUInt8("suppress_mask", &SuppressMask))	SuppressMask = 0;
+	SuppressMask &= kEventAllMask;
+	if (B_OK != in->FindString("suppress_while_active", &SuppressWhileActive))
+		SuppressWhileActive = "";
+	if (B_OK != in->FindInt64("activity_window", &ActivityWindow))
+		ActivityWindow = kDefaultActivityWindow;
+	IgnoreWhileFocused.clear();
+	BString signature;
+	for (int32 i = 0; in->FindString("ignore_while_focused", i, &signature) == B_OK; i++) {
+		IgnoreWhileFocused.push_back(signature);
+	}
+	if (B_OK != in->FindUInt8("class", &Class) || Class >= kDeviceClassCount
+		|| B_OK != in->FindUInt8("class_source", &ClassSource) || ClassSource > kClassByTraits)
+	{
+		Class = kDeviceUnknown;
+		ClassSource = kClassNotYet;
+	}
+	if (B_OK != in->FindUInt8("strategy", &Strategy) || Strategy >= kStrategyCount)
+		Strategy = kStrategyAuto;
 	return B_OK;
 }
 
 
-void DeviceInfo::DebugPrint(void) {
-	fprintf(stdout, "[DeviceInfo] Device: %s, connected: %s, disabled: %s.\n",
-			DeviceName.String(),
+void DeviceInfo::DebugPrint(void) const {
+	LOG_DEBUG("DeviceInfo", "Device: %s (#%u, %016llx), connected: %s, disabled: %s.",
+			DeviceName.String(), (unsigned)Ordinal, (unsigned long long)Fingerprint,
 			IsConnected ? "true" : "false",
 			IsIgnored ? "true" : "false");
+	if (IsIgnored && IgnoredUntil != 0) {
+		LOG_DEBUG("DeviceInfo", "    ignored for %lld more seconds.",
+				(long long)((IgnoredUntil - real_time_clock_usecs()) / 1000000));
+	}
+	if (SuppressMask != 0) {
+		BString classes;
+		for (int32 i = 0; i < kEventClassCount; i++) {
+			if (SuppressMask & (1 << i))	classes << " " << kEventClassNames[i];
+		}
+		LOG_DEBUG("DeviceInfo", "    suppressed events:%s.", classes.String());
+	}
+	if (SuppressWhileActive.Length() > 0) {
+		LOG_DEBUG("DeviceInfo", "    ignored while %s was active in last %lld ms.",
+				SuppressWhileActive.String(), (long long)(ActivityWindow / 1000));
+	}
+	for (const BString& signature : IgnoreWhileFocused) {
+		LOG_DEBUG("DeviceInfo", "    ignored while %s is active.", signature.String());
+	}
+	if (ClassSource != kClassNotYet) {
+		LOG_DEBUG("DeviceInfo", "    class: %s (by %s).", kDeviceClassNames[Class],
+				ClassSource == kClassByTraits ? "events" : "name");
+	}
+	if (Strategy != kStrategyAuto) {
+		LOG_DEBUG("DeviceInfo", "    suppressed by: %s.", kStrategyNames[Strategy]);
+	}
 }
 
 
-/**	\brief		This function was copied directly from the BeBook.
- *	\see		InputServer and InputDevice
- *	\returns	Whatever, no-one bothers to check the return value, even in the example :)
+/**	\brief		Tells how the device is kept quiet while it's ignored.
+ *	\param[in]	now		`real_time_clock_usecs()`, to tell how long the ignore lasts.
+ *	\returns	Strategy, or for kStrategyAuto: kStrategyStop if the device is
+ *				ignored until told otherwise or for longer than kLongTermIgnore,
+ *				kStrategyFilter if only for a while.
+ *	\details	A stopped device isn't read by input_server at all, but
+ *				restarting it takes a while; so only the ignores which are there
+ *				to stay stop it by default. What each strategy saves hasn't been
+ *				measured yet, the default is a guess until `measure` is run on
+ *				real hardware.
  */
-static bool del_InputDevice(void *ptr)
-{
-	if (ptr) {
-		BInputDevice *dev = (BInputDevice *)ptr;
-		delete dev;
-		return false;
+suppress_strategy DeviceInfo::EffectiveStrategy(bigtime_t now) const {
+	if (Strategy != kStrategyAuto) { return (suppress_strategy)Strategy; }
+	if (IgnoredUntil == 0 || IgnoredUntil - now > kLongTermIgnore) { return kStrategyStop; }
+	return kStrategyFilter;
+}
+
+
+status_t SettingsProfile::ToBMessage(BMessage* out) const {
+	if (!out)	{ return B_BAD_VALUE; }
+
+	out->what = 'PROF';
+	out->AddString("name", Name);
+	for (const auto& device : Devices) {
+		BMessage singleDevice('DEVI');
+		device.ToBMessage(&singleDevice);
+		out->AddMessage("device", &singleDevice);
 	}
-	return true;
+	return B_OK;
 }
 
 
+status_t SettingsProfile::FromBMessage(const BMessage* in) {
+	if (!in)	return	B_BAD_VALUE;
+	if (in->what != 'PROF')	return B_BAD_TYPE;
+	if (B_OK != in->FindString("name", &Name))	return B_NAME_NOT_FOUND;
+
+	Devices.clear();
+	BMessage singleDevice;
+	for (int32 i = 0; in->FindMessage("device", i, &singleDevice) == B_OK; i++) {
+		DeviceInfo device;
+		if (B_OK == device.FromBMessage(&singleDevice)) {
+			Devices.push_back(device);
+		}
+	}
+	return B_OK;
+}
+
+
+/**	\class		SettingsWatcher
+ *	\brief		The file watcher of a Settings object which has subscribers.
+ *	\details	Receives the node monitor messages of the settings directory. When
+ *				the settings file is replaced, loads it once, compares it with
+ *				the previous version, and hands the difference to
+ *				Settings::Notify(). Only this looper touches the baseline.
+ */
+class SettingsWatcher : public BLooper {
+public:
+	SettingsWatcher(Settings* owner)
+		:	BLooper("IgnoreTouchpad settings watcher", B_LOW_PRIORITY),
+			fOwner(owner),
+			fBaseline(new Settings())
+	{
+		fBaseline->Load();
+	}
+
+	virtual ~SettingsWatcher() { delete fBaseline; }
+
+	virtual void MessageReceived(BMessage* message) {
+		if (message->what != B_NODE_MONITOR) {
+			BLooper::MessageReceived(message);
+			return;
+		}
+		// Save() renames a temporary file over the settings, other files don't matter
+		const char* name = NULL;
+		if (B_OK != message->FindString("name", &name)
+			|| strcmp(name, fOwner->fFileName) != 0)
+		{
+			return;
+		}
+
+		Settings* current = new Settings();
+		current->Load();
+		BMessage notification(kMsgSettingsChanged);
+		uint32 changes = Settings::Diff(*fBaseline, *current, &notification);
+		delete fBaseline;
+		fBaseline = current;
+		if (changes != 0) { fOwner->Notify(&notification, changes); }
+	}
+
+protected:
+	Settings*	fOwner;			//!<	Whose subscribers are notified
+	Settings*	fBaseline;		//!<	The settings as of the last notification
+};
+
+
 /**	\brief		Constructor.
- *	\param[in]	target		BMessenger to be notified when the settings file is updated.
+ *	\param[in]	target		BMessenger to be notified when the settings file is updated,
+ *							see Settings::AddSubscriber(). May be `NULL`.
  *	\param[in]	startMonitoring		If `true`, the monitoring is started right away.
  *									Requires `target` to be not `NULL`.
  */
-Settings::Settings(BMessenger* target = NULL, bool startMonitoring = false) :
+Settings::Settings(BMessenger* target, bool startMonitoring) :
+		fChordModifiers(kDefaultChordModifiers),
+		fChordKey(kDefaultChordKey),
+		fHotplugHysteresis(kDefaultHotplugHysteresis),
+		fTraceId(0),
+		fTraceStarted(0),
+		fTraceDevice(0),
+		fWatcher(NULL),
+		fMonitoringActive(false),
 		fLock("Monitoring")
 {
 	fDevicesStatus.clear();
 	this->SetNotifyTarget(target);
 	if (target && startMonitoring) {
-		StartMonitoring();	
+		StartMonitoring();
 	}
 }
 
 
 /**	\brief		Destructor
- *	\details	Just clears some memory. Probably unnecessary, but a good practice anyway.
+ *	\details	Stops the monitoring, if it's active.
  */
 Settings::~Settings() {
-	if (fMonitoringActive)	{	StopMonitoring(), SetNotifyTarget(NULL); 	}
+	StopMonitoring();
 	fDevicesStatus.clear();
 }
 
 
-/**	\brief		Updates the target to send notifications to.
- *	\note		If monitoring was active, it is stopped <b><u>and not restarted</u></b>.
+/**	\brief		Replaces all subscribers with a single one, which hears about everything.
+ *	\param[in]	in		The new subscriber, or `NULL` to remove all of them.
+ *	\note		Kept for the callers written before Settings::AddSubscriber().
+ *				Monitoring goes on, if it's active.
  */
 void Settings::SetNotifyTarget(BMessenger* in) {
-	if (fMonitoringActive) {
-		StopMonitoring();
+	BAutolock lock(fLock);
+	fSubscribers.clear();
+	if (in) { fSubscribers.push_back({ *in, kChangeAll }); }
+}
+
+
+/**	\brief		Adds a subscriber, or changes what an existing one hears about.
+ *	\param[in]	target		Who receives the kMsgSettingsChanged messages.
+ *	\param[in]	changes		settings_change bits of interest.
+ *	\returns	B_OK, or B_BAD_VALUE if `target` is not valid.
+ *	\note		Doesn't start the monitoring, see Settings::StartMonitoring().
+ */
+status_t Settings::AddSubscriber(const BMessenger& target, uint32 changes) {
+	if (!target.IsValid()) { return B_BAD_VALUE; }
+	BAutolock lock(fLock);
+	for (auto& subscriber : fSubscribers) {
+		if (subscriber.target == target) {
+			subscriber.changes = changes;
+			return B_OK;
+		}
+	}
+	fSubscribers.push_back({ target, changes });
+	return B_OK;
+}
+
+
+/**	\brief		Removes a subscriber. The monitoring goes on even if it was the last one.
+ */
+void Settings::RemoveSubscriber(const BMessenger& target) {
+	BAutolock lock(fLock);
+	fSubscribers.erase(std::remove_if(fSubscribers.begin(), fSubscribers.end(),
+		[&target](const Subscriber& subscriber) { return subscriber.target == target; }),
+		fSubscribers.end());
+}
+
+
+/**	\brief		Delivers a notification to every subscriber interested in it.
+ *	\param[in]	notification	The message, built once for all of them.
+ *	\param[in]	changes			settings_change bits of the notification.
+ *	\details	The subscribers which are gone are removed.
+ *	\note		Called by the SettingsWatcher.
+ */
+void Settings::Notify(BMessage* notification, uint32 changes) {
+	notification->AddInt32("changes", changes);
+	BAutolock lock(fLock);
+	for (size_t i = 0; i < fSubscribers.size(); ) {
+		if ((fSubscribers[i].changes & changes) == 0) { i++; continue; }
+		status_t status = fSubscribers[i].target.SendMessage(notification, (BHandler*)NULL, 0);
+		if (B_BAD_PORT_ID == status) {
+			fSubscribers.erase(fSubscribers.begin() + i);
+			continue;
+		}
+		i++;
+	}
+}
+
+
+/**	\brief		`true` if both devices have the same policies.
+ */
+static bool SamePolicy(const DeviceInfo& a, const DeviceInfo& b) {
+	return a.SuppressMask == b.SuppressMask && a.SuppressWhileActive == b.SuppressWhileActive
+		&& a.ActivityWindow == b.ActivityWindow && a.IgnoreWhileFocused == b.IgnoreWhileFocused
+		&& a.Strategy == b.Strategy;
+}
+
+
+/**	\brief		Compares two versions of the settings.
+ *	\param[in]	before			The older version.
+ *	\param[in]	after			The newer version.
+ *	\param[out]	notification	Receives what Settings::ApplyChanges() needs to
+ *								turn `before` into `after`: the changed devices
+ *								as "device", the fingerprints of the forgotten ones
+ *								as "removed", and the profiles, the chord and
+ *								the hotplug hysteresis if they changed.
+ *	\returns	settings_change bits, 0 if nothing changed.
+ *	\details	Both device tables are sorted by fingerprint, so they are merged
+ *				in a single pass.
+ */
+uint32 Settings::Diff(const Settings& before, const Settings& after, BMessage* notification) {
+	uint32 changes = 0;
+	auto old = before.fDevicesStatus.begin();
+	auto current = after.fDevicesStatus.begin();
+	while (old != before.fDevicesStatus.end() || current != after.fDevicesStatus.end()) {
+		if (current == after.fDevicesStatus.end()
+			|| (old != before.fDevicesStatus.end() && old->Fingerprint < current->Fingerprint))
+		{
+			changes |= kChangeHistory;
+			if (old->IsIgnored)		changes |= kChangeStatus;
+			if (old->HasPolicy())	changes |= kChangePolicy;
+			notification->AddUInt64("removed", old->Fingerprint);
+			++old;
+			continue;
+		}
+		uint32 deviceChanges = 0;
+		if (old == before.fDevicesStatus.end() || current->Fingerprint < old->Fingerprint) {
+			deviceChanges = kChangeHistory;
+			if (current->IsIgnored)		deviceChanges |= kChangeStatus;
+			if (current->HasPolicy())	deviceChanges |= kChangePolicy;
+		} else {
+			if (old->IsIgnored != current->IsIgnored || old->IgnoredUntil != current->IgnoredUntil)
+				deviceChanges |= kChangeStatus;
+			if (!SamePolicy(*old, *current))
+				deviceChanges |= kChangePolicy;
+			if (old->IsConnected != current->IsConnected || old->LastSeen != current->LastSeen)
+				deviceChanges |= kChangeHistory;
+			++old;
+		}
+		if (deviceChanges != 0) {
+			BMessage device('DEVI');
+			current->ToBMessage(&device);
+			notification->AddMessage("device", &device);
+			changes |= deviceChanges;
+		}
+		++current;
+	}
+
+	bool sameProfiles = before.fActiveProfile == after.fActiveProfile
+		&& before.fProfiles.size() == after.fProfiles.size();
+	for (size_t i = 0; sameProfiles && i < after.fProfiles.size(); i++) {
+		const SettingsProfile& a = before.fProfiles[i];
+		const SettingsProfile& b = after.fProfiles[i];
+		sameProfiles = a.Name == b.Name && a.Devices.size() == b.Devices.size();
+		for (size_t j = 0; sameProfiles && j < b.Devices.size(); j++) {
+			sameProfiles = a.Devices[j].Fingerprint == b.Devices[j].Fingerprint
+				&& a.Devices[j].IsIgnored == b.Devices[j].IsIgnored
+				&& SamePolicy(a.Devices[j], b.Devices[j]);
+		}
+	}
+	if (!sameProfiles) {
+		changes |= kChangeProfiles;
+		notification->AddBool("profiles", true);
+		for (const auto& profile : after.fProfiles) {
+			BMessage singleProfile('PROF');
+			profile.ToBMessage(&singleProfile);
+			notification->AddMessage("profile", &singleProfile);
+		}
+		notification->AddString("active_profile", after.fActiveProfile);
+	}
+
+	if (before.fChordModifiers != after.fChordModifiers || before.fChordKey != after.fChordKey) {
+		changes |= kChangeChord;
+		notification->AddUInt32("chord_modifiers", after.fChordModifiers);
+		notification->AddUInt32("chord_key", after.fChordKey);
+	}
+	if (before.fHotplugHysteresis != after.fHotplugHysteresis) {
+		changes |= kChangeHotplug;
+		notification->AddInt64("hotplug_hysteresis", after.fHotplugHysteresis);
+	}
+	return changes;
+}
+
+
+/**	\brief		Brings the in-memory copy up to date from a notification.
+ *	\param[in]	notification	A kMsgSettingsChanged message.
+ *	\returns	B_OK, or B_BAD_VALUE if it's not a notification.
+ *	\details	Cheaper than Settings::Load(): only what changed is touched, and
+ *				the file is not read again.
+ *	\note		Only correct if this copy was up to date before the change, e.g.
+ *				loaded before the monitoring was started.
+ */
+status_t Settings::ApplyChanges(const BMessage* notification) {
+	if (!notification || notification->what != kMsgSettingsChanged) { return B_BAD_VALUE; }
+	BAutolock lock(fLock);
+
+	uint64 removed;
+	for (int32 i = 0; notification->FindUInt64("removed", i, &removed) == B_OK; i++) {
+		DeviceInfo* device = FindDevice(removed);
+		if (device) { fDevicesStatus.erase(fDevicesStatus.begin() + (device - fDevicesStatus.data())); }
+	}
+	BMessage deviceMessage;
+	for (int32 i = 0; notification->FindMessage("device", i, &deviceMessage) == B_OK; i++) {
+		DeviceInfo changed;
+		if (B_OK != changed.FromBMessage(&deviceMessage)) { continue; }
+		FindOrAddDevice(changed.DeviceName, changed.Ordinal) = changed;
+	}
+
+	bool profiles = false;
+	if (notification->FindBool("profiles", &profiles) == B_OK && profiles) {
+		fProfiles.clear();
+		BMessage profileMessage;
+		for (int32 i = 0; notification->FindMessage("profile", i, &profileMessage) == B_OK; i++) {
+			SettingsProfile profile;
+			if (B_OK == profile.FromBMessage(&profileMessage)) { fProfiles.push_back(profile); }
+		}
+		RebuildProfileIndex();
+		notification->FindString("active_profile", &fActiveProfile);
 	}
-	fTarget = in;
+
+	uint32 value;
+	if (notification->FindUInt32("chord_modifiers", &value) == B_OK)	fChordModifiers = value;
+	if (notification->FindUInt32("chord_key", &value) == B_OK)			fChordKey = value;
+	notification->FindInt64("hotplug_hysteresis", &fHotplugHysteresis);
+	return B_OK;
 }
 
 
 /**	\brief		Starts monitoring the settings file for changes.
- *	\details	When the settings file is updated, the target BMessenger
- *				receives a message from Storage Kit.
+ *	\details	Settings::Save() replaces the file instead of rewriting it, so the
+ *				whole settings directory is watched, by a single SettingsWatcher
+ *				for all of the subscribers. When the settings file is updated,
+ *				they receive a kMsgSettingsChanged message, see
+ *				Settings::AddSubscriber().
  *	\see		watch_node()
  *	\returns	B_OK 			If monitoring is already active or if it was started successfully.
- *				B_BAD_HANDLER	If the target BMessenger is `NULL`.
+ *				B_BAD_HANDLER	If there are no subscribers.
  *				B_BAD_VALUE		If Settings::GetPathToSettingsFile() returned NULL.
  *				B_ENTRY_NOT_FOUND	If the settings file couldn't be created for some reason.
  *				Some other error	If could not get node ref inside critical section
  *									or if monitoring could not be started.
  */
 status_t Settings::StartMonitoring() {
-	if (! fTarget) { return B_BAD_HANDLER; }
 	if (fMonitoringActive) { return B_OK; }
-	
+
 	BPath* pathToSettingsFile = GetPathToSettingsFile();
 	if (! pathToSettingsFile) { return B_BAD_VALUE; }
-	
-	// ---==< Entering critical section >==--- 
+
+	// ---==< Entering critical section >==---
 	fLock.Lock();
-	
+	if (fSubscribers.empty()) {
+		fLock.Unlock();
+		delete pathToSettingsFile;
+		return B_BAD_HANDLER;
+	}
+
 	// Find the settings file
-	BEntry entry(pathToSettingsFile.Path(), true);
+	BEntry entry(pathToSettingsFile->Path(), true);
 	if (!entry.Exists()) {
-		// There's no settings file
-		if ( B_OK != CreateSettingsFile()) {
+		// There's no settings file, write an empty one. All devices are enabled.
+		Save();
+		entry = BEntry(pathToSettingsFile->Path(), true);
+		if (!entry.Exists()) {
 			fLock.Unlock();
+			delete pathToSettingsFile;
 			return B_ENTRY_NOT_FOUND;
 		}
 	}
-	
-	// Get the node reference
-	status_t status = entry.GetNodeRef(&fNodeRef);
+	delete pathToSettingsFile;
+
+	// Get the node reference of the directory
+	BEntry directory;
+	status_t status = entry.GetParent(&directory);
+	if (B_OK == status) { status = directory.GetNodeRef(&fNodeRef); }
     if (B_OK != status) { fLock.Unlock(); return status; }
 
     // Start monitoring
-	status = watch_node(&fNodeRef, B_WATCH_STAT, target);
+	fWatcher = new SettingsWatcher(this);
+	fWatcher->Run();
+	status = watch_node(&fNodeRef, B_WATCH_DIRECTORY, BMessenger(fWatcher));
 	if (status == B_OK) {
 		fMonitoringActive = true;
     }
@@ -174,6 +656,11 @@ status_t Settings::StartMonitoring() {
 	fLock.Unlock();
 	// ---==< Exitting critical section >==---
 
+	if (status != B_OK) {
+		fWatcher->Lock();
+		fWatcher->Quit();
+		fWatcher = NULL;
+	}
     return status;
 }
 
@@ -181,12 +668,15 @@ status_t Settings::StartMonitoring() {
 /**	\brief		Stop watching the settings file for changes
  *	\note		This function does not check the return value of `watch_node()`,
  *				because, well, why bother?
+ *	\note		Must not be called with fLock held: the watcher may be waiting
+ *				for it in Settings::Notify().
  */
 void Settings::StopMonitoring() {
-	if (fTarget && fMonitoringActive) {
-		watch_node(&fNodeRef, B_STOP_WATCHING, fTarget);
-		fMonitoringActive = false;
-	}
+	if (!fMonitoringActive) { return; }
+	watch_node(&fNodeRef, B_STOP_WATCHING, BMessenger(fWatcher));
+	fMonitoringActive = false;
+	if (fWatcher->Lock()) { fWatcher->Quit(); }
+	fWatcher = NULL;
 }
 
 
@@ -195,44 +685,15 @@ void Settings::StopMonitoring() {
  *	\note		The caller is responsible for freeing the returned object!
  *	\note		Nothing guarantees that the file exists. Check first!
  */
-BPath*	Settings::GetPathToSettingsFile() {
+BPath*	Settings::GetPathToSettingsFile() const {
 	BPath* pathToSettingsFile = new BPath();
-	status_t status = find_directory(B_USER_SETTINGS_DIRECTORY, pathToSettingsFile)) {
-	if (B_OK != status) { return NULL; }
-	pathToSettingsFile.Append(fFileName);
+	status_t status = find_directory(B_USER_SETTINGS_DIRECTORY, pathToSettingsFile);
+	if (B_OK != status) { delete pathToSettingsFile; return NULL; }
+	pathToSettingsFile->Append(fFileName);
 	return pathToSettingsFile;
 }
 
 
-status_t	Settings::CreateSettingsFile() {
-	BInputDevice* device = NULL;
-	BMessage toSave = new BMessage('CONF');
-	
-	
-	// Obtain the list of all devices
-	BList devices;
-	status = get_input_devices(&devices);
-	if (B_OK != status) { file.Unlock(); return status; }
-	
-	device = devices.ItemAt(i);
-		if (!device ||
-			device->Type() != B_POINTING_DEVICE)
-		{ i++; continue; }
-	
-	// Insert them into the unordered map
-	
-	
-	// Dispose of the device list.
-	list_o_devices.DoForEach (del_InputDevice);
-	list_o_devices.MakeEmpty();
-
-	
-	
-	printf("[SettingsMonitor] Created new settings file: %s\n", fPath.Path());
-	return B_OK;
-}
-
-
 /**	\brief		Load current settings from the settings file
  *	\note		Settings include only names of the devices and boolean flags for
  *				them to be ignored or allowed.
@@ -245,100 +706,685 @@ status_t	Settings::CreateSettingsFile() {
  *				  - If its name was stored in the settings, its "ignored" value will
  *					also be read, otherwise it will be "false".
  *				  - If it is not connected, but appears in the settings file, things
- *					are getting interesting. Current behavior is TBD. :) 
+ *					are getting interesting. Current behavior is TBD. :)
  */
 void Settings::Load() {
+	BAutolock lock(fLock);
 	BMessage readFrom;
+	if (B_OK != ReadFile(&readFrom)) { return; }
+	Load(&readFrom);
+}
+
+
+/**	\brief		Reads the settings file into a message, without touching the settings.
+ *	\param[out]	readFrom	Receives the stored message.
+ *	\returns	B_OK if the file was read, an error code otherwise.
+ *	\details	This is the slow part of Settings::Load(), the one which waits for
+ *				the disk. It doesn't take fLock, so it may run on another thread
+ *				while the caller does something else, see BackgroundTask; the
+ *				message is then passed to Settings::Load(const BMessage*).
+ */
+status_t Settings::ReadFile(BMessage* readFrom) const {
 	BFile settingsFile;
-	
+
 	// Get the path
 	BPath* pathToSettingsFile = this->GetPathToSettingsFile();
 	if (! pathToSettingsFile) {
-		fprintf(stderr, "[Settings Load] Could not build path to settings file.\n");
-		return;
+		LOG_ERROR("Settings Load", "Could not build path to settings file.");
+		return B_BAD_VALUE;
 	}
-	
+
 	// Set settings file to that path
-	settingsFile.SetTo(pathToSettingsFile->Path());
+	settingsFile.SetTo(pathToSettingsFile->Path(), B_READ_ONLY);
 	if (settingsFile.InitCheck() != B_OK) {
-		fprintf(stderr, "[Settings Load] Initialization of BFile failed.\n");
+		LOG_WARNING("Settings Load", "Initialization of BFile failed.");
 		delete pathToSettingsFile;
-		return;
-	}	
+		return settingsFile.InitCheck();
+	}
 	delete pathToSettingsFile;
-	
+
 	// Unflatten the file into BMessage (under lock)
-	settingsFile.Lock();	
-	readFrom.Unflatten(&settingsFile);
+	settingsFile.Lock();
+	status_t status = readFrom->Unflatten(&settingsFile);
 	settingsFile.Unlock();
-	
+	return status;
+}
+
+
+/**	\brief		Loads the settings from a message read by Settings::ReadFile().
+ *	\param[in]	readFrom	The stored message.
+ */
+void Settings::Load(const BMessage* readFrom) {
+	BAutolock lock(fLock);
+
 	// Sanity check
-	if (readFrom.what() != 'CONF') {
-		fprintf(stderr,
-			"[Settings Load] The BMessage stored in the settings file has wrong 'what'.\n");
+	if (readFrom->what != 'CONF') {
+		LOG_ERROR("Settings Load",
+			"The BMessage stored in the settings file has wrong 'what'.");
 		return;
 	}
-	
-	// Populate the devices map
+
+	// Populate the devices map, replacing whatever was loaded before
+	fDevicesStatus.clear();
 	int32 i = 0;
 	BMessage individualDeviceMessage;
-	
-	while (readFrom.FindMessage("device", i++, &individualDeviceMessage) == B_OK) {
+
+	while (readFrom->FindMessage("device", i, &individualDeviceMessage) == B_OK) {
 		DeviceInfo individualDevice;
-		individualDevice.FromBMessage(&individualDeviceMessage);		
+		individualDevice.FromBMessage(&individualDeviceMessage);
 		fDevicesStatus.push_back(individualDevice);
 		individualDevice.DebugPrint();
+		i++;
 	}
-	fprintf(stdout, "[Settings Load] %d devices loaded from settings, "
-			"size of vector is %d", i, fDevicesStatus.size());
+	// Older files are in the order the devices were added
+	std::sort(fDevicesStatus.begin(), fDevicesStatus.end(),
+		[](const DeviceInfo& a, const DeviceInfo& b) { return a.Fingerprint < b.Fingerprint; });
+	fProfiles.clear();
+	BMessage profileMessage;
+	for (int32 j = 0; readFrom->FindMessage("profile", j, &profileMessage) == B_OK; j++) {
+		SettingsProfile profile;
+		if (B_OK == profile.FromBMessage(&profileMessage)) {
+			fProfiles.push_back(profile);
+		}
+	}
+	RebuildProfileIndex();
+	if (B_OK != readFrom->FindString("active_profile", &fActiveProfile))
+		fActiveProfile = "";
+	if (B_OK != readFrom->FindUInt32("chord_modifiers", &fChordModifiers))
+		fChordModifiers = kDefaultChordModifiers;
+	if (B_OK != readFrom->FindUInt32("chord_key", &fChordKey))
+		fChordKey = kDefaultChordKey;
+	if (B_OK != readFrom->FindInt64("hotplug_hysteresis", &fHotplugHysteresis))
+		fHotplugHysteresis = kDefaultHotplugHysteresis;
+	SetHotplugHysteresis(fHotplugHysteresis);	// The file may have been edited by hand
+	LOG_DEBUG("Settings Load", "%d devices loaded from settings, size of vector is %zu",
+			(int)i, fDevicesStatus.size());
 }
 
 
 
 /**	\brief		Save current settings into the settings file
+ *	\details	Besides the flattened BMessage, a compact snapshot of the ignored
+ *				devices is written next to it. The input_server add-on reads
+ *				only the snapshot at boot, see \ref snapshot.h.
+ *	\details	Only up to kMaxDeviceHistory devices are written, see
+ *				Settings::CompactedDevices().
+ *	\details	The settings are written into a temporary file, private to the
+ *				calling thread, which is then renamed over the old one. The CLI,
+ *				the GUI and the add-on may save at the same time; none of them
+ *				ever loads a half-written or an empty file.
  */
-void Settings::Save() {
+void Settings::Save() const {
+	BAutolock lock(fLock);
+
 	// Get path to settings file
 	BPath* pathToSettingsFile = GetPathToSettingsFile();
-	if (! pathToSettingsFile) { 
-		fprintf(stderr, "[Settings Create settings file] Could not get path to settings file\n");
+	if (! pathToSettingsFile) {
+		LOG_ERROR("Settings Save", "Could not get path to settings file");
 		return;
 	}
+	BString tempPath(pathToSettingsFile->Path());
+	tempPath << "~" << (int32)find_thread(NULL);
 
-	// Initialize the settings file
-	BFile file(fPath.Path(), B_WRITE_ONLY | B_CREATE_FILE);
+	// Initialize the temporary file
+	BFile file(tempPath.String(), B_WRITE_ONLY | B_CREATE_FILE | B_ERASE_FILE);
 	status_t status = file.InitCheck();
-	if (status != B_OK) { 
-		fprintf (stderr, "[Settings Save] Couldn't initialize settings file\n");
+	if (status != B_OK) {
+		LOG_ERROR("Settings Save", "Couldn't initialize settings file");
 		delete pathToSettingsFile;
 		return;
 	}
 	file.Lock();		// <==== LOCK THE FILE FROM ALL OTHER ACCESSES!
-	
+
 	// Populate the BMessage toSave with pointing devices
-	BMessage* toSave = new BMessage('CONF');
-	int32 listSize = fDevicesStatus.CountItems();
-	int32 i = 0;
-	for (const auto& individualDevice : fDevicesStatus) {		
+	BMessage toSave('CONF');
+	for (const DeviceInfo* individualDevice : CompactedDevices()) {
 		BMessage singleDevice('DEVI');
-		individualDevice.ToBMessage(&singleDevice);
-		toSave->AddMessage("device", &singleDevice);
+		individualDevice->ToBMessage(&singleDevice);
+		toSave.AddMessage("device", &singleDevice);
+	}
+	for (const auto& profile : fProfiles) {
+		BMessage singleProfile('PROF');
+		profile.ToBMessage(&singleProfile);
+		toSave.AddMessage("profile", &singleProfile);
+	}
+	if (fActiveProfile.Length() > 0) {
+		toSave.AddString("active_profile", fActiveProfile);
 	}
-	
+	toSave.AddUInt32("chord_modifiers", fChordModifiers);
+	toSave.AddUInt32("chord_key", fChordKey);
+	toSave.AddInt64("hotplug_hysteresis", fHotplugHysteresis);
+
 	// Save the BMessage with settings
 	status = toSave.Flatten(&file);
+	if (B_OK == status) { status = file.Sync(); }
 	file.Unlock();		// <==== UNLOCK THE FILE, enable access
-	
+	file.Unset();
+
+	// Replace the old settings
+	BEntry tempEntry(tempPath.String());
+	if (B_OK == status) { status = tempEntry.Rename(pathToSettingsFile->Path(), true); }
+	if (B_OK != status) {
+		LOG_ERROR("Settings Save", "Couldn't write the settings file: %s",
+			strerror(status));
+		tempEntry.Remove();
+	}
 	delete pathToSettingsFile;
+
+	// Publish the fast startup copy for the add-on
+	IgnoreSnapshot snapshot;
+	BuildSnapshot(&snapshot);
+	if (B_OK != WriteSnapshot(&snapshot)) {
+		LOG_ERROR("Settings Save", "Couldn't write the startup snapshot");
+	}
+}
+
+
+/**	\brief		Looks for the device in the list.
+ *	\param[in]	fingerprint		DeviceFingerprint() of the device.
+ *	\returns	The device, or `NULL` if it's unknown.
+ */
+DeviceInfo* Settings::FindDevice(device_fingerprint fingerprint) {
+	return const_cast<DeviceInfo*>(static_cast<const Settings*>(this)->FindDevice(fingerprint));
+}
+
+
+const DeviceInfo* Settings::FindDevice(device_fingerprint fingerprint) const {
+	auto found = std::lower_bound(fDevicesStatus.begin(), fDevicesStatus.end(), fingerprint,
+		[](const DeviceInfo& device, device_fingerprint value) { return device.Fingerprint < value; });
+	if (found == fDevicesStatus.end() || found->Fingerprint != fingerprint) { return NULL; }
+	return &*found;
+}
+
+
+/**	\brief		Looks for the device in the list, adding it if it's unknown.
+ *	\param[in]	deviceName	Name of the device.
+ *	\param[in]	ordinal		See DeviceInfo::Ordinal.
+ *	\returns	The device. The reference is valid until the next device is added.
+ */
+DeviceInfo& Settings::FindOrAddDevice(const BString& deviceName, uint32 ordinal) {
+	device_fingerprint fingerprint = DeviceFingerprint(deviceName.String(), ordinal);
+	auto found = std::lower_bound(fDevicesStatus.begin(), fDevicesStatus.end(), fingerprint,
+		[](const DeviceInfo& device, device_fingerprint value) { return device.Fingerprint < value; });
+	if (found != fDevicesStatus.end() && found->Fingerprint == fingerprint) { return *found; }
+	return *fDevicesStatus.insert(found, DeviceInfo(deviceName, true, false, ordinal));
+}
+
+
+/**	\brief		Returns whether the input from the device is ignored.
+ *	\param[in]	deviceName	Name of the device to look for.
+ *	\param[in]	ordinal		See DeviceInfo::Ordinal.
+ *	\returns	`true` if the device is known and ignored, `false` otherwise.
+ */
+bool Settings::GetStatus(BString deviceName, uint32 ordinal) {
+	const DeviceInfo* device = FindDevice(DeviceFingerprint(deviceName.String(), ordinal));
+	return device ? device->IsIgnored : false;
+}
+
+
+/**	\brief		Sets the "ignored" flag of the device, adding it if it's unknown.
+ *	\param[in]	deviceName	Name of the device.
+ *	\param[in]	ignored		`true` if the input from the device should be ignored.
+ *	\param[in]	ordinal		See DeviceInfo::Ordinal.
+ *	\note		Any time limit of the device is removed.
+ *	\note		Only the in-memory copy is updated, call Settings::Save() to persist it.
+ */
+void Settings::SetStatus(BString deviceName, bool ignored, uint32 ordinal) {
+	DeviceInfo& device = FindOrAddDevice(deviceName, ordinal);
+	device.IsIgnored = ignored;
+	device.IgnoredUntil = 0;
+}
+
+
+/**	\brief		Ignores the device until the given time, adding it if it's unknown.
+ *	\param[in]	deviceName	Name of the device.
+ *	\param[in]	until		`real_time_clock_usecs()` when the device is unignored by
+ *							the add-on. 0 ignores it without a time limit.
+ *	\param[in]	ordinal		See DeviceInfo::Ordinal.
+ *	\note		The real time clock is used, so the limit holds across reboots.
+ *	\note		Only the in-memory copy is updated, call Settings::Save() to persist it.
+ */
+void Settings::SetIgnoredUntil(BString deviceName, bigtime_t until, uint32 ordinal) {
+	DeviceInfo& device = FindOrAddDevice(deviceName, ordinal);
+	device.IsIgnored = true;
+	device.IgnoredUntil = until;
+}
+
+
+/**	\brief		Sets the classes of events that are dropped even if the device isn't ignored.
+ *	\param[in]	deviceName	Name of the device.
+ *	\param[in]	mask		Bit `1 << class` for each event_class to drop. 0 drops nothing.
+ *	\param[in]	ordinal		See DeviceInfo::Ordinal.
+ *	\note		Only the in-memory copy is updated, call Settings::Save() to persist it.
+ */
+void Settings::SetSuppressMask(BString deviceName, uint8 mask, uint32 ordinal) {
+	FindOrAddDevice(deviceName, ordinal).SuppressMask = mask & kEventAllMask;
+}
+
+
+/**	\brief		Returns the suppression mask of the device, 0 if the device is unknown.
+ *	\see		Settings::SetSuppressMask
+ */
+uint8 Settings::GetSuppressMask(BString deviceName, uint32 ordinal) const {
+	const DeviceInfo* device = FindDevice(DeviceFingerprint(deviceName.String(), ordinal));
+	return device ? device->SuppressMask : 0;
 }
 
 
-std::vector<DeviceInfo> Settings::GetCurrentlyAttachedDevices() {
-	std::vector<DeviceInfo> toReturn;
+/**	\brief		Chooses how the device is kept quiet while it's ignored.
+ *	\param[in]	deviceName	Name of the device.
+ *	\param[in]	strategy	The suppress_strategy, kStrategyAuto to let DeviceInfo::EffectiveStrategy() choose.
+ *	\param[in]	ordinal		See DeviceInfo::Ordinal.
+ *	\note		Only the in-memory copy is updated, call Settings::Save() to persist it.
+ *				The device isn't stopped or started here, see the CLI.
+ */
+void Settings::SetStrategy(BString deviceName, suppress_strategy strategy, uint32 ordinal) {
+	FindOrAddDevice(deviceName, ordinal).Strategy = strategy < kStrategyCount ? strategy : kStrategyAuto;
+}
+
+
+/**	\brief		Returns the strategy chosen for the device, kStrategyAuto if the device is unknown.
+ *	\see		Settings::SetStrategy
+ */
+suppress_strategy Settings::GetStrategy(BString deviceName, uint32 ordinal) const {
+	const DeviceInfo* device = FindDevice(DeviceFingerprint(deviceName.String(), ordinal));
+	return device ? (suppress_strategy)device->Strategy : kStrategyAuto;
+}
+
+
+/**	\brief		Returns how the device is kept quiet while it's ignored, as of now.
+ *	\returns	kStrategyFilter if the device isn't ignored, which means that
+ *				it keeps running. See DeviceInfo::EffectiveStrategy().
+ */
+suppress_strategy Settings::GetEffectiveStrategy(BString deviceName, uint32 ordinal) const {
+	const DeviceInfo* device = FindDevice(DeviceFingerprint(deviceName.String(), ordinal));
+	if (!device || !device->IsIgnored) { return kStrategyFilter; }
+	return device->EffectiveStrategy(real_time_clock_usecs());
+}
+
+
+/**	\brief		Makes the input of the device ignored while another device is in use.
+ *	\param[in]	deviceName	Name of the device to suppress, e.g. the touchpad.
+ *	\param[in]	trigger		Name of the device whose activity suppresses it, e.g.
+ *							the external mouse. Empty string removes the policy.
+ *	\param[in]	window		How long after its last event the trigger counts as
+ *							active, in microseconds.
+ *	\param[in]	ordinal		See DeviceInfo::Ordinal.
+ *	\note		Only the in-memory copy is updated, call Settings::Save() to persist it.
+ */
+void Settings::SetSuppressWhileActive(BString deviceName, BString trigger,
+		bigtime_t window, uint32 ordinal) {
+	DeviceInfo& device = FindOrAddDevice(deviceName, ordinal);
+	device.SuppressWhileActive = trigger;
+	device.ActivityWindow = window;
+}
+
+
+/**	\brief		Makes the add-on ignore the device while one of the applications is active.
+ *	\param[in]	deviceName	Name of the device to suppress, e.g. the touchpad.
+ *	\param[in]	signatures	Signatures of the applications, e.g. the editors and
+ *							the terminals. An empty list removes the policy.
+ *	\param[in]	ordinal		See DeviceInfo::Ordinal.
+ *	\details	The add-on never looks the active application up for an event:
+ *				it tracks the activations on their own, see FocusTracker.
+ *	\note		Only the in-memory copy is updated, call Settings::Save() to persist it.
+ */
+void Settings::SetIgnoreWhileFocused(BString deviceName, const std::vector<BString>& signatures,
+		uint32 ordinal) {
+	DeviceInfo& device = FindOrAddDevice(deviceName, ordinal);
+	device.IgnoreWhileFocused = signatures;
+}
+
+
+/**	\brief		Returns the class of the device, classifying it if it wasn't yet.
+ *	\param[in]	deviceName	Name of the device.
+ *	\param[in]	ordinal		See DeviceInfo::Ordinal.
+ *	\param[in]	traits		device_trait bits the add-on saw the device show, 0 if unknown.
+ *	\param[out]	changed		If not `NULL`, set to `true` when the cached class
+ *							changed and the settings should be saved. Never
+ *							set to `false`, so it can collect several calls.
+ *	\returns	The class of the device.
+ *	\details	ClassifyDevice() runs once per device: its result is kept in
+ *				the DeviceInfo, and saved with it. A class guessed from the
+ *				name is only revisited when the traits say more than the name
+ *				did; a class seen in the events is final.
+ *	\note		Only the in-memory copy is updated, call Settings::Save() to persist it.
+ */
+device_class Settings::Classify(BString deviceName, uint32 ordinal, uint32 traits, bool* changed) {
+	DeviceInfo& device = FindOrAddDevice(deviceName, ordinal);
+	if (device.ClassSource == kClassByTraits
+		|| (device.ClassSource == kClassByName && traits == 0))
+	{
+		return (device_class)device.Class;
+	}
+
+	device_class found = ClassifyDevice(deviceName.String(), traits);
+	uint8 source = (traits & (kTraitTap | kTraitAbsolute)) ? kClassByTraits : kClassByName;
+	if (found != device.Class || source != device.ClassSource) {
+		device.Class = found;
+		device.ClassSource = source;
+		if (changed) { *changed = true; }
+	}
+	return found;
+}
+
+
+/**	\brief		Marks all known devices as not ignored.
+ *	\note		Only the in-memory copy is updated, call Settings::Save() to persist it.
+ */
+void Settings::ClearAllIgnored() {
+	for (auto& device : fDevicesStatus) {
+		device.IsIgnored = false;
+		device.IgnoredUntil = 0;
+	}
+}
+
+
+/**	\brief		Updates which devices are connected now.
+ *	\param[in]	names	Names of the connected devices, in the order of
+ *						`get_input_devices()`. Identical names get increasing
+ *						ordinals, see DeviceInfo::Ordinal.
+ *	\details	The connected devices are added if they are unknown, and their
+ *				DeviceInfo::LastSeen is set to now; all others are marked as
+ *				disconnected.
+ *	\note		Only the in-memory copy is updated, call Settings::Save() to persist it.
+ */
+void Settings::MarkConnected(const std::vector<BString>& names) {
+	for (auto& device : fDevicesStatus) {
+		device.IsConnected = false;
+	}
+
+	bigtime_t now = real_time_clock_usecs();
+	for (size_t i = 0; i < names.size(); i++) {
+		uint32 ordinal = 0;
+		for (size_t j = 0; j < i; j++) {
+			if (names[j] == names[i]) { ordinal++; }
+		}
+		DeviceInfo& device = FindOrAddDevice(names[i], ordinal);
+		device.IsConnected = true;
+		device.LastSeen = now;
+	}
+}
+
+
+/**	\brief		Chooses the devices which are worth writing to the settings file.
+ *	\returns	Pointers into fDevicesStatus, in its order.
+ *	\details	If there are more than kMaxDeviceHistory devices, the least recently
+ *				seen ones are dropped until the limit is met. Connected devices
+ *				and the devices with a policy (see DeviceInfo::HasPolicy()) are
+ *				never dropped, so the limit may still be exceeded by them.
+ */
+std::vector<const DeviceInfo*> Settings::CompactedDevices() const {
+	std::vector<const DeviceInfo*> toReturn;
+	toReturn.reserve(fDevicesStatus.size());
 	for (const auto& device : fDevicesStatus) {
-		if (device.IsConnected) {
-			toReturn.push_back(device);
+		toReturn.push_back(&device);
+	}
+	if (toReturn.size() <= (size_t)kMaxDeviceHistory) { return toReturn; }
+
+	std::vector<const DeviceInfo*> evictable;
+	for (const DeviceInfo* device : toReturn) {
+		if (!device->IsConnected && !device->HasPolicy()) { evictable.push_back(device); }
+	}
+	size_t excess = toReturn.size() - kMaxDeviceHistory;
+	if (excess > evictable.size()) { excess = evictable.size(); }
+	std::partial_sort(evictable.begin(), evictable.begin() + excess, evictable.end(),
+		[](const DeviceInfo* a, const DeviceInfo* b) { return a->LastSeen < b->LastSeen; });
+
+	std::unordered_set<const DeviceInfo*> evicted(evictable.begin(), evictable.begin() + excess);
+	toReturn.erase(std::remove_if(toReturn.begin(), toReturn.end(),
+		[&evicted](const DeviceInfo* device) { return evicted.count(device) != 0; }),
+		toReturn.end());
+	return toReturn;
+}
+
+
+/**	\brief		Sets the emergency "unignore all" chord, which is detected by the add-on.
+ *	\param[in]	modifiers	Combination of B_CONTROL_KEY, B_COMMAND_KEY etc.
+ *							Bits outside of kChordModifiersMask are dropped.
+ *	\param[in]	key			Unmodified character of the key, e.g. 'e'. 0 disables the chord.
+ */
+void Settings::SetEmergencyChord(uint32 modifiers, uint32 key) {
+	fChordModifiers = modifiers & kChordModifiersMask;
+	fChordKey = key;
+}
+
+
+/**	\brief		Returns the emergency chord, see Settings::SetEmergencyChord().
+ *	\param[out]	modifiers	Modifiers of the chord. May be `NULL`.
+ *	\param[out]	key			Unmodified character of the chord. May be `NULL`.
+ */
+void Settings::GetEmergencyChord(uint32* modifiers, uint32* key) const {
+	if (modifiers)	*modifiers = fChordModifiers;
+	if (key)		*key = fChordKey;
+}
+
+
+/**	\brief		Sets how long the hotplug-driven work waits for the devices to settle.
+ *	\param[in]	hysteresis	In microseconds, 0 to react to every notification.
+ *							Clamped to kMaxHotplugHysteresis.
+ *	\see		HotplugDebouncer
+ *	\note		Only the in-memory copy is updated, call Settings::Save() to persist it.
+ */
+void Settings::SetHotplugHysteresis(bigtime_t hysteresis) {
+	fHotplugHysteresis = std::min(std::max(hysteresis, (bigtime_t)0), kMaxHotplugHysteresis);
+}
+
+
+/**	\brief		Tags the next Save() with a correlation id, to trace how fast the add-on applies it.
+ *	\param[in]	id			Correlation id of the change, 0 stops tracing.
+ *	\param[in]	started		`system_time()` when the user issued the command.
+ *	\param[in]	device		DeviceFingerprint() of the device the change is about,
+ *							its first dropped event ends the trace. 0 if none.
+ *	\details	The id travels in the snapshot header. The add-on records when
+ *				the snapshot was noticed and applied, and when the device's
+ *				first event was dropped afterwards, in the SharedCounters area.
+ */
+void Settings::SetTrace(uint32 id, bigtime_t started, device_fingerprint device) {
+	fTraceId = id;
+	fTraceStarted = started;
+	fTraceDevice = device;
+}
+
+
+/**	\brief		Returns the index of the application in SnapshotHeader::focusClasses, adding it if needed.
+ *	\param[in]	header		Header of the snapshot being built.
+ *	\param[in]	signature	Signature of the application. Signatures are case-insensitive.
+ *	\returns	The index, or -1 if all kMaxFocusClasses entries are taken.
+ */
+static int32 FocusClass(SnapshotHeader* header, const BString& signature) {
+	for (int32 i = 0; i < header->focusClassCount; i++) {
+		if (signature.ICompare(header->focusClasses[i]) == 0) { return i; }
+	}
+	if (header->focusClassCount >= kMaxFocusClasses) { return -1; }
+	strlcpy(header->focusClasses[header->focusClassCount], signature.String(), kSnapshotNameLength);
+	return header->focusClassCount++;
+}
+
+
+/**	\brief		Converts the settings into the startup snapshot layout.
+ *	\param[out]	out		Snapshot to fill. Must not be `NULL`.
+ *	\note		Only the ignored devices and those with a suppression mask, an
+ *				activity or a focus policy are stored: the add-on has nothing to do with the rest of them. Names longer than
+ *				kSnapshotNameLength are truncated, and so are the lists with
+ *				more than kMaxSnapshotDevices ignored devices.
+ *	\details	The application signatures of all focus policies are collected
+ *				into SnapshotHeader::focusClasses, and each device refers to them
+ *				by bits of SnapshotRecord::focusMask.
+ */
+void Settings::BuildSnapshot(IgnoreSnapshot* out) const {
+	memset(out, 0, sizeof(IgnoreSnapshot));
+	out->header.magic = IGNORE_SNAPSHOT_MAGIC;
+	out->header.version = IGNORE_SNAPSHOT_VERSION;
+	out->header.written = system_time();
+	out->header.chordModifiers = fChordModifiers;
+	out->header.chordKey = fChordKey;
+	out->header.traceId = fTraceId;
+	out->header.traceStarted = fTraceStarted;
+	out->header.traceFingerprint = fTraceDevice;
+
+	int32 count = 0;
+	for (const auto& device : fDevicesStatus) {
+		bool whileActive = device.SuppressWhileActive.Length() > 0;
+		bool whileFocused = !device.IgnoreWhileFocused.empty();
+		if (!device.IsIgnored && !whileActive && !whileFocused && device.SuppressMask == 0) { continue; }
+		if (count >= kMaxSnapshotDevices) {
+			LOG_WARNING("Settings Snapshot", "Too many ignored devices, \"%s\" is not stored.",
+				device.DeviceName.String());
+			continue;
+		}
+		SnapshotRecord& record = out->records[count++];
+		strlcpy(record.name, device.DeviceName.String(), sizeof(record.name));
+		record.fingerprint = device.Fingerprint;
+		if (device.IsIgnored) {
+			record.flags |= kSnapshotIgnored;
+			record.ignoredUntil = device.IgnoredUntil;
 		}
+		record.mask = device.SuppressMask;
+		if (whileActive) {
+			record.flags |= kSnapshotWhileActive;
+			strlcpy(record.trigger, device.SuppressWhileActive.String(), sizeof(record.trigger));
+			record.triggerFingerprint = DeviceFingerprint(record.trigger);
+			record.windowMs = device.ActivityWindow / 1000;
+		}
+		for (const BString& signature : device.IgnoreWhileFocused) {
+			int32 focusClass = FocusClass(&out->header, signature);
+			if (focusClass < 0) {
+				LOG_WARNING("Settings Snapshot", "Too many focus applications, \"%s\" is not stored.",
+					signature.String());
+				continue;
+			}
+			record.focusMask |= 1 << focusClass;
+		}
+		if (record.focusMask != 0) { record.flags |= kSnapshotWhileFocused; }
+	}
+	out->header.count = count;
+}
+
+
+/**	\brief		Stores the current policies of all devices as a named profile.
+ *	\param[in]	name	Name of the profile. An existing profile is overwritten.
+ *	\note		Only the devices with a policy are stored, the device history
+ *				stays in the main list.
+ *	\note		Only the in-memory copy is updated, call Settings::Save() to persist it.
+ */
+void Settings::SaveProfile(BString name) {
+	std::vector<DeviceInfo> devices;
+	for (const auto& device : fDevicesStatus) {
+		if (device.HasPolicy()) { devices.push_back(device); }
+	}
+
+	auto found = fProfileIndex.find(name.String());
+	if (found != fProfileIndex.end()) {
+		fProfiles[found->second].Devices.swap(devices);
+	} else {
+		SettingsProfile profile;
+		profile.Name = name;
+		profile.Devices.swap(devices);
+		fProfileIndex[name.String()] = fProfiles.size();
+		fProfiles.push_back(profile);
+	}
+	fActiveProfile = name;
+}
+
+
+/**	\brief		Replaces the policies of all devices with those of the profile.
+ *	\param[in]	name	Name of the profile.
+ *	\returns	B_OK, or B_NAME_NOT_FOUND if there's no such profile.
+ *	\details	The profile is found by a hash lookup. The policies of all known
+ *				devices are reset, and those of the profile are copied over them.
+ *				Settings::Save() then publishes it in a single snapshot, which
+ *				the add-on applies in one pass.
+ *	\note		Only the in-memory copy is updated, call Settings::Save() to persist it.
+ */
+status_t Settings::ActivateProfile(BString name) {
+	auto found = fProfileIndex.find(name.String());
+	if (found == fProfileIndex.end()) { return B_NAME_NOT_FOUND; }
+
+	for (auto& device : fDevicesStatus) {
+		device.IsIgnored = false;
+		device.IgnoredUntil = 0;
+		device.SuppressMask = 0;
+		device.SuppressWhileActive = "";
+		device.ActivityWindow = kDefaultActivityWindow;
+		device.IgnoreWhileFocused.clear();
+		device.Strategy = kStrategyAuto;
+	}
+	for (const auto& profiled : fProfiles[found->second].Devices) {
+		DeviceInfo& device = FindOrAddDevice(profiled.DeviceName, profiled.Ordinal);
+		device.IsIgnored = profiled.IsIgnored;
+		device.IgnoredUntil = profiled.IgnoredUntil;
+		device.SuppressMask = profiled.SuppressMask;
+		device.SuppressWhileActive = profiled.SuppressWhileActive;
+		device.ActivityWindow = profiled.ActivityWindow;
+		device.IgnoreWhileFocused = profiled.IgnoreWhileFocused;
+		device.Strategy = profiled.Strategy;
+	}
+	fActiveProfile = name;
+	return B_OK;
+}
+
+
+/**	\brief		Removes the profile. The policies of the devices are not changed.
+ *	\returns	B_OK, or B_NAME_NOT_FOUND if there's no such profile.
+ *	\note		Only the in-memory copy is updated, call Settings::Save() to persist it.
+ */
+status_t Settings::DeleteProfile(BString name) {
+	auto found = fProfileIndex.find(name.String());
+	if (found == fProfileIndex.end()) { return B_NAME_NOT_FOUND; }
+
+	fProfiles.erase(fProfiles.begin() + found->second);
+	RebuildProfileIndex();
+	if (fActiveProfile == name) { fActiveProfile = ""; }
+	return B_OK;
+}
+
+
+/**	\brief		Returns the names of all profiles, in the order they were created.
+ */
+std::vector<BString> Settings::GetProfileNames() const {
+	std::vector<BString> toReturn;
+	for (const auto& profile : fProfiles) {
+		toReturn.push_back(profile.Name);
 	}
 	return toReturn;
 }
+
+
+/**	\brief		Recomputes fProfileIndex after fProfiles were reordered or reloaded.
+ */
+void Settings::RebuildProfileIndex() {
+	fProfileIndex.clear();
+	for (size_t i = 0; i < fProfiles.size(); i++) {
+		fProfileIndex[fProfiles[i].Name.String()] = i;
+	}
+}
+
+
+/**	\brief		Returns the devices that are marked as connected.
+ *	\details	The view refers to the table of the devices, nothing is copied.
+ *	\see		Settings::MarkConnected
+ */
+DeviceView Settings::GetCurrentlyAttachedDevices() const {
+	return DeviceView(fDevicesStatus.data(),
+		fDevicesStatus.data() + fDevicesStatus.size(), true);
+}
+
+
+/**	\brief		Merges the devices of the settings with the connected ones.
+ *	\param[in]	connected	The devices connected right now, e.g. from
+ *							`get_input_devices()`. Sorted in place by fingerprint.
+ *	\param[in]	count		Number of items in `connected`.
+ *	\returns	A view with every device once: the connected ones, with their
+ *				settings if there are any, and the remembered ones which are not
+ *				connected now.
+ *	\details	Unlike Settings::MarkConnected(), nothing is modified and nothing
+ *				is allocated, so the tray menu and the CLI may call it as often
+ *				as they like.
+ */
+MergedDeviceView Settings::GetMergedListOfDevices(ConnectedDevice* connected, size_t count) const {
+	std::sort(connected, connected + count,
+		[](const ConnectedDevice& a, const ConnectedDevice& b) { return a.fingerprint < b.fingerprint; });
+	return MergedDeviceView(fDevicesStatus.data(), fDevicesStatus.data() + fDevicesStatus.size(),
+		connected, connected + count);
+}
@@ -22,14 +22,125 @@
 #define _SETTINGS_H_
 
 #include <Errors.h>
+#include <InterfaceDefs.h>
 #include <Locker.h>
 #include <Messenger.h>
 #include <Node.h>
+#include <Path.h>
 #include <String.h>
 #include <iostream>
+#include <iterator>
+#include <string>
 #include <unordered_map>
 #include <vector>
 
+#include "device_types.h"
+
+struct IgnoreSnapshot;
+class SettingsWatcher;
+
+
+//!	Modifiers that matter for the emergency chord. Left/right and lock bits are ignored.
+const uint32	kChordModifiersMask = B_SHIFT_KEY | B_COMMAND_KEY | B_CONTROL_KEY
+									| B_OPTION_KEY | B_MENU_KEY;
+//!	Default emergency "unignore all" chord is Ctrl + Alt + Win + E.
+const uint32	kDefaultChordModifiers = B_CONTROL_KEY | B_COMMAND_KEY | B_OPTION_KEY;
+//!	\copydoc	kDefaultChordModifiers
+const uint32	kDefaultChordKey = 'e';
+
+
+//!	Names of the event classes, as used by the CLI and the settings.
+extern const char* const	kEventClassNames[kEventClassCount];
+
+/**	\enum		device_class
+ *	\brief		What kind of pointing device a device is, see ClassifyDevice().
+ */
+enum device_class {
+	kDeviceUnknown = 0,		//!<	Not classified, or nothing gave it away
+	kDeviceMouse,			//!<	Mouse or trackball, moves relatively
+	kDeviceTouchpad,		//!<	Touchpad, taps
+	kDeviceTablet,			//!<	Tablet or pen, reports absolute positions
+	kDeviceClassCount		//!<	Number of classes, not a class itself
+};
+
+//!	Names of the device classes, as used by the CLI and the settings.
+extern const char* const	kDeviceClassNames[kDeviceClassCount];
+
+/**	\enum		device_trait
+ *	\brief		What the add-on saw a device do, which gives its class away.
+ *	\see		DeviceCounters::traits
+ */
+enum device_trait {
+	kTraitTap		= 1 << 0,	//!<	Sent a B_MOUSE_DOWN with "be:tap"
+	kTraitAbsolute	= 1 << 1	//!<	Sent a B_MOUSE_DOWN with "be:tablet_x"
+};
+
+/**	\enum		class_source
+ *	\brief		Where DeviceInfo::Class comes from.
+ */
+enum class_source {
+	kClassNotYet = 0,		//!<	Not classified yet
+	kClassByName,			//!<	Guessed from the name, may be upgraded by the traits
+	kClassByTraits			//!<	Seen in the events, final
+};
+
+//!	\copydoc	ClassifyDevice
+device_class	ClassifyDevice(const char* name, uint32 traits = 0);
+//!	\copydoc	DeviceClassFromString
+bool			DeviceClassFromString(const char* name, device_class* deviceClass);
+
+/**	\enum		suppress_strategy
+ *	\brief		How an ignored device is kept quiet, see DeviceInfo::EffectiveStrategy().
+ *	\details	The add-on drops the events of an ignored device whatever its
+ *				strategy is; the strategy tells what is done before that, so
+ *				that the events aren't produced in the first place.
+ */
+enum suppress_strategy {
+	kStrategyAuto = 0,		//!<	kStrategyStop if ignored for long, kStrategyFilter otherwise
+	kStrategyFilter,		//!<	The device keeps running, only the add-on drops its events
+	kStrategyStop,			//!<	The device is stopped, input_server doesn't read it at all
+	kStrategyThrottle,		//!<	The driver is asked through `Control()` to stop reporting
+	kStrategyCount			//!<	Number of strategies, not a strategy itself
+};
+
+//!	Names of the strategies, as used by the CLI and the settings.
+extern const char* const	kStrategyNames[kStrategyCount];
+//!	\copydoc	StrategyFromString
+bool			StrategyFromString(const char* name, suppress_strategy* strategy);
+
+/**	An ignore which ends later than this is long-term, and kStrategyAuto stops
+ *	the device. A shorter one leaves it running, so it's back without a restart.
+ *	The hour is a guess, not a measured break-even. */
+const bigtime_t	kLongTermIgnore = 3600000000LL;
+
+/**	How many devices the settings remember. Beyond this, the least recently
+ *	seen disconnected devices without any policy are forgotten on save. */
+const int32		kMaxDeviceHistory = 64;
+
+//!	Default for DeviceInfo::ActivityWindow, in microseconds.
+const bigtime_t	kDefaultActivityWindow = 500000;
+//!	Longest DeviceInfo::ActivityWindow accepted, in microseconds.
+const bigtime_t	kMaxActivityWindow = 60000000;
+
+
+/**	\enum		settings_change
+ *	\brief		Kinds of changes of the settings file, which subscribers may filter on.
+ *	\see		Settings::AddSubscriber
+ */
+enum settings_change {
+	kChangeStatus	= 1 << 0,		//!<	A device was ignored or unignored
+	kChangePolicy	= 1 << 1,		//!<	Suppression mask, activity policy or strategy of a device
+	kChangeHistory	= 1 << 2,		//!<	A device was connected, disconnected or forgotten
+	kChangeProfiles	= 1 << 3,		//!<	Profiles, or the active profile
+	kChangeChord	= 1 << 4,		//!<	The emergency chord
+	kChangeHotplug	= 1 << 5,		//!<	The hysteresis of the hotplug-driven work
+	kChangeAll		= (1 << 6) - 1	//!<	Everything
+};
+
+/**	What the subscribers receive when the settings file changes. The "changes"
+ *	field holds the settings_change bits; the rest is for Settings::ApplyChanges(). */
+const uint32	kMsgSettingsChanged = 'ITsc';
+
 
 /**	\struct		DeviceInfo
  *	\brief		This struct holds a single device and its status (is it currently connected,
@@ -39,11 +150,47 @@
  */
 struct DeviceInfo {
 	BString		DeviceName;		//!<	Name of the input device
+	/**	Number of the device among the connected devices with the same name,
+	 *	in the order of `get_input_devices()`. 0 for a device with a unique name.
+	 *	\warning	Identical devices can't be told apart. The ordinal only keeps
+	 *				their records apart in the settings; nothing else knows it.
+	 *				The add-on sees only the names in the events, so it applies
+	 *				the policy of ordinal 0 to all of them, and DeviceControl
+	 *				starts and stops devices by name, i.e. always the first one.
+	 *				Nor is the ordinal stable: if the first of two identical mice
+	 *				is unplugged, the second one becomes ordinal 0. */
+	uint32		Ordinal;
+	//!	DeviceFingerprint() of DeviceName and Ordinal.
+	device_fingerprint	Fingerprint;
 	bool		IsConnected;	//!<	Is the device currently connected? Yes = "true".
+	//!	`real_time_clock_usecs()` when the device was last seen connected, 0 if never.
+	bigtime_t	LastSeen;
 	bool		IsIgnored;		//!<	Is the device's input ignored? Yes = "true".
+	/**	`real_time_clock_usecs()` when IsIgnored goes back to "false" by itself,
+	 *	0 if the device is ignored until told otherwise. */
+	bigtime_t	IgnoredUntil;
+	/**	Bit `1 << class` for each event_class that is dropped even when the
+	 *	device isn't ignored, e.g. taps and clicks of a touchpad. 0 if none. */
+	uint8		SuppressMask;
+	/**	Name of another device. While that device is in active use, the input
+	 *	of this one is ignored, even if IsIgnored is "false". Empty if unused. */
+	BString		SuppressWhileActive;
+	//!	How long after its last event the SuppressWhileActive device counts as active, in microseconds.
+	bigtime_t	ActivityWindow;
+	/**	Signatures of applications, e.g. "application/x-vnd.Haiku-Terminal".
+	 *	While one of them is the active application, the input of this device
+	 *	is ignored, even if IsIgnored is "false". Empty if unused. */
+	std::vector<BString>	IgnoreWhileFocused;
+	//!	The device_class, cached so that a device is classified once. See Settings::Classify.
+	uint8		Class;
+	//!	The class_source of Class, kClassNotYet if the device wasn't classified.
+	uint8		ClassSource;
+	//!	The suppress_strategy chosen for the device, kStrategyAuto if none was.
+	uint8		Strategy;
 
 	//!		copydoc	DeviceInfo::DeviceInfo	
-	DeviceInfo(BString name, bool connected = true, bool ignored = false);
+	DeviceInfo(const BString& name = "", bool connected = true, bool ignored = false,
+			uint32 ordinal = 0);
 	
 	//!		copydoc	DeviceInfo::ToBMessage
 	status_t ToBMessage(BMessage* ) const;
@@ -53,6 +200,218 @@ struct DeviceInfo {
 	
 	//!		Printing debugging information
 	void DebugPrint(void) const;
+	
+	//!		copydoc	DeviceInfo::EffectiveStrategy
+	suppress_strategy EffectiveStrategy(bigtime_t now) const;
+	
+	//!		`true` if the device has any policy, i.e. the settings must keep it.
+	bool HasPolicy() const { return IsIgnored || SuppressMask != 0
+									|| SuppressWhileActive.Length() > 0
+									|| !IgnoreWhileFocused.empty()
+									|| Strategy != kStrategyAuto; }
+};
+
+
+/**	\struct		SettingsProfile
+ *	\brief		Named set of device policies, e.g. "docked" or "travel".
+ *	\see		Settings::ActivateProfile
+ */
+struct SettingsProfile {
+	BString					Name;		//!<	Name of the profile
+	std::vector<DeviceInfo>	Devices;	//!<	The devices with their policies, ready to be swapped in
+	
+	//!	Stores the profile into a 'PROF' BMessage.
+	status_t ToBMessage(BMessage* ) const;
+	//!	Reads the profile from a 'PROF' BMessage.
+	status_t FromBMessage(const BMessage* );
+};
+
+
+/**	\class		DeviceView
+ *	\brief		Read-only view of the devices known to the Settings, which copies nothing.
+ *	\details	Iterates over the devices in place, in the order of their
+ *				fingerprints, optionally skipping the disconnected ones.
+ *	\note		Valid until the Settings are loaded, a device is added or the
+ *				Settings object is destroyed, like an iterator of a vector.
+ */
+class DeviceView {
+public:
+	//!	Forward iterator over the devices of the view.
+	class const_iterator {
+	public:
+		typedef std::forward_iterator_tag	iterator_category;
+		typedef DeviceInfo					value_type;
+		typedef ptrdiff_t					difference_type;
+		typedef const DeviceInfo*			pointer;
+		typedef const DeviceInfo&			reference;
+
+		const_iterator(const DeviceInfo* current, const DeviceInfo* end, bool connectedOnly)
+			: fCurrent(current), fEnd(end), fConnectedOnly(connectedOnly) { Skip(); }
+
+		reference operator*() const { return *fCurrent; }
+		pointer operator->() const { return fCurrent; }
+		const_iterator& operator++() { ++fCurrent; Skip(); return *this; }
+		const_iterator operator++(int) { const_iterator old = *this; ++*this; return old; }
+		bool operator==(const const_iterator& other) const { return fCurrent == other.fCurrent; }
+		bool operator!=(const const_iterator& other) const { return fCurrent != other.fCurrent; }
+
+	private:
+		//!	Moves to the next device which belongs to the view.
+		void Skip() { while (fConnectedOnly && fCurrent != fEnd && !fCurrent->IsConnected) ++fCurrent; }
+
+		const DeviceInfo*	fCurrent;
+		const DeviceInfo*	fEnd;
+		bool				fConnectedOnly;
+	};
+
+	DeviceView(const DeviceInfo* begin, const DeviceInfo* end, bool connectedOnly)
+		: fBegin(begin), fEnd(end), fConnectedOnly(connectedOnly) {}
+
+	const_iterator begin() const { return const_iterator(fBegin, fEnd, fConnectedOnly); }
+	const_iterator end() const { return const_iterator(fEnd, fEnd, fConnectedOnly); }
+	//!	`true` if the view has no devices.
+	bool IsEmpty() const { return begin() == end(); }
+	//!	Number of the devices in the view. Walks the view if it skips the disconnected devices.
+	size_t Count() const { return fConnectedOnly ? std::distance(begin(), end()) : fEnd - fBegin; }
+
+protected:
+	const DeviceInfo*	fBegin;				//!<	First device of the table
+	const DeviceInfo*	fEnd;				//!<	One past the last device of the table
+	bool				fConnectedOnly;		//!<	Skip the disconnected devices
+};
+
+
+/**	\struct		ConnectedDevice
+ *	\brief		A device which is connected right now, as the caller sees it.
+ *	\details	The input of Settings::GetMergedListOfDevices(). Only refers to
+ *				the name, so the caller's strings must outlive the merged view.
+ */
+struct ConnectedDevice {
+	const char*			name;			//!<	Name of the device
+	uint32				ordinal;		//!<	See DeviceInfo::Ordinal
+	device_fingerprint	fingerprint;	//!<	DeviceFingerprint() of the name and the ordinal
+
+	//!	Fills the fields, computing the fingerprint.
+	void SetTo(const char* deviceName, uint32 deviceOrdinal = 0) {
+		name = deviceName;
+		ordinal = deviceOrdinal;
+		fingerprint = DeviceFingerprint(deviceName, deviceOrdinal);
+	}
+	//!	Fills the fields with a fingerprint computed before, e.g. by DeviceTable.
+	void SetTo(const char* deviceName, uint32 deviceOrdinal, device_fingerprint deviceFingerprint) {
+		name = deviceName;
+		ordinal = deviceOrdinal;
+		fingerprint = deviceFingerprint;
+	}
+};
+
+
+/**	\struct		MergedDevice
+ *	\brief		A device of the merged list, see Settings::GetMergedListOfDevices().
+ */
+struct MergedDevice {
+	const char*			name;			//!<	Name of the device
+	uint32				ordinal;		//!<	See DeviceInfo::Ordinal
+	device_fingerprint	fingerprint;	//!<	DeviceFingerprint() of the name and the ordinal
+	bool				connected;		//!<	`true` if the caller reported it as connected
+	//!	What the settings know about the device, `NULL` if it's new.
+	const DeviceInfo*	stored;
+
+	//!	`true` if the settings ignore the device.
+	bool IsIgnored() const { return stored && stored->IsIgnored; }
+};
+
+
+/**	\class		MergedDeviceView
+ *	\brief		Union of the devices of the settings and the connected ones,
+ *				by fingerprint, without copying either.
+ *	\details	Both sides are sorted by fingerprint, so the iterator merges
+ *				them in a single pass, producing a MergedDevice per device.
+ *	\note		Valid as long as both the DeviceView and the caller's array are.
+ */
+class MergedDeviceView {
+public:
+	//!	Forward iterator over the merged devices. Dereferencing returns by value.
+	class const_iterator {
+	public:
+		typedef std::forward_iterator_tag	iterator_category;
+		typedef MergedDevice				value_type;
+		typedef ptrdiff_t					difference_type;
+		typedef const MergedDevice*			pointer;
+		typedef MergedDevice				reference;
+
+		const_iterator(const DeviceInfo* stored, const DeviceInfo* storedEnd,
+				const ConnectedDevice* connected, const ConnectedDevice* connectedEnd)
+			: fStored(stored), fStoredEnd(storedEnd),
+			  fConnected(connected), fConnectedEnd(connectedEnd) {}
+
+		MergedDevice operator*() const {
+			MergedDevice merged;
+			bool haveStored = fStored != fStoredEnd;
+			bool haveConnected = fConnected != fConnectedEnd;
+			if (haveConnected
+				&& (!haveStored || fConnected->fingerprint <= fStored->Fingerprint))
+			{
+				merged.name = fConnected->name;
+				merged.ordinal = fConnected->ordinal;
+				merged.fingerprint = fConnected->fingerprint;
+				merged.connected = true;
+				merged.stored = (haveStored && fConnected->fingerprint == fStored->Fingerprint)
+					? fStored : NULL;
+			} else {
+				merged.name = fStored->DeviceName.String();
+				merged.ordinal = fStored->Ordinal;
+				merged.fingerprint = fStored->Fingerprint;
+				merged.connected = false;
+				merged.stored = fStored;
+			}
+			return merged;
+		}
+		const_iterator& operator++() {
+			bool haveStored = fStored != fStoredEnd;
+			bool haveConnected = fConnected != fConnectedEnd;
+			if (haveStored && haveConnected && fStored->Fingerprint == fConnected->fingerprint) {
+				++fStored;
+				++fConnected;
+			} else if (haveConnected
+				&& (!haveStored || fConnected->fingerprint < fStored->Fingerprint))
+			{
+				++fConnected;
+			} else {
+				++fStored;
+			}
+			return *this;
+		}
+		const_iterator operator++(int) { const_iterator old = *this; ++*this; return old; }
+		bool operator==(const const_iterator& other) const {
+			return fStored == other.fStored && fConnected == other.fConnected;
+		}
+		bool operator!=(const const_iterator& other) const { return !(*this == other); }
+
+	private:
+		const DeviceInfo*		fStored;
+		const DeviceInfo*		fStoredEnd;
+		const ConnectedDevice*	fConnected;
+		const ConnectedDevice*	fConnectedEnd;
+	};
+
+	MergedDeviceView(const DeviceInfo* stored, const DeviceInfo* storedEnd,
+			const ConnectedDevice* connected, const ConnectedDevice* connectedEnd)
+		: fStored(stored), fStoredEnd(storedEnd),
+		  fConnected(connected), fConnectedEnd(connectedEnd) {}
+
+	const_iterator begin() const {
+		return const_iterator(fStored, fStoredEnd, fConnected, fConnectedEnd);
+	}
+	const_iterator end() const {
+		return const_iterator(fStoredEnd, fStoredEnd, fConnectedEnd, fConnectedEnd);
+	}
+
+protected:
+	const DeviceInfo*		fStored;			//!<	Devices of the settings, by fingerprint
+	const DeviceInfo*		fStoredEnd;			//!<	One past the last device of the settings
+	const ConnectedDevice*	fConnected;			//!<	Connected devices, by fingerprint
+	const ConnectedDevice*	fConnectedEnd;		//!<	One past the last connected device
 };
 
 
@@ -60,6 +419,10 @@ struct DeviceInfo {
  *	\brief		The main purpose of the library
  *	\details	Provides interface for reading and writing the settings file.
  *				Allows the add-on to receive live updates if monitoring is active.
+ *	\details	Any number of subscribers may be notified about the changes. The
+ *				file is watched and reloaded once per change, whatever their
+ *				number; each of them gets the same kMsgSettingsChanged message,
+ *				if the change is of a kind it asked for.
  */
 class Settings {
 public:
@@ -70,33 +433,150 @@ public:
 	
 	void Save() const;		//!<	\copydoc	Settings::Save
 	void Load();			//!<	\copydoc	Settings::Load
+	//!	\copydoc	Settings::Load(const BMessage*)
+	void Load(const BMessage* readFrom);
+	//!	\copydoc	Settings::ReadFile
+	status_t ReadFile(BMessage* readFrom) const;
 	
 	//!	\copydoc	Settings::GetStatus
-	bool GetStatus(BString deviceName);
+	bool GetStatus(BString deviceName, uint32 ordinal = 0);
+	
+	//!	\copydoc	Settings::SetStatus
+	void SetStatus(BString deviceName, bool ignored, uint32 ordinal = 0);
+	//!	\copydoc	Settings::SetIgnoredUntil
+	void SetIgnoredUntil(BString deviceName, bigtime_t until, uint32 ordinal = 0);
+	
+	void ClearAllIgnored();			//!<	\copydoc	Settings::ClearAllIgnored
+	
+	//!	\copydoc	Settings::MarkConnected
+	void MarkConnected(const std::vector<BString>& names);
+	
+	//!	\copydoc	Settings::SetSuppressMask
+	void SetSuppressMask(BString deviceName, uint8 mask, uint32 ordinal = 0);
+	//!	\copydoc	Settings::GetSuppressMask
+	uint8 GetSuppressMask(BString deviceName, uint32 ordinal = 0) const;
+	
+	//!	\copydoc	Settings::SetSuppressWhileActive
+	void SetSuppressWhileActive(BString deviceName, BString trigger,
+								bigtime_t window = kDefaultActivityWindow,
+								uint32 ordinal = 0);
+	
+	//!	\copydoc	Settings::SetIgnoreWhileFocused
+	void SetIgnoreWhileFocused(BString deviceName, const std::vector<BString>& signatures,
+								uint32 ordinal = 0);
+	
+	//!	\copydoc	Settings::SetStrategy
+	void SetStrategy(BString deviceName, suppress_strategy strategy, uint32 ordinal = 0);
+	//!	\copydoc	Settings::GetStrategy
+	suppress_strategy GetStrategy(BString deviceName, uint32 ordinal = 0) const;
+	//!	\copydoc	Settings::GetEffectiveStrategy
+	suppress_strategy GetEffectiveStrategy(BString deviceName, uint32 ordinal = 0) const;
+	
+	//!	\copydoc	Settings::Classify
+	device_class Classify(BString deviceName, uint32 ordinal = 0, uint32 traits = 0,
+							bool* changed = NULL);
+	
+	//!	\copydoc	Settings::SetEmergencyChord
+	void SetEmergencyChord(uint32 modifiers, uint32 key);
+	//!	\copydoc	Settings::GetEmergencyChord
+	void GetEmergencyChord(uint32* modifiers, uint32* key) const;
+	
+	//!	\copydoc	Settings::SetHotplugHysteresis
+	void SetHotplugHysteresis(bigtime_t hysteresis);
+	//!	Window of the HotplugDebouncer of everyone who reacts to hotplug, 0 if none.
+	bigtime_t HotplugHysteresis() const { return fHotplugHysteresis; }
+	
+	//!	\copydoc	Settings::SetTrace
+	void SetTrace(uint32 id, bigtime_t started, device_fingerprint device = 0);
+	
+	//!	\copydoc	Settings::BuildSnapshot
+	void BuildSnapshot(IgnoreSnapshot* out) const;
+	
+	//!	\copydoc	Settings::SaveProfile
+	void SaveProfile(BString name);
+	//!	\copydoc	Settings::ActivateProfile
+	status_t ActivateProfile(BString name);
+	//!	\copydoc	Settings::DeleteProfile
+	status_t DeleteProfile(BString name);
+	//!	\copydoc	Settings::GetProfileNames
+	std::vector<BString> GetProfileNames() const;
+	//!	Name of the last activated profile, empty if none.
+	BString GetActiveProfile() const { return fActiveProfile; }
 	
 	status_t StartMonitoring();		//!<	\copydoc	Settings::StartMonitoring
 	void StopMonitoring();			//!<	\copydoc	Settings::StopMonitoring
 	
 	//!	\copydoc	Settings::SetNotifyTarget
 	void SetNotifyTarget(BMessenger* target);
+	//!	\copydoc	Settings::AddSubscriber
+	status_t AddSubscriber(const BMessenger& target, uint32 changes = kChangeAll);
+	//!	\copydoc	Settings::RemoveSubscriber
+	void RemoveSubscriber(const BMessenger& target);
+	//!	\copydoc	Settings::ApplyChanges
+	status_t ApplyChanges(const BMessage* notification);
 	
+	//!	All known devices, in the order of their fingerprints. Copies nothing.
+	DeviceView GetDevices() const { return DeviceView(fDevicesStatus.data(),
+										fDevicesStatus.data() + fDevicesStatus.size(), false); }
 	//!	\copydoc	Settings::GetCurrentlyAttachedDevices
-	std::vector<DeviceInfo> GetCurrentlyAttachedDevices() const;
+	DeviceView GetCurrentlyAttachedDevices() const;
 	
 	//!	\copydoc	Settings::GetMergedListOfDevices
-	std::vector<DeviceInfo> GetMergedListOfDevices() const;
+	MergedDeviceView GetMergedListOfDevices(ConnectedDevice* connected, size_t count) const;
+	//!	The known device with the fingerprint, `NULL` if there's none. A binary search.
+	const DeviceInfo* GetDevice(device_fingerprint fingerprint) const
+		{ return FindDevice(fingerprint); }
 	
 protected:
 	/**
 	 *	\brief		Structure that holds status of individual devices.
+	 *	\details	Sorted by DeviceInfo::Fingerprint, so the lookups are binary
+	 *				searches and the views come out in a stable order.
 	 *	\see		DeviceInfo
 	 */
 	std::vector<DeviceInfo> fDevicesStatus;
 	
-	BMessenger*	fTarget;	//!<	What BMessenger should be notified? Can be `NULL`.
+	//!	\copydoc	Settings::FindDevice
+	DeviceInfo* FindDevice(device_fingerprint fingerprint);
+	//!	\copydoc	Settings::FindDevice
+	const DeviceInfo* FindDevice(device_fingerprint fingerprint) const;
+	//!	\copydoc	Settings::FindOrAddDevice
+	DeviceInfo& FindOrAddDevice(const BString& deviceName, uint32 ordinal);
+	
+	std::vector<SettingsProfile>	fProfiles;		//!<	Named sets of device policies
+	//!	Index of each profile in fProfiles, by name
+	std::unordered_map<std::string, size_t>	fProfileIndex;
+	BString	fActiveProfile;		//!<	Name of the last activated profile
+	
+	void RebuildProfileIndex();		//!<	\copydoc	Settings::RebuildProfileIndex
+	//!	\copydoc	Settings::CompactedDevices
+	std::vector<const DeviceInfo*> CompactedDevices() const;
+	
+	uint32	fChordModifiers;	//!<	Modifiers of the emergency "unignore all" chord
+	uint32	fChordKey;			//!<	Unmodified character of the emergency chord, 0 if disabled
+	bigtime_t	fHotplugHysteresis;	//!<	\see	Settings::SetHotplugHysteresis
+	
+	uint32		fTraceId;			//!<	\see	Settings::SetTrace
+	bigtime_t	fTraceStarted;		//!<	\see	Settings::SetTrace
+	device_fingerprint	fTraceDevice;	//!<	\see	Settings::SetTrace
+	
+	//!	A subscriber and the settings_change bits it wants to hear about.
+	struct Subscriber {
+		BMessenger	target;
+		uint32		changes;
+	};
+	std::vector<Subscriber>	fSubscribers;	//!<	Who is notified, guarded by fLock
+	SettingsWatcher*	fWatcher;	//!<	The one file watcher of this object, `NULL` if none
+	friend class SettingsWatcher;
+	
+	//!	\copydoc	Settings::Notify
+	void Notify(BMessage* notification, uint32 changes);
+	//!	\copydoc	Settings::Diff
+	static uint32 Diff(const Settings& before, const Settings& after, BMessage* notification);
+	
 	bool	fMonitoringActive;	//!< `true` if monitoring is currently active, `false` otherwise.
-	//!	Used for updating the settings. Probably overkill, since I use BFile::Lock() as well.
-	BLocker	fLock;			
+	//!	Serializes Load(), Save() and the monitoring, which may run in different threads.
+	mutable BLocker	fLock;
 	
 	// Service function for creating a default file with settings. All devices are enabled.
 	// status_t	CreateSettingsFile() const;
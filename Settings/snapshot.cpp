@@ -0,0 +1,146 @@
+/*
+	Copyright 2025, Alexey "Hitech" Burshtein.   All Rights Reserved.
+	This file may be used under the terms of the MIT License.
+*/
+
+/**
+ * @file snapshot.cpp
+ * @brief Reading and writing of the startup snapshot.
+ * @ingroup SettingsModule
+ */
+
+#include "snapshot.h"
+
+#ifdef __HAIKU__
+#	include <FindDirectory.h>
+#endif
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+
+/**	\brief		Builds the path to the snapshot file into a caller-supplied buffer.
+ *	\details	Uses the C flavour of `find_directory()`, so no BPath is allocated.
+ *				Elsewhere the file lives in `$XDG_CONFIG_HOME`, or in
+ *				`$HOME/.config` if that isn't set.
+ *	\param[out]	buffer		Where to put the path.
+ *	\param[in]	size		Size of the buffer.
+ *	\param[in]	suffix		Appended to the file name, used for the temporary file.
+ */
+static status_t
+snapshot_path(char* buffer, size_t size, const char* suffix = "")
+{
+#ifdef __HAIKU__
+	status_t status = find_directory(B_USER_SETTINGS_DIRECTORY, -1, false,
+		buffer, size);
+	if (B_OK != status) { return status; }
+#else
+	const char* directory = getenv("XDG_CONFIG_HOME");
+	const char* home = getenv("HOME");
+	int directoryLength = directory && directory[0] != '\0'
+		? snprintf(buffer, size, "%s", directory)
+		: snprintf(buffer, size, "%s/.config", home ? home : ".");
+	if (directoryLength < 0 || (size_t)directoryLength >= size) { return B_NAME_TOO_LONG; }
+#endif
+
+	size_t length = strlen(buffer);
+	int written = snprintf(buffer + length, size - length, "/%s%s",
+		IGNORE_SNAPSHOT_FILE_NAME, suffix);
+	if (written < 0 || (size_t)written >= size - length) { return B_NAME_TOO_LONG; }
+	return B_OK;
+}
+
+
+/**	\brief		Reads the snapshot file.
+ *	\param[out]	out		Preallocated snapshot to read into. Must not be `NULL`.
+ *	\returns	B_OK				If the snapshot was read and is valid.
+ *				B_ENTRY_NOT_FOUND	If there's no snapshot file (nothing was ever saved).
+ *				B_BAD_DATA			If the file is truncated, or its magic, version
+ *									or count are wrong.
+ *				Some other error	If the path could not be built or the file could not be read.
+ *	\note		This is the fast path used by the add-on: one `open()`, one `read()`,
+ *				no heap allocations. On failure the whole header is zero, so the
+ *				caller may use the snapshot anyway: nothing will be ignored, and
+ *				there are no focus classes.
+ */
+status_t
+ReadSnapshot(IgnoreSnapshot* out)
+{
+	if (!out) { return B_BAD_VALUE; }
+	memset(&out->header, 0, sizeof(SnapshotHeader));
+
+	char path[B_PATH_NAME_LENGTH];
+	status_t status = snapshot_path(path, sizeof(path));
+	if (B_OK != status) { return status; }
+
+	int fd = open(path, O_RDONLY);
+	if (fd < 0) { return errno == ENOENT ? B_ENTRY_NOT_FOUND : errno; }
+
+	ssize_t bytesRead = read(fd, out, sizeof(IgnoreSnapshot));
+	status = bytesRead < 0 ? errno : B_OK;
+	close(fd);
+	if (B_OK != status) {
+		memset(&out->header, 0, sizeof(SnapshotHeader));
+		return status;
+	}
+
+	if (bytesRead < (ssize_t)sizeof(SnapshotHeader)
+		|| out->header.magic != IGNORE_SNAPSHOT_MAGIC
+		|| out->header.version != IGNORE_SNAPSHOT_VERSION
+		|| out->header.count > kMaxSnapshotDevices
+		|| bytesRead < (ssize_t)(sizeof(SnapshotHeader)
+			+ out->header.count * sizeof(SnapshotRecord)))
+	{
+		memset(&out->header, 0, sizeof(SnapshotHeader));
+		return B_BAD_DATA;
+	}
+
+	// Don't trust the file to have terminated the strings
+	for (int32 i = 0; i < out->header.count; i++) {
+		out->records[i].name[kSnapshotNameLength - 1] = '\0';
+		out->records[i].trigger[kSnapshotNameLength - 1] = '\0';
+	}
+	if (out->header.focusClassCount > kMaxFocusClasses) { out->header.focusClassCount = kMaxFocusClasses; }
+	for (int32 i = 0; i < out->header.focusClassCount; i++) {
+		out->header.focusClasses[i][kSnapshotNameLength - 1] = '\0';
+	}
+	return B_OK;
+}
+
+
+/**	\brief		Writes the snapshot file.
+ *	\param[in]	in		Snapshot to write. Must not be `NULL`.
+ *	\returns	B_OK if the snapshot was written, an error code otherwise.
+ *	\details	The data is written into a temporary file which is then renamed
+ *				over the old one, so the add-on never sees a half-written snapshot.
+ */
+status_t
+WriteSnapshot(const IgnoreSnapshot* in)
+{
+	if (!in || in->header.count > kMaxSnapshotDevices) { return B_BAD_VALUE; }
+
+	// Several threads may be saving at once, each one gets its own temporary file
+	char suffix[16];
+	snprintf(suffix, sizeof(suffix), "~%" B_PRId32, find_thread(NULL));
+
+	char path[B_PATH_NAME_LENGTH], tempPath[B_PATH_NAME_LENGTH];
+	status_t status = snapshot_path(path, sizeof(path));
+	if (B_OK == status) { status = snapshot_path(tempPath, sizeof(tempPath), suffix); }
+	if (B_OK != status) { return status; }
+
+	int fd = open(tempPath, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+	if (fd < 0) { return errno; }
+
+	size_t size = sizeof(SnapshotHeader) + in->header.count * sizeof(SnapshotRecord);
+	ssize_t written = write(fd, in, size);
+	status = written == (ssize_t)size ? B_OK : (written < 0 ? errno : B_IO_ERROR);
+	close(fd);
+
+	if (B_OK == status && rename(tempPath, path) != 0) { status = errno; }
+	if (B_OK != status) { unlink(tempPath); }
+	return status;
+}
@@ -0,0 +1,101 @@
+/*
+	Copyright 2025, Alexey "Hitech" Burshtein.   All Rights Reserved.
+	This file may be used under the terms of the MIT License.
+*/
+
+/**
+ * @file snapshot.h
+ * @brief Compact binary copy of the ignore state, read by the add-on at boot.
+ * @ingroup SettingsModule
+ *
+ * The main settings file is a flattened BMessage, which is convenient for the
+ * CLI and the GUI, but unflattening it means allocating a message per device.
+ * The input_server add-on is loaded very early, and it has to start dropping
+ * events before the user touches anything, so Settings::Save() also writes
+ * this fixed-layout snapshot. Reading it is a single `read()` into a
+ * preallocated structure, without any allocations.
+ *
+ * Devices that are neither ignored nor partially suppressed, nor suppressed
+ * by activity of another device or by the focused application are not
+ * stored at all.
+ */
+
+#ifndef _SNAPSHOT_H_
+#define _SNAPSHOT_H_
+
+#include "platform.h"
+
+
+//!	Magic number in the beginning of the snapshot file.
+#define IGNORE_SNAPSHOT_MAGIC		'ITsn'
+//!	Bumped every time the layout of the records changes.
+#define IGNORE_SNAPSHOT_VERSION		8
+//!	File name of the snapshot, it lives next to the settings file.
+#define IGNORE_SNAPSHOT_FILE_NAME	"IgnoreTouchpad.snapshot"
+
+const int32	kMaxSnapshotDevices = 32;		//!<	Devices beyond this are not persisted.
+const int32	kSnapshotNameLength = 64;		//!<	Including the terminating zero.
+const int32	kMaxFocusClasses = 16;			//!<	Applications beyond this don't suppress anything.
+
+//!	Flag in SnapshotRecord::flags: the device's input is ignored.
+const uint8	kSnapshotIgnored = 0x01;
+//!	Flag in SnapshotRecord::flags: the device is ignored while SnapshotRecord::trigger is active.
+const uint8	kSnapshotWhileActive = 0x02;
+//!	Flag in SnapshotRecord::flags: the device is ignored while an application of SnapshotRecord::focusMask is active.
+const uint8	kSnapshotWhileFocused = 0x04;
+
+
+/**	\struct		SnapshotHeader
+ *	\brief		Header of the snapshot file.
+ */
+struct SnapshotHeader {
+	uint32		magic;			//!<	Always IGNORE_SNAPSHOT_MAGIC
+	uint16		version;		//!<	Always IGNORE_SNAPSHOT_VERSION
+	uint16		count;			//!<	Number of valid records that follow
+	bigtime_t	written;		//!<	`system_time()` when the snapshot was written
+	uint32		chordModifiers;	//!<	Modifiers of the emergency chord, see Settings::SetEmergencyChord
+	uint32		chordKey;		//!<	Key of the emergency chord, 0 if disabled
+	uint32		traceId;		//!<	Correlation id of the change, 0 if it isn't traced
+	uint16		focusClassCount;	//!<	Number of valid entries in focusClasses
+	uint16		_reserved;		//!<	Padding, always zero
+	bigtime_t	traceStarted;	//!<	`system_time()` when the traced command was issued
+	uint64		traceFingerprint;	//!<	DeviceFingerprint() of the device the change is about, 0 if none
+	/**	Signatures of the applications any device is ignored for while they
+	 *	are active, see DeviceInfo::IgnoreWhileFocused. Bit `1 << i` of
+	 *	SnapshotRecord::focusMask stands for the i-th of them. */
+	char		focusClasses[kMaxFocusClasses][kSnapshotNameLength];
+};
+
+
+/**	\struct		SnapshotRecord
+ *	\brief		A single device in the snapshot.
+ */
+struct SnapshotRecord {
+	uint64		fingerprint;					//!<	DeviceInfo::Fingerprint of the device
+	uint64		triggerFingerprint;				//!<	DeviceFingerprint() of the trigger, 0 if none
+	bigtime_t	ignoredUntil;					//!<	See DeviceInfo::IgnoredUntil
+	char		name[kSnapshotNameLength];		//!<	Zero-terminated device name
+	char		trigger[kSnapshotNameLength];	//!<	Device whose activity suppresses this one
+	uint32		windowMs;						//!<	How long the trigger counts as active
+	uint8		flags;							//!<	Combination of kSnapshot* flags
+	uint8		mask;							//!<	See DeviceInfo::SuppressMask
+	uint16		focusMask;						//!<	Applications the device is ignored for, see SnapshotHeader::focusClasses
+};
+
+
+/**	\struct		IgnoreSnapshot
+ *	\brief		The whole snapshot, as it is laid out in the file.
+ *	\note		Only `header.count` records are written to the file.
+ */
+struct IgnoreSnapshot {
+	SnapshotHeader	header;								//!<	See SnapshotHeader
+	SnapshotRecord	records[kMaxSnapshotDevices];		//!<	See SnapshotRecord
+};
+
+
+//!	\copydoc	ReadSnapshot
+status_t	ReadSnapshot(IgnoreSnapshot* out);
+//!	\copydoc	WriteSnapshot
+status_t	WriteSnapshot(const IgnoreSnapshot* in);
+
+#endif // _SNAPSHOT_H_
@@ -0,0 +1,124 @@
+/*
+	Copyright 2025, Alexey "Hitech" Burshtein.   All Rights Reserved.
+	This file may be used under the terms of the MIT License.
+*/
+
+/**
+ * @file counters_test.cpp
+ * @brief Tests of SharedCounters: publishing, reading, devices and traces.
+ * @ingroup TestsModule
+ */
+
+#include "counters.h"
+#include "test.h"
+
+
+//	The reader doesn't see an area nobody has published
+static void
+TestNothingPublished()
+{
+	SharedCounters reader;
+	CHECK_EQUAL(B_NAME_NOT_FOUND, reader.Map());
+	CHECK(reader.Area() == NULL);
+	CHECK_EQUAL(-1, reader.FindDevice(1));
+}
+
+
+//	Identical devices get slots of their own, and the reader sees the counts
+static void
+TestDevices()
+{
+	SharedCounters publisher;
+	CHECK_EQUAL(B_OK, publisher.Publish());
+
+	int32 first = publisher.AddDevice(0x1111, "USB Mouse");
+	int32 second = publisher.AddDevice(0x2222, "USB Mouse");
+	CHECK(first >= 0);
+	CHECK(second >= 0);
+	CHECK(first != second);
+	CHECK_EQUAL(first, publisher.AddDevice(0x1111, "USB Mouse"));
+
+	publisher.Count(first, true, kDropIgnored, 100);
+	publisher.Count(first, false, kDropMasked, 200);
+	publisher.Count(second, false, kDropIgnored, 300);
+	publisher.AddTraits(second, 0x3);
+	publisher.AddTraits(second, 0x1);
+
+	SharedCounters reader;
+	CHECK_EQUAL(B_OK, reader.Map());
+	CHECK_EQUAL(first, reader.FindDevice(0x1111));
+	CHECK_EQUAL(second, reader.FindDevice(0x2222));
+	CHECK_EQUAL(-1, reader.FindDevice(0x3333));
+
+	const DeviceCounters& a = reader.Area()->devices[first];
+	const DeviceCounters& b = reader.Area()->devices[second];
+	CHECK_EQUAL(2, a.seen.load());
+	CHECK_EQUAL(1, a.passed.load());
+	CHECK_EQUAL(1, a.dropped[kDropMasked].load());
+	CHECK_EQUAL(200, a.lastActivity.load());
+	CHECK_EQUAL(0, a.traits.load());
+	CHECK_EQUAL(1, b.dropped[kDropIgnored].load());
+	CHECK_EQUAL(0x3, b.traits.load());
+
+	// Only the publisher writes
+	CHECK_EQUAL(-1, reader.AddDevice(0x3333, "Touchpad"));
+	reader.Count(first, true, kDropIgnored, 400);
+	CHECK_EQUAL(2, a.seen.load());
+
+	// Invalid slots are ignored
+	publisher.Count(-1, true, kDropIgnored, 500);
+	publisher.Count(kMaxCounterDevices, true, kDropIgnored, 500);
+}
+
+
+//	Devices beyond kMaxCounterDevices are not counted
+static void
+TestFull()
+{
+	SharedCounters publisher;
+	CHECK_EQUAL(B_OK, publisher.Publish());
+	for (int32 i = 0; i < kMaxCounterDevices; i++)
+		CHECK_EQUAL(i, publisher.AddDevice(i + 1, "Mouse"));
+	CHECK_EQUAL(-1, publisher.AddDevice(kMaxCounterDevices + 1, "Mouse"));
+}
+
+
+//	The traces are a ring of kMaxTraces records
+static void
+TestTraces()
+{
+	SharedCounters publisher;
+	CHECK_EQUAL(B_OK, publisher.Publish());
+	CHECK_EQUAL(-1, publisher.BeginTrace(0, 1, 2, 3));
+
+	int32 trace = publisher.BeginTrace(7, 10, 20, 30);
+	CHECK_EQUAL(0, trace);
+	publisher.MarkTrace(trace, kTraceApplied, 40);
+
+	SharedCounters reader;
+	CHECK_EQUAL(B_OK, reader.Map());
+	const TraceRecord& record = reader.Area()->traces[trace];
+	CHECK_EQUAL(7, record.id.load());
+	CHECK_EQUAL(10, record.started);
+	CHECK_EQUAL(30, record.stages[kTraceNotified].load());
+	CHECK_EQUAL(40, record.stages[kTraceApplied].load());
+	CHECK_EQUAL(0, record.stages[kTraceFirstDrop].load());
+
+	for (int32 i = 1; i < kMaxTraces; i++)
+		publisher.BeginTrace(100 + i, 0, 0, 0);
+	CHECK_EQUAL(0, publisher.BeginTrace(8, 50, 60, 70));
+	CHECK_EQUAL(8, record.id.load());
+	CHECK_EQUAL(0, record.stages[kTraceApplied].load());
+	CHECK_EQUAL(kMaxTraces + 1, reader.Area()->traceCount.load());
+}
+
+
+int
+main()
+{
+	TestNothingPublished();
+	TestDevices();
+	TestFull();
+	TestTraces();
+	return TEST_RESULT("counters_test");
+}
@@ -0,0 +1,255 @@
+/*
+	Copyright 2025, Alexey "Hitech" Burshtein.   All Rights Reserved.
+	This file may be used under the terms of the MIT License.
+*/
+
+/**
+ * @file evdev_test.cpp
+ * @brief Tests of the evdev DeviceControl against virtual uinput mice.
+ * @ingroup TestsModule
+ *
+ * Creates mice through /dev/uinput, then suppresses and releases them and
+ * checks what a reader of their nodes receives: nothing while a mouse is
+ * grabbed, every event while it's only left to a filter. Two mice with the
+ * same name are grabbed one after the other. Linux only; without access to
+ * /dev/uinput, e.g. in a container or without root, the test is skipped.
+ */
+
+#include "device_control.h"
+#include "test.h"
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <linux/uinput.h>
+#include <string.h>
+#include <sys/ioctl.h>
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+
+//!	Moves each phase of the comparison sends.
+static const int32	kMoves = 1000;
+
+
+//	A virtual mouse, gone with the object
+class VirtualMouse {
+public:
+	VirtualMouse(const char* name)
+		:
+		fFd(open("/dev/uinput", O_WRONLY | O_NONBLOCK | O_CLOEXEC))
+	{
+		if (fFd < 0) { return; }
+		struct uinput_setup setup = {};
+		setup.id.bustype = BUS_VIRTUAL;
+		setup.id.vendor = 0x1234;
+		setup.id.product = 0x5678;
+		strlcpy(setup.name, name, sizeof(setup.name));
+		if (ioctl(fFd, UI_SET_EVBIT, EV_KEY) != 0 || ioctl(fFd, UI_SET_KEYBIT, BTN_LEFT) != 0
+			|| ioctl(fFd, UI_SET_EVBIT, EV_REL) != 0 || ioctl(fFd, UI_SET_RELBIT, REL_X) != 0
+			|| ioctl(fFd, UI_SET_RELBIT, REL_Y) != 0 || ioctl(fFd, UI_DEV_SETUP, &setup) != 0
+			|| ioctl(fFd, UI_DEV_CREATE) != 0) {
+			close(fFd);
+			fFd = -1;
+		}
+	}
+
+	~VirtualMouse()
+	{
+		if (fFd < 0) { return; }
+		ioctl(fFd, UI_DEV_DESTROY);
+		close(fFd);
+	}
+
+	bool IsValid() const { return fFd >= 0; }
+
+	//	Moves the mouse by one to the right
+	void Move()
+	{
+		struct input_event events[2] = {};
+		events[0].type = EV_REL;
+		events[0].code = REL_X;
+		events[0].value = 1;
+		events[1].type = EV_SYN;
+		events[1].code = SYN_REPORT;
+		if (write(fFd, events, sizeof(events)) != sizeof(events)) { perror("write"); }
+	}
+
+private:
+	int		fFd;
+};
+
+
+//	The nodes of the devices with the name, in the order DeviceControl visits them
+static std::vector<std::string>
+FindNodes(const char* name)
+{
+	std::vector<std::string> nodes;
+	DIR* directory = opendir("/dev/input");
+	if (!directory) { return nodes; }
+	while (struct dirent* entry = readdir(directory)) {
+		if (strncmp(entry->d_name, "event", 5) != 0) { continue; }
+		std::string path = std::string("/dev/input/") + entry->d_name;
+		int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+		if (fd < 0) { continue; }
+		char nodeName[256] = "";
+		ioctl(fd, EVIOCGNAME(sizeof(nodeName)), nodeName);
+		close(fd);
+		if (strcmp(nodeName, name) == 0) { nodes.push_back(path); }
+	}
+	closedir(directory);
+	std::sort(nodes.begin(), nodes.end(), [](const std::string& a, const std::string& b) {
+		return a.size() != b.size() ? a.size() < b.size() : a < b;
+	});
+	return nodes;
+}
+
+
+//	Waits for udev to make the nodes of the devices with the name
+static std::vector<std::string>
+WaitForNodes(const char* name, size_t count)
+{
+	std::vector<std::string> nodes;
+	for (int32 i = 0; i < 100; i++) {
+		nodes = FindNodes(name);
+		if (nodes.size() >= count) { break; }
+		usleep(20000);
+	}
+	return nodes;
+}
+
+
+//	Number of the moves waiting in the node
+static int32
+CountMoves(int fd)
+{
+	int32 moves = 0;
+	struct input_event event;
+	while (read(fd, &event, sizeof(event)) == sizeof(event)) {
+		if (event.type == EV_REL) { moves++; }
+	}
+	return moves;
+}
+
+
+//	Sends moves, returns how many of them reached the reader and how long it took
+static int32
+SendMoves(VirtualMouse& mouse, int reader, int32 count, bigtime_t* elapsed)
+{
+	bigtime_t started = system_time();
+	int32 received = 0;
+	for (int32 i = 0; i < count; i++) {
+		mouse.Move();
+		received += CountMoves(reader);
+	}
+	usleep(10000);
+	received += CountMoves(reader);
+	*elapsed = system_time() - started;
+	return received;
+}
+
+
+//	A grabbed mouse reaches nobody else, a released one does; the numbers
+//	compare the grab with leaving the events to a filter
+static void
+TestGrab(DeviceControl* control)
+{
+	char name[64];
+	snprintf(name, sizeof(name), "Ignore Touchpad Test Mouse %d", (int)getpid());
+	VirtualMouse mouse(name);
+	CHECK(mouse.IsValid());
+	std::vector<std::string> nodes = WaitForNodes(name, 1);
+	CHECK_EQUAL(1, nodes.size());
+	if (nodes.empty()) { return; }
+
+	std::vector<std::string> names;
+	CHECK_EQUAL(B_OK, control->GetPointingDevices(&names));
+	CHECK(std::find(names.begin(), names.end(), name) != names.end());
+
+	int reader = open(nodes[0].c_str(), O_RDONLY | O_NONBLOCK | O_CLOEXEC);
+	CHECK(reader >= 0);
+	CountMoves(reader);
+
+	bigtime_t filtered, grabbed;
+	int32 passed = SendMoves(mouse, reader, kMoves, &filtered);
+	CHECK_EQUAL(kMoves, passed);
+
+	CHECK(!control->IsSuppressed(name));
+	CHECK_EQUAL(B_OK, control->Suppress(name));
+	CHECK(control->IsSuppressed(name));
+	CHECK_EQUAL(0, SendMoves(mouse, reader, kMoves, &grabbed));
+
+	CHECK_EQUAL(B_OK, control->Release(name));
+	CHECK(!control->IsSuppressed(name));
+	bigtime_t released;
+	CHECK_EQUAL(kMoves, SendMoves(mouse, reader, kMoves, &released));
+
+	printf("evdev_test: %d moves, left to a filter %d reached the reader in %lld us, "
+		"grabbed 0 of them in %lld us\n", (int)kMoves, (int)passed, (long long)filtered,
+		(long long)grabbed);
+	close(reader);
+}
+
+
+//	Mice with the same name are grabbed in the order of their nodes
+static void
+TestDuplicates(DeviceControl* control)
+{
+	char name[64];
+	snprintf(name, sizeof(name), "Ignore Touchpad Twin Mouse %d", (int)getpid());
+	VirtualMouse first(name), second(name);
+	CHECK(first.IsValid() && second.IsValid());
+	std::vector<std::string> nodes = WaitForNodes(name, 2);
+	CHECK_EQUAL(2, nodes.size());
+	if (nodes.size() < 2) { return; }
+
+	int readers[2];
+	for (int32 i = 0; i < 2; i++) {
+		readers[i] = open(nodes[i].c_str(), O_RDONLY | O_NONBLOCK | O_CLOEXEC);
+		CountMoves(readers[i]);
+	}
+
+	// uinput numbers the nodes in the order of creation
+	CHECK_EQUAL(B_OK, control->Suppress(name));
+	first.Move();
+	second.Move();
+	usleep(10000);
+	CHECK_EQUAL(0, CountMoves(readers[0]));
+	CHECK_EQUAL(1, CountMoves(readers[1]));
+
+	CHECK_EQUAL(B_OK, control->Suppress(name));
+	second.Move();
+	usleep(10000);
+	CHECK_EQUAL(0, CountMoves(readers[1]));
+	CHECK_EQUAL(B_NAME_NOT_FOUND, control->Suppress(name));
+
+	// ReleaseAll() drops both grabs
+	CHECK_EQUAL(B_OK, control->ReleaseAll());
+	CHECK(!control->IsSuppressed(name));
+	first.Move();
+	second.Move();
+	usleep(10000);
+	CHECK_EQUAL(1, CountMoves(readers[0]));
+	CHECK_EQUAL(1, CountMoves(readers[1]));
+
+	for (int32 i = 0; i < 2; i++) close(readers[i]);
+}
+
+
+int
+main()
+{
+	int uinput = open("/dev/uinput", O_WRONLY | O_CLOEXEC);
+	if (uinput < 0) {
+		printf("evdev_test: skipped, /dev/uinput: %s\n", strerror(errno));
+		return 0;
+	}
+	close(uinput);
+
+	DeviceControl* control = DeviceControl::Create();
+	TestGrab(control);
+	TestDuplicates(control);
+	delete control;
+	return TEST_RESULT("evdev_test");
+}
@@ -0,0 +1,73 @@
+/*
+	Copyright 2025, Alexey "Hitech" Burshtein.   All Rights Reserved.
+	This file may be used under the terms of the MIT License.
+*/
+
+/**
+ * @file settings_test.cpp
+ * @brief Tests of the profiles of Settings, in memory.
+ * @ingroup TestsModule
+ *
+ * Settings needs the Haiku Kit, so this test is only built on Haiku. It never
+ * calls Settings::Load() or Settings::Save(), the settings of the user are
+ * left alone.
+ */
+
+#include "settings.h"
+#include "test.h"
+
+
+//	A profile brings back every policy it was saved with, the strategy too
+static void
+TestProfileRoundTrip()
+{
+	Settings settings;
+	settings.SetStatus("USB Mouse", true);
+	settings.SetSuppressMask("Touchpad", 1 << kEventTap);
+	settings.SetStrategy("USB Mouse", kStrategyThrottle);
+	settings.SetStrategy("Touchpad", kStrategyStop);
+	settings.SaveProfile("docked");
+
+	settings.SetStatus("USB Mouse", false);
+	settings.SetSuppressMask("Touchpad", 0);
+	settings.SetStrategy("USB Mouse", kStrategyFilter);
+	settings.SetStrategy("Touchpad", kStrategyAuto);
+	settings.SetStrategy("Tablet", kStrategyStop);
+
+	CHECK_EQUAL(B_OK, settings.ActivateProfile("docked"));
+	CHECK(settings.GetStatus("USB Mouse"));
+	CHECK_EQUAL(1 << kEventTap, settings.GetSuppressMask("Touchpad"));
+	CHECK_EQUAL(kStrategyThrottle, settings.GetStrategy("USB Mouse"));
+	CHECK_EQUAL(kStrategyStop, settings.GetStrategy("Touchpad"));
+	// Not in the profile, so reset like the other policies
+	CHECK_EQUAL(kStrategyAuto, settings.GetStrategy("Tablet"));
+	CHECK(settings.GetActiveProfile() == "docked");
+
+	CHECK_EQUAL(B_NAME_NOT_FOUND, settings.ActivateProfile("travel"));
+}
+
+
+//	The ordinal keeps the strategies of identical devices apart
+static void
+TestProfileOrdinals()
+{
+	Settings settings;
+	settings.SetStrategy("USB Mouse", kStrategyStop, 0);
+	settings.SetStrategy("USB Mouse", kStrategyThrottle, 1);
+	settings.SaveProfile("twins");
+	settings.SetStrategy("USB Mouse", kStrategyAuto, 0);
+	settings.SetStrategy("USB Mouse", kStrategyAuto, 1);
+
+	CHECK_EQUAL(B_OK, settings.ActivateProfile("twins"));
+	CHECK_EQUAL(kStrategyStop, settings.GetStrategy("USB Mouse", 0));
+	CHECK_EQUAL(kStrategyThrottle, settings.GetStrategy("USB Mouse", 1));
+}
+
+
+int
+main()
+{
+	TestProfileRoundTrip();
+	TestProfileOrdinals();
+	return TEST_RESULT("settings_test");
+}
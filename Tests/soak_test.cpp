@@ -0,0 +1,397 @@
+/*
+	Copyright 2025, Alexey "Hitech" Burshtein.   All Rights Reserved.
+	This file may be used under the terms of the MIT License.
+*/
+
+/**
+ * @file soak_test.cpp
+ * @brief Concurrency soak of the filter's state: events against hotplug and saves.
+ * @ingroup TestsModule
+ *
+ * Runs the threads of the add-on against each other for a while, the way
+ * input_server does, only much harder:
+ * - event threads make the decision of IgnoreTouchpadFilter::Filter() for
+ *   random devices, and measure how long each one takes;
+ * - a hotplug thread claims slots for devices in bursts, a few more than
+ *   there are slots, while the events come in;
+ * - saver threads write random snapshots at once, like the CLI, the
+ *   replicant and the add-on's worker saving together;
+ * - the worker thread reads the snapshots, applies them, arms and expires the
+ *   timers, and now and then unignores everything like the emergency chord;
+ * - a focus thread switches the active application.
+ *
+ * It checks that no torn snapshot is ever read, that the last active pointer
+ * is never silenced, that the timers don't expire early, and that the counters
+ * add up, and prints the percentiles of the decision latency. Run it under
+ * ThreadSanitizer with `make tsan`; `soak_test <seconds>` soaks for longer.
+ */
+
+#include "DeviceSlots.h"
+#include "TimerWheel.h"
+#include "counters.h"
+#include "snapshot.h"
+#include "test.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+
+//	More devices than slots, so the table fills up during the storm
+static const int32	kDeviceCount = kMaxDeviceSlots + 8;
+static const int32	kEventThreads = 2;
+static const int32	kSaverThreads = 2;
+//	Latencies up to this many nanoseconds are counted one by one
+static const int32	kHistogramSize = 1 << 16;
+
+static char					sNames[kDeviceCount][kSnapshotNameLength];
+static std::atomic<bool>	sRunning(true);
+static std::atomic<int32>	sConnected(1);		// Devices the events come from so far
+
+
+//	Lets the test look at the slots
+class InspectedSlots : public DeviceSlots {
+public:
+	uint32 Flags(int32 slot) const
+		{ return fSlots[slot].flags.load(std::memory_order_acquire); }
+	bigtime_t LastActivity(int32 slot) const
+		{ return fSlots[slot].lastActivity.load(std::memory_order_relaxed); }
+	int32 Count() const { return fCount.load(std::memory_order_acquire); }
+};
+
+static InspectedSlots	sSlots;
+static SharedCounters	sCounters;
+
+
+//	Small and fast pseudo-random numbers, one generator per thread
+struct Random {
+	uint64 state;
+	explicit Random(uint64 seed) : state(seed * 0x9e3779b97f4a7c15ULL + 1) {}
+	uint32 Next(uint32 range)
+	{
+		state ^= state << 13;
+		state ^= state >> 7;
+		state ^= state << 17;
+		return (uint32)(state % range);
+	}
+};
+
+
+static int64
+NowNanoseconds()
+{
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (int64)now.tv_sec * 1000000000LL + now.tv_nsec;
+}
+
+
+//	What an event thread did
+struct EventStats {
+	std::vector<uint64>	histogram;			// Decisions by their latency in ns
+	int64				overflow = 0;		// Decisions longer than the histogram
+	int64				maxLatency = 0;
+	int64				events = 0;
+	int64				counted = 0;		// Events that went to the counters
+};
+
+
+//	The decision of IgnoreTouchpadFilter::Filter(), timed
+static void
+EventThread(int32 index, EventStats* stats)
+{
+	Random random(index + 1);
+	stats->histogram.assign(kHistogramSize, 0);
+	while (sRunning.load(std::memory_order_relaxed)) {
+		const char* name = sNames[random.Next(sConnected.load(std::memory_order_relaxed))];
+		event_class eventClass = (event_class)random.Next(kEventClassCount);
+
+		int64 started = NowNanoseconds();
+		bigtime_t when = system_time();
+		int32 slot = sSlots.Acquire(name, &sCounters);
+		drop_reason reason = kDropIgnored;
+		bool drop = sSlots.ShouldDrop(slot, eventClass, when, &reason);
+		if (slot >= 0) { sCounters.Count(sSlots.CountersSlot(slot), !drop, reason, when); }
+		int64 latency = NowNanoseconds() - started;
+
+		if (latency < kHistogramSize) { stats->histogram[latency]++; } else { stats->overflow++; }
+		if (latency > stats->maxLatency) { stats->maxLatency = latency; }
+		stats->events++;
+		if (slot >= 0 && sSlots.CountersSlot(slot) >= 0) { stats->counted++; }
+	}
+}
+
+
+//	Devices come in bursts: claims race with the event path
+static void
+HotplugThread()
+{
+	Random random(100);
+	while (sRunning.load(std::memory_order_relaxed)) {
+		int32 connected = sConnected.load(std::memory_order_relaxed);
+		int32 burst = 1 + random.Next(4);
+		for (int32 i = 0; i < burst && connected < kDeviceCount; i++) {
+			sSlots.Acquire(sNames[connected], &sCounters);
+			sConnected.store(++connected, std::memory_order_relaxed);
+		}
+		// A flaky hub: the same devices again, which must find their slots
+		for (int32 i = 0; i < 16; i++) { sSlots.Acquire(sNames[random.Next(connected)], &sCounters); }
+		std::this_thread::sleep_for(std::chrono::microseconds(200 + random.Next(800)));
+	}
+}
+
+
+//	Every record of a snapshot carries a tag derived from the header, so a mix
+//	of two snapshots is noticed
+static uint32
+RecordTag(uint32 traceId)
+{
+	return traceId % 997 + 1;
+}
+
+
+static void
+SaverThread(int32 index, std::atomic<int64>* written)
+{
+	Random random(200 + index);
+	IgnoreSnapshot* snapshot = new IgnoreSnapshot;
+	uint32 serial = 0;
+	while (sRunning.load(std::memory_order_relaxed)) {
+		memset(snapshot, 0, sizeof(IgnoreSnapshot));
+		snapshot->header.magic = IGNORE_SNAPSHOT_MAGIC;
+		snapshot->header.version = IGNORE_SNAPSHOT_VERSION;
+		snapshot->header.written = system_time();
+		snapshot->header.traceId = (++serial << 4) | index;
+		snapshot->header.focusClassCount = 2;
+		strcpy(snapshot->header.focusClasses[0], "application/x-vnd.Haiku-Terminal");
+		strcpy(snapshot->header.focusClasses[1], "application/x-vnd.Haiku-WebPositive");
+
+		int32 count = random.Next(kMaxSnapshotDevices + 1);
+		for (int32 i = 0; i < count; i++) {
+			SnapshotRecord& record = snapshot->records[i];
+			int32 device = random.Next(kDeviceCount);
+			record.fingerprint = DeviceFingerprint(sNames[device]);
+			strcpy(record.name, sNames[device]);
+			record.windowMs = RecordTag(snapshot->header.traceId);
+			switch (random.Next(5)) {
+				case 0:
+					record.flags = kSnapshotIgnored;
+					break;
+				case 1:
+					record.flags = kSnapshotIgnored;
+					record.ignoredUntil = real_time_clock_usecs() + random.Next(5000);
+					break;
+				case 2:
+					record.mask = random.Next(kEventAllMask + 1);
+					break;
+				case 3: {
+					int32 trigger = random.Next(kDeviceCount);
+					record.flags = kSnapshotWhileActive;
+					record.triggerFingerprint = DeviceFingerprint(sNames[trigger]);
+					strcpy(record.trigger, sNames[trigger]);
+					break;
+				}
+				default:
+					record.flags = kSnapshotWhileFocused;
+					record.focusMask = 1 + random.Next(3);
+					break;
+			}
+		}
+		snapshot->header.count = count;
+		if (B_OK == WriteSnapshot(snapshot)) { written->fetch_add(1, std::memory_order_relaxed); }
+		std::this_thread::sleep_for(std::chrono::microseconds(random.Next(2000)));
+	}
+	delete snapshot;
+}
+
+
+//	What the worker did
+struct WorkerStats {
+	int64	reads = 0;
+	int64	applied = 0;
+	int64	torn = 0;			// Snapshots mixed from two writes
+	int64	badReads = 0;		// Reads that failed once a snapshot existed
+	int64	silenced = 0;		// Applies that silenced the last active pointer
+	int64	expired = 0;
+	int64	early = 0;			// Timers that expired before their deadline
+	int64	chords = 0;
+};
+
+
+//	Only the worker applies snapshots and owns the wheel, like in the add-on
+static void
+WorkerThread(WorkerStats* stats, std::atomic<int64>* written)
+{
+	Random random(300);
+	IgnoreSnapshot* snapshot = new IgnoreSnapshot;
+	TimerWheel timers;
+	bigtime_t deadlines[kMaxDeviceSlots] = { 0 };
+	const uint32 silencing = (1 << (kSlotDropShift + kEventMotion)) | kSlotWhileActive
+		| kSlotWhileFocused;
+
+	while (sRunning.load(std::memory_order_relaxed)) {
+		bool existed = written->load(std::memory_order_relaxed) > 0;
+		status_t status = ReadSnapshot(snapshot);
+		stats->reads++;
+		if (B_OK != status) {
+			if (existed) { stats->badReads++; }
+		} else {
+			uint32 tag = RecordTag(snapshot->header.traceId);
+			for (int32 i = 0; i < snapshot->header.count; i++) {
+				if (snapshot->records[i].windowMs != tag) { stats->torn++; break; }
+			}
+
+			bool anyActive = false;
+			for (int32 i = 0; i < sSlots.Count() && !anyActive; i++)
+				anyActive = sSlots.LastActivity(i) != 0;
+
+			sSlots.Apply(snapshot, &sCounters);
+			stats->applied++;
+
+			if (anyActive) {
+				bool pointer = false;
+				for (int32 i = 0; i < sSlots.Count() && !pointer; i++) {
+					pointer = sSlots.LastActivity(i) != 0 && (sSlots.Flags(i) & silencing) == 0;
+				}
+				if (!pointer) { stats->silenced++; }
+			}
+
+			// Like IgnoreTouchpadFilter::ArmTimers()
+			timers.Clear();
+			for (int32 i = 0; i < kMaxDeviceSlots; i++) { deadlines[i] = 0; }
+			for (int32 i = 0; i < snapshot->header.count; i++) {
+				const SnapshotRecord& record = snapshot->records[i];
+				if ((record.flags & kSnapshotIgnored) == 0 || record.ignoredUntil == 0) { continue; }
+				int32 slot = sSlots.Find(record.fingerprint);
+				if (slot < 0) { continue; }
+				timers.Schedule(slot, record.ignoredUntil);
+				deadlines[slot] = record.ignoredUntil;
+			}
+		}
+
+		int32 expired[kMaxDeviceSlots];
+		bigtime_t now = real_time_clock_usecs();
+		int32 count = timers.Expire(now, expired);
+		for (int32 i = 0; i < count; i++) {
+			if (deadlines[expired[i]] > now) { stats->early++; }
+			deadlines[expired[i]] = 0;
+			sSlots.ClearIgnored(expired[i]);
+		}
+		stats->expired += count;
+
+		if (random.Next(200) == 0) {
+			sSlots.ClearIgnored();
+			stats->chords++;
+		}
+		std::this_thread::sleep_for(std::chrono::microseconds(random.Next(1000)));
+	}
+	delete snapshot;
+}
+
+
+static void
+FocusThread()
+{
+	Random random(400);
+	while (sRunning.load(std::memory_order_relaxed)) {
+		sSlots.SetFocusedClass(random.Next(4));
+		std::this_thread::sleep_for(std::chrono::microseconds(random.Next(5000)));
+	}
+}
+
+
+//	The latency below which `fraction` of the decisions were made
+static int64
+Percentile(const std::vector<uint64>& histogram, int64 total, double fraction)
+{
+	int64 wanted = (int64)(total * fraction);
+	int64 seen = 0;
+	for (int32 i = 0; i < kHistogramSize; i++) {
+		seen += histogram[i];
+		if (seen > wanted) { return i; }
+	}
+	return kHistogramSize;
+}
+
+
+int
+main(int argc, char** argv)
+{
+	double seconds = argc > 1 ? atof(argv[1]) : 2.0;
+
+	char directory[] = "/tmp/ignore-touchpad-soak-XXXXXX";
+	if (!mkdtemp(directory)) {
+		perror("mkdtemp");
+		return 1;
+	}
+	setenv("XDG_CONFIG_HOME", directory, 1);
+	for (int32 i = 0; i < kDeviceCount; i++)
+		snprintf(sNames[i], kSnapshotNameLength, "Soak Device %d", (int)i);
+	CHECK_EQUAL(B_OK, sCounters.Publish());
+
+	std::vector<EventStats> eventStats(kEventThreads);
+	WorkerStats workerStats;
+	std::atomic<int64> written(0);
+
+	std::vector<std::thread> threads;
+	for (int32 i = 0; i < kEventThreads; i++) threads.emplace_back(EventThread, i, &eventStats[i]);
+	for (int32 i = 0; i < kSaverThreads; i++) threads.emplace_back(SaverThread, i, &written);
+	threads.emplace_back(HotplugThread);
+	threads.emplace_back(WorkerThread, &workerStats, &written);
+	threads.emplace_back(FocusThread);
+
+	std::this_thread::sleep_for(std::chrono::duration<double>(seconds));
+	sRunning.store(false);
+	for (std::thread& thread : threads) thread.join();
+
+	CHECK_EQUAL(0, workerStats.torn);
+	CHECK_EQUAL(0, workerStats.badReads);
+	CHECK_EQUAL(0, workerStats.silenced);
+	CHECK_EQUAL(0, workerStats.early);
+	CHECK(workerStats.applied > 0);
+	CHECK(written.load() > 0);
+	CHECK_EQUAL(kMaxDeviceSlots, sSlots.Count());
+
+	// Every counted event is in the counters, once
+	std::vector<uint64> histogram(kHistogramSize, 0);
+	int64 events = 0, counted = 0, overflow = 0, maxLatency = 0;
+	for (const EventStats& stats : eventStats) {
+		for (int32 i = 0; i < kHistogramSize; i++) histogram[i] += stats.histogram[i];
+		events += stats.events;
+		counted += stats.counted;
+		overflow += stats.overflow;
+		if (stats.maxLatency > maxLatency) maxLatency = stats.maxLatency;
+	}
+	int64 seen = 0;
+	const CountersArea* area = sCounters.Area();
+	for (int32 i = 0; i < area->deviceCount.load(); i++) {
+		const DeviceCounters& device = area->devices[i];
+		int64 dropped = 0;
+		for (int32 reason = 0; reason < kDropReasonCount; reason++) dropped += device.dropped[reason].load();
+		CHECK_EQUAL(device.seen.load(), device.passed.load() + dropped);
+		seen += device.seen.load();
+	}
+	CHECK_EQUAL(counted, seen);
+
+	printf("soak_test: %.1f s, %lld events from %d threads, %lld snapshots written, "
+		"%lld read and applied, %lld timers expired, %lld chords\n",
+		seconds, (long long)events, (int)kEventThreads, (long long)written.load(),
+		(long long)workerStats.applied, (long long)workerStats.expired,
+		(long long)workerStats.chords);
+	printf("decision latency (ns, clock reads included): p50 %lld, p99 %lld, p99.9 %lld, "
+		"max %lld, %lld over %d\n",
+		(long long)Percentile(histogram, events, 0.5),
+		(long long)Percentile(histogram, events, 0.99),
+		(long long)Percentile(histogram, events, 0.999),
+		(long long)maxLatency, (long long)overflow, (int)kHistogramSize);
+
+	char snapshotPath[B_PATH_NAME_LENGTH];
+	snprintf(snapshotPath, sizeof(snapshotPath), "%s/%s", directory, IGNORE_SNAPSHOT_FILE_NAME);
+	unlink(snapshotPath);
+	rmdir(directory);
+	return TEST_RESULT("soak_test");
+}
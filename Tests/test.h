@@ -0,0 +1,53 @@
+/*
+	Copyright 2025, Alexey "Hitech" Burshtein.   All Rights Reserved.
+	This file may be used under the terms of the MIT License.
+*/
+
+/**
+ * @file test.h
+ * @brief The few checks the tests need.
+ *
+ * @defgroup TestsModule tests
+ * @brief Tests of the parts which also build outside of Haiku.
+ *
+ * Every test is a program of its own, `make check` runs them all. A failed
+ * CHECK() prints where it failed and the test goes on, so one run shows all
+ * the failures; TEST_RESULT() is the exit status of main().
+ */
+
+#ifndef _IGNORE_TEST_H_
+#define _IGNORE_TEST_H_
+
+#include <stdio.h>
+
+
+//!	Number of the failed checks so far.
+static int sFailedChecks = 0;
+
+//!	Fails the test if `condition` doesn't hold, and goes on.
+#define CHECK(condition) \
+	do { \
+		if (!(condition)) { \
+			fprintf(stderr, "%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #condition); \
+			sFailedChecks++; \
+		} \
+	} while (0)
+
+//!	Fails the test if the two values differ, printing both.
+#define CHECK_EQUAL(expected, actual) \
+	do { \
+		long long _expected = (long long)(expected), _actual = (long long)(actual); \
+		if (_expected != _actual) { \
+			fprintf(stderr, "%s:%d: %s is %lld, expected %lld\n", __FILE__, __LINE__, \
+				#actual, _actual, _expected); \
+			sFailedChecks++; \
+		} \
+	} while (0)
+
+//!	Exit status of the test: 0 if every check held.
+#define TEST_RESULT(name) \
+	(sFailedChecks == 0 \
+		? (printf("%s: passed\n", (name)), 0) \
+		: (printf("%s: %d checks failed\n", (name), sFailedChecks), 1))
+
+#endif // _IGNORE_TEST_H_